@@ -4,6 +4,29 @@
 
 #include "tawqa_generic.hh"
 #include "tawqa_getopt.hh"
+#include "tawqa_rate.hh"
+#include "tawqa_compress.hh"
+#include "tawqa_stripe.hh"
+#include "tawqa_resume.hh"
+#include "tawqa_verify.hh"
+#include "tawqa_dump.hh"
+#include "tawqa_sockopt.hh"
+#include "tawqa_zerocopy.hh"
+#include "tawqa_tls.hh"
+#include "tawqa_forward.hh"
+#include "tawqa_broadcast.hh"
+#include "tawqa_line.hh"
+#include "tawqa_merge.hh"
+#include "tawqa_mcast.hh"
+#include "tawqa_sink.hh"
+#include "tawqa_record.hh"
+#include "tawqa_load.hh"
+#include "tawqa_rtt.hh"
+#include "tawqa_gen.hh"
+#include "tawqa_stats.hh"
+#include "tawqa_metrics.hh"
+#include "tawqa_netio.hh"
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -12,11 +35,17 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <poll.h>
 #include <sys/time.h>
 #include <netinet/in.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <fcntl.h>
+#include <sys/stat.h>
+#ifdef TAWQA_HAVE_SENDFILE
+#include <sys/sendfile.h>
+#endif
 #include <array>
 #include <string_view>
 #include <span>
@@ -30,6 +59,7 @@ constexpr std::uint16_t TAWQA_SLEAZE_PORT = 31337;
 constexpr std::size_t TAWQA_BIGSIZ = 8192;
 constexpr std::size_t TAWQA_SMALLSIZ = 256;
 constexpr std::size_t TAWQA_MAXHOSTNAMELEN = 256;
+constexpr std::uint64_t TAWQA_ZC_RETRY_NS = 1000000; // pinned pool poll, 1 ms
 
 #ifndef INADDR_NONE
 #define INADDR_NONE 0xffffffff
@@ -56,6 +86,8 @@ struct tawqa_port_info {
 // Global state variables
 static tawqa_socket_t g_netfd = -1;
 static int g_ofd = 0;
+static int g_srcfd = STDIN_FILENO;   // relay input, stdin unless filtered
+static int g_dstfd = STDOUT_FILENO;  // relay output, stdout unless filtered
 static std::array<char, 20> g_unknown = {"(UNKNOWN)"};
 static std::array<char, 4> g_tcp = {"tcp"};
 static std::array<char, 4> g_udp = {"udp"};
@@ -66,16 +98,50 @@ static bool g_listen = false;
 static bool g_numeric = false;
 static bool g_udp_mode = false;
 static bool g_zero_io = false;
+static bool g_half_close = false;
 static std::uint32_t g_wait_time = 0;
 static std::uint32_t g_interval = 0;
+static std::uint32_t g_lines_per_sec = 0;
+static tawqa_sockopts g_sockopts = TAWQA_SOCKOPTS_UNSET;
+static bool g_zerocopy = false;
+static bool g_fastopen = false;
+static const char* g_unix_path = nullptr;
+static char* g_forward = nullptr;
+static bool g_broadcast = false;
+static bool g_merge = false;
+static bool g_merge_prefix = false;
+static tawqa_mcast_opts g_mcast = {nullptr, nullptr, nullptr, -1, -1};
+static const char* g_out_path = nullptr;
+static std::uint64_t g_prealloc = 0;
+static const char* g_record = nullptr;
+static const char* g_replay = nullptr;
+static double g_replay_speed = 1.0;
+static tawqa_load_opts g_load = {0, 0, 10, 16 * 1024, nullptr, -1};
+static struct in_addr g_load_addr;
+static bool g_echo = false;
+static tawqa_rtt_opts g_rtt = {0, 1000, "64"};
+static tawqa_gen_opts g_gen = {TAWQA_GEN_NONE, nullptr, 0};
+static bool g_discard = false;
+static bool g_discard_verify = false;
+static const char* g_metrics = nullptr;
+static tawqa_metrics_format g_metrics_format = TAWQA_METRICS_PROM;
+static unsigned g_metrics_interval = 5;
+static tawqa_port_t g_load_port = 0;
+static tawqa_broadcast_opts g_broadcast_opts = {4 * 1024 * 1024, TAWQA_SLOW_DROP};
+static tawqa_tls_opts g_tls = {false, nullptr, nullptr, nullptr, nullptr};
+static std::uint64_t g_rate_in = 0;
+static std::uint64_t g_rate_out = 0;
+static tawqa_compress_opts g_compress = {TAWQA_CODEC_NONE, 0};
+static std::size_t g_streams = 1;
+static std::array<tawqa_socket_t, TAWQA_STRIPE_MAX_STREAMS> g_stripe_fds;
+static bool g_resume = false;
+static const char* g_checkpoint = nullptr;
+static tawqa_hash_algo g_verify = TAWQA_HASH_NONE;
 
 // Buffer management
 static std::array<char, TAWQA_BIGSIZ> g_bigbuf_in;
 static std::array<char, TAWQA_BIGSIZ> g_bigbuf_net;
-
-// Statistics
-static std::uint32_t g_wrote_out = 0;
-static std::uint32_t g_wrote_net = 0;
+static_assert(TAWQA_BIGSIZ <= TAWQA_DUMP_SLOT_SIZE, "-o slots must hold a full relay read");
 
 // Forward declarations (implementations below)
 
@@ -92,26 +158,65 @@ void tawqa_holler(const char* str, const char* p1, const char* p2, const char* p
     }
 }
 
+// Set by the SIGINT/SIGTERM handler, acted on by the main loops
+static volatile std::sig_atomic_t g_caught_signal = 0;
+
+// Report an interrupt; it outranks whatever failed because of it
+static void tawqa_report_signal() {
+    static char sig_str[16], net_str[24], out_str[24];
+    errno = 0;
+    if (g_verbose > 1) {
+        snprintf(sig_str, sizeof(sig_str), "%d", static_cast<int>(g_caught_signal));
+        snprintf(net_str, sizeof(net_str), "%llu",
+                 static_cast<unsigned long long>(tawqa_stats_bytes(TAWQA_STATS_SENT)));
+        snprintf(out_str, sizeof(out_str), "%llu",
+                 static_cast<unsigned long long>(tawqa_stats_bytes(TAWQA_STATS_RECV)));
+        tawqa_holler("Caught signal %s, sent %s, rcvd %s", sig_str, net_str, out_str);
+        return;
+    }
+    tawqa_holler("Interrupted!");
+}
+
 // Fatal error function
 void tawqa_bail(const char* str, const char* p1, const char* p2, const char* p3) {
     g_verbose = true;
-    tawqa_holler(str, p1, p2, p3);
+    if (g_caught_signal) {
+        tawqa_report_signal();
+    } else {
+        tawqa_holler(str, p1, p2, p3);
+    }
     if (g_netfd >= 0) {
         close(g_netfd);
     }
     std::exit(1);
 }
 
-// Signal handler
+void tawqa_check_interrupt() {
+    if (g_caught_signal) {
+        tawqa_bail("Interrupted!");
+    }
+}
+
+void tawqa_signals_block(sigset_t* saved) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, saved);
+}
+
+void tawqa_signals_restore(const sigset_t* saved) {
+    pthread_sigmask(SIG_SETMASK, saved, nullptr);
+}
+
+// Signal handler: only records the signal, exit() and the atexit hooks
+// behind it must not run in signal context. A second signal means the
+// main thread isn't getting round to the flag, so give up at once.
 static void tawqa_catch_signal(int sig) {
-    static char sig_str[16], net_str[16], out_str[16];
-    if (g_verbose > 1) {
-        snprintf(sig_str, sizeof(sig_str), "%d", sig);
-        snprintf(net_str, sizeof(net_str), "%u", g_wrote_net);
-        snprintf(out_str, sizeof(out_str), "%u", g_wrote_out);
-        tawqa_bail("Caught signal %s, sent %s, rcvd %s", sig_str, net_str, out_str);
+    if (g_caught_signal) {
+        _exit(1);
     }
-    tawqa_bail("Interrupted!");
+    g_caught_signal = sig;
 }
 
 // Memory allocation wrapper
@@ -126,20 +231,6 @@ static void* tawqa_malloc(std::size_t size) {
     return ptr;
 }
 
-// Find newline in buffer
-static std::size_t tawqa_findline(const char* buf, std::size_t size) {
-    if (!buf || size > TAWQA_BIGSIZ) {
-        return 0;
-    }
-    
-    for (std::size_t i = 0; i < size; ++i) {
-        if (buf[i] == '\n') {
-            return i + 1;
-        }
-    }
-    return size;
-}
-
 // Resolve hostname
 static tawqa_host_info* tawqa_gethostpoop(const char* name, bool numeric_only) {
     auto* poop = static_cast<tawqa_host_info*>(tawqa_malloc(sizeof(tawqa_host_info)));
@@ -232,15 +323,58 @@ static tawqa_port_t tawqa_getportpoop(const char* pstring, std::uint32_t pnum) {
     return 0;
 }
 
+// Parse "host:port" for --forward into a connectable address
+static struct sockaddr_in tawqa_parse_hostport(char* spec) {
+    char* colon = std::strrchr(spec, ':');
+    if (!colon) {
+        tawqa_bail("Expected host:port, got %s", spec);
+    }
+    *colon = '\0';
+    
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(tawqa_getportpoop(colon + 1, 0));
+    if (!addr.sin_port) {
+        tawqa_bail("Invalid port %s", colon + 1);
+    }
+    tawqa_host_info* host = tawqa_gethostpoop(spec, g_numeric);
+    addr.sin_addr = host->iaddrs[0];
+    std::free(host);
+    return addr;
+}
+
+// With a cached cookie TCP_FASTOPEN_CONNECT holds the SYN back until the
+// first write, so a server that speaks first would never hear from us.
+// Only defer the handshake when input is already waiting.
+static bool tawqa_fastopen_ready() {
+    if (g_zero_io) {
+        return false;
+    }
+    if (g_gen.kind != TAWQA_GEN_NONE) {
+        return true;
+    }
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    if (poll(&pfd, 1, 0) > 0) {
+        return true;
+    }
+    errno = 0;
+    tawqa_holler("No input waiting, normal handshake despite --fastopen");
+    return false;
+}
+
 // Create and configure socket
+// With `nonblock` the connect is only started: the caller waits for
+// writability, and an immediate failure returns -1 instead of bailing
 static tawqa_socket_t tawqa_doconnect(struct in_addr* raddr, tawqa_port_t rport,
-                                      struct in_addr* laddr, tawqa_port_t lport) {
+                                      struct in_addr* laddr, tawqa_port_t lport,
+                                      bool nonblock = false) {
     tawqa_socket_t nnetfd;
+    int flags = nonblock ? SOCK_NONBLOCK | SOCK_CLOEXEC : 0;
     
     if (g_udp_mode) {
-        nnetfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        nnetfd = socket(AF_INET, SOCK_DGRAM | flags, IPPROTO_UDP);
     } else {
-        nnetfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        nnetfd = socket(AF_INET, SOCK_STREAM | flags, IPPROTO_TCP);
     }
     
     if (nnetfd < 0) {
@@ -252,6 +386,7 @@ static tawqa_socket_t tawqa_doconnect(struct in_addr* raddr, tawqa_port_t rport,
     if (setsockopt(nnetfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
         tawqa_holler("setsockopt reuseaddr failed");
     }
+    tawqa_sockopt_apply(nnetfd, &g_sockopts, !g_udp_mode);
     
     // Local binding
     struct sockaddr_in lclend = {};
@@ -278,6 +413,11 @@ static tawqa_socket_t tawqa_doconnect(struct in_addr* raddr, tawqa_port_t rport,
         return nnetfd;
     }
     
+    // The first stdin chunk rides in the SYN once a cookie is cached
+    if (g_fastopen && !g_udp_mode && tawqa_fastopen_ready() && !tawqa_sockopt_fastopen_connect(nnetfd)) {
+        tawqa_holler("TCP_FASTOPEN_CONNECT unavailable, normal handshake");
+    }
+    
     // Remote connection
     struct sockaddr_in remend = {};
     remend.sin_family = AF_INET;
@@ -286,6 +426,13 @@ static tawqa_socket_t tawqa_doconnect(struct in_addr* raddr, tawqa_port_t rport,
     
     if (connect(nnetfd, reinterpret_cast<struct sockaddr*>(&remend), 
                sizeof(remend)) < 0) {
+        if (nonblock) {
+            if (errno == EINPROGRESS) {
+                return nnetfd;
+            }
+            close(nnetfd);
+            return -1;
+        }
         static char port_str[16];
         snprintf(port_str, sizeof(port_str), "%u", rport);
         tawqa_bail("Can't connect to %s:%s", inet_ntoa(*raddr), port_str);
@@ -294,58 +441,513 @@ static tawqa_socket_t tawqa_doconnect(struct in_addr* raddr, tawqa_port_t rport,
     return nnetfd;
 }
 
+// Unix domain socket for -U: binds when listening, connects otherwise.
+// A leading '@' names a Linux abstract socket with no filesystem entry.
+static tawqa_socket_t tawqa_dounix(const char* path) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    
+    std::size_t len = std::strlen(path);
+    if (len >= sizeof(addr.sun_path)) {
+        tawqa_bail("Unix socket path too long: %s", path);
+    }
+    std::memcpy(addr.sun_path, path, len);
+    if (path[0] == '@') {
+        addr.sun_path[0] = '\0';
+    }
+    socklen_t addr_len = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + len);
+    
+    tawqa_socket_t nnetfd = socket(AF_UNIX, g_udp_mode ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (nnetfd < 0) {
+        tawqa_bail("Can't get socket");
+    }
+    tawqa_sockopt_apply(nnetfd, &g_sockopts, false);
+    
+    if (g_listen) {
+        // Replace a stale socket left by an earlier listener, nothing else
+        struct stat st;
+        if (path[0] != '@' && lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+            unlink(path);
+        }
+        errno = 0;
+        if (bind(nnetfd, reinterpret_cast<struct sockaddr*>(&addr), addr_len) < 0) {
+            tawqa_bail("Can't bind to %s", path);
+        }
+        return nnetfd;
+    }
+    
+    // An unbound datagram client can't be answered: autobind an abstract
+    // name so the listener has somewhere to send its replies
+    if (g_udp_mode) {
+        struct sockaddr_un local = {};
+        local.sun_family = AF_UNIX;
+        if (bind(nnetfd, reinterpret_cast<struct sockaddr*>(&local), sizeof(sa_family_t)) < 0) {
+            tawqa_bail("Can't autobind datagram socket");
+        }
+    }
+    
+    if (connect(nnetfd, reinterpret_cast<struct sockaddr*>(&addr), addr_len) < 0) {
+        tawqa_bail("Can't connect to %s", path);
+    }
+    return nnetfd;
+}
+
+// A datagram -U listener has no peer until someone writes to it: peek at
+// the first datagram and connect to its sender, so replies have a
+// destination and other senders are filtered out
+static void tawqa_unix_dgram_peer(tawqa_socket_t fd) {
+    struct sockaddr_un peer = {};
+    socklen_t peer_len = sizeof(peer);
+    char byte;
+    while (recvfrom(fd, &byte, 1, MSG_PEEK, reinterpret_cast<struct sockaddr*>(&peer), &peer_len) < 0) {
+        if (errno != EINTR) {
+            tawqa_bail("recvfrom failed");
+        }
+        tawqa_check_interrupt();
+    }
+    if (peer_len <= offsetof(struct sockaddr_un, sun_path)) {
+        errno = 0;
+        tawqa_holler("Sender's socket is unbound, nothing can be sent back");
+        return;
+    }
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&peer), peer_len) < 0) {
+        tawqa_bail("Can't connect to the sender");
+    }
+}
+
+// Accept one inbound connection on a listening socket
+static tawqa_socket_t tawqa_doaccept(tawqa_socket_t listenfd) {
+    struct sockaddr_storage client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    
+    int client_fd = accept(listenfd, 
+                          reinterpret_cast<struct sockaddr*>(&client_addr), 
+                          &client_len);
+    if (client_fd < 0) {
+        tawqa_bail("accept failed");
+    }
+    // Linux copies most options from the listener, other stacks do not
+    tawqa_sockopt_apply(client_fd, &g_sockopts, client_addr.ss_family == AF_INET);
+    
+    if (g_verbose && client_addr.ss_family == AF_UNIX) {
+        tawqa_holler("Connection on %s", g_unix_path);
+    } else if (g_verbose) {
+        const auto* sin = reinterpret_cast<const struct sockaddr_in*>(&client_addr);
+        static char port_str[16];
+        snprintf(port_str, sizeof(port_str), "%u", ntohs(sin->sin_port));
+        tawqa_holler("Connection from %s:%s", 
+                    inet_ntoa(sin->sin_addr), port_str);
+    }
+    
+    return client_fd;
+}
+
+// Convert a nanosecond delay to a select() timeout
+static struct timeval tawqa_ns_to_timeval(std::uint64_t ns) {
+    struct timeval tv;
+    tv.tv_sec = static_cast<time_t>(ns / 1000000000ULL);
+    tv.tv_usec = static_cast<suseconds_t>((ns % 1000000000ULL + 999) / 1000);
+    return tv;
+}
+
+// Network side of the relay, through the TLS session with --tls. Never
+// blocks: select() also wakes for --zerocopy completions, not only data.
+static ssize_t tawqa_net_recv(tawqa_socket_t netfd, char* buf, std::size_t len) {
+    if (g_tls.enabled) {
+        return tawqa_tls_recv(buf, len);
+    }
+    if (!g_udp_mode) {
+        return recv(netfd, buf, len, MSG_DONTWAIT);
+    }
+    // MSG_TRUNC returns a datagram's real length, so one cut short is
+    // reported instead of passing on only its head
+    ssize_t n = recv(netfd, buf, len, MSG_DONTWAIT | MSG_TRUNC);
+    if (n > static_cast<ssize_t>(len)) {
+        static char got_str[24], room_str[24];
+        snprintf(got_str, sizeof(got_str), "%zd", n);
+        snprintf(room_str, sizeof(room_str), "%zu", len);
+        errno = 0;
+        tawqa_holler("Datagram of %s bytes truncated to %s", got_str, room_str);
+        n = static_cast<ssize_t>(len);
+    }
+    return n;
+}
+
+static void tawqa_net_shutdown_wr(tawqa_socket_t netfd) {
+    if (g_tls.enabled) {
+        tawqa_tls_shutdown_wr();
+    }
+    shutdown(netfd, SHUT_WR);
+}
+
+// Length of the next paced line in buf[pos, end), or 0 while it is still
+// unterminated and `more` input may complete it. A line that fills the
+// whole buffer goes out as it is.
+static std::size_t tawqa_paced_line(const char* buf, std::size_t pos, std::size_t end,
+                                    std::size_t cap, bool more) {
+    if (pos == end) {
+        return 0;
+    }
+    std::size_t len = tawqa_findline(buf + pos, end - pos);
+    if (buf[pos + len - 1] == '\n' || !more || (pos == 0 && end == cap)) {
+        return len;
+    }
+    return 0;
+}
+
+// Push one chunk of input to the network and account for it
+static ssize_t tawqa_relay_send(tawqa_socket_t netfd, char* buf, std::size_t len, bool zerocopy) {
+    std::uint64_t start_ns = tawqa_now_ns();
+    ssize_t sent;
+    if (zerocopy) {
+        sent = tawqa_zc_send(netfd, buf, len) ? static_cast<ssize_t>(len) : -1;
+    } else if (g_verify) {
+        sent = tawqa_verify_send(netfd, buf, len) ? static_cast<ssize_t>(len) : -1;
+    } else if (g_tls.enabled) {
+        sent = tawqa_tls_send(buf, len);
+    } else {
+        // A SIGUSR1 snapshot can cut a blocking send short, finish it
+        std::size_t done = tawqa_writen(netfd, buf, len);
+        sent = done ? static_cast<ssize_t>(done) : -1;
+    }
+    if (sent > 0) {
+        tawqa_stats_write(TAWQA_STATS_SENT, sent, tawqa_now_ns() - start_ns);
+        if (g_ofd) {
+            tawqa_dump_commit('>', buf, sent);
+        }
+        if (g_record) {
+            tawqa_record_chunk(true, buf, sent);
+        }
+    }
+    return sent;
+}
+
 // Main network loop
 static void tawqa_readwrite(tawqa_socket_t netfd) {
     fd_set readfds;
-    int maxfd = std::max(netfd, STDIN_FILENO) + 1;
+    int maxfd = std::max(netfd, g_srcfd) + 1;
+    bool src_open = true;
+    bool net_open = true;
+    bool src_is_file = false;
+    bool net_shut = false;
+    std::uint64_t quit_ns = 0;
+
+    // Plain netcat stops at the first EOF; -N, the framed modes whose
+    // trailer the peer still has to send and one-way --resume transfers
+    // half-close and keep going. A --checkpoint listener only receives,
+    // so the sender's EOF ends it whatever its stdin does.
+    bool half_close = g_half_close || g_verify || g_compress.codec != TAWQA_CODEC_NONE || g_resume;
+
+    // --gen stands in for stdin and --discard for stdout, no fds involved
+    bool gen = g_gen.kind != TAWQA_GEN_NONE;
+    bool sink = g_discard && !g_ofd;
+
+    // -i / --lines-per-sec: input is held in g_bigbuf_in and released one
+    // line per tick; stdin is only read again once no whole line is left,
+    // and an unterminated tail waits for the rest of its line or for EOF
+    std::uint64_t line_ns = 0;
+    if (g_interval) {
+        line_ns = g_interval * 1000000000ULL;
+    } else if (g_lines_per_sec) {
+        line_ns = 1000000000ULL / g_lines_per_sec;
+    }
+    std::size_t line_pos = 0, line_end = 0;
+    std::uint64_t next_line_ns = 0;
+    bool line_eof = false; // stdin ended while a tail was held
+
+#ifdef TAWQA_HAVE_SENDFILE
+    // Regular files go straight from the page cache to the socket; under
+    // TLS only if the kernel does the encryption
+    struct stat src_st;
+    src_is_file = !gen && !g_udp_mode && !g_verify && !g_ofd && !g_record && !line_ns && fstat(g_srcfd, &src_st) == 0 && S_ISREG(src_st.st_mode);
+    src_is_file = src_is_file && (!g_tls.enabled || tawqa_tls_ktls_tx());
+#endif
+
+    // MSG_ZEROCOPY reads into a pool of larger buffers the kernel pins
+    // until it has sent them; g_bigbuf_in stays the copy path
+    bool zerocopy = g_zerocopy && !src_is_file;
+    if (zerocopy && !tawqa_zc_init(netfd)) {
+        tawqa_holler("SO_ZEROCOPY unavailable, copying sends");
+        zerocopy = false;
+    }
+    std::size_t in_size = zerocopy ? TAWQA_ZC_BUFSIZ : gen ? TAWQA_GEN_CHUNK : g_bigbuf_in.size();
+    std::size_t net_size = sink ? TAWQA_GEN_CHUNK : g_bigbuf_net.size();
+
+    // Per-direction throughput caps: "in" is net -> stdout, "out" is stdin -> net
+    tawqa_bucket bucket_in, bucket_out;
+    tawqa_bucket_init(&bucket_in, g_rate_in, net_size);
+    tawqa_bucket_init(&bucket_out, g_rate_out, in_size);
+
+    // Let the kernel spread outbound segments on the wire as well
+    if (g_rate_out && !tawqa_rate_set_pacing(netfd, g_rate_out)) {
+        tawqa_holler("SO_MAX_PACING_RATE unavailable, pacing in userspace only");
+    }
     
     while (true) {
+        tawqa_check_interrupt();
         FD_ZERO(&readfds);
-        FD_SET(netfd, &readfds);
-        FD_SET(STDIN_FILENO, &readfds);
+
+        // A drained bucket parks its direction until the refill is due
+        std::uint64_t now = tawqa_now_ns();
+        std::uint64_t wait_ns = 1000000000ULL; // 1 second timeout
+
+        // -w bounds how long we idle on the network once input is done
+        if (quit_ns) {
+            if (now >= quit_ns) {
+                break;
+            }
+            wait_ns = std::min(wait_ns, quit_ns - now);
+        }
+
+        if (gen || g_discard) {
+            wait_ns = std::min(wait_ns, tawqa_gen_report(now));
+        }
+        wait_ns = std::min(wait_ns, tawqa_stats_poll(now));
+
+        // Release the next buffered line once its tick is due
+        std::size_t line_len = tawqa_paced_line(g_bigbuf_in.data(), line_pos, line_end,
+                                                g_bigbuf_in.size(), !line_eof);
+        if (line_len && now >= next_line_ns) {
+            if (tawqa_relay_send(netfd, g_bigbuf_in.data() + line_pos, line_len, false) <= 0 && !net_open) {
+                break;
+            }
+            line_pos += line_len;
+            next_line_ns = now + line_ns;
+            line_len = tawqa_paced_line(g_bigbuf_in.data(), line_pos, line_end,
+                                        g_bigbuf_in.size(), !line_eof);
+        }
+
+        std::size_t room_in = tawqa_bucket_grant(&bucket_in, net_size, now);
+        std::size_t room_out = tawqa_bucket_grant(&bucket_out, in_size, now);
+
+        bool src_ready = false;
+
+        // Userspace TLS may already hold decrypted bytes select() can't see
+        bool net_pending = net_open && room_in && tawqa_tls_pending();
+        if (net_pending) {
+            wait_ns = 0;
+        }
+
+        if (!net_open) {
+            // peer half-closed, keep sending until our input is done
+        } else if (room_in) {
+            FD_SET(netfd, &readfds);
+        } else {
+            wait_ns = std::min(wait_ns, tawqa_bucket_delay_ns(&bucket_in));
+        }
+        if (!src_open) {
+            // input finished, only the network side is still live
+        } else if (line_len) {
+            wait_ns = std::min(wait_ns, next_line_ns > now ? next_line_ns - now : 0);
+        } else if (line_eof) {
+            src_ready = true; // tail sent, finish the EOF
+            wait_ns = 0;
+        } else if (room_out && gen) {
+            src_ready = true;
+            wait_ns = 0;
+        } else if (room_out && zerocopy && tawqa_zc_pinned(netfd)) {
+            // Completions make netfd readable; without a read side to
+            // watch, look again shortly instead of blocking both ways
+            if (!net_open || !room_in) {
+                wait_ns = std::min(wait_ns, TAWQA_ZC_RETRY_NS);
+            }
+        } else if (room_out) {
+            FD_SET(g_srcfd, &readfds);
+        } else {
+            wait_ns = std::min(wait_ns, tawqa_bucket_delay_ns(&bucket_out));
+        }
         
-        struct timeval timeout = {1, 0}; // 1 second timeout
+        struct timeval timeout = tawqa_ns_to_timeval(wait_ns);
         int ready = select(maxfd, &readfds, nullptr, nullptr, &timeout);
         
         if (ready < 0) {
-            if (errno == EINTR) continue;
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
             tawqa_bail("select failed");
         }
         
-        if (ready == 0) continue; // timeout
+        if (ready == 0 && !net_pending && !src_ready) continue; // timeout or refill
         
+        // With -o, read straight into a dump slot when one is free
+        char* netbuf = sink ? tawqa_discard_buffer() : g_bigbuf_net.data();
+        char* inbuf = g_bigbuf_in.data();
+
         // Handle network -> stdout
-        if (FD_ISSET(netfd, &readfds)) {
-            ssize_t bytes = recv(netfd, g_bigbuf_net.data(), g_bigbuf_net.size(), 0);
+        if (net_open && (net_pending || FD_ISSET(netfd, &readfds))) {
+            if (g_ofd) {
+                if (char* slot = tawqa_dump_acquire()) {
+                    netbuf = slot;
+                }
+            }
+            // A datagram is read whole, the bucket only decides when
+            ssize_t bytes = tawqa_net_recv(netfd, netbuf, g_udp_mode ? net_size : room_in);
+            tawqa_stats_read(TAWQA_STATS_RECV);
+            if (bytes < 0 && errno == EAGAIN) {
+                // Only TLS handshake records or send completions arrived
+                if (zerocopy) {
+                    tawqa_zc_poll(netfd);
+                }
+                continue;
+            }
             if (bytes <= 0) {
                 if (g_verbose) {
                     tawqa_holler("Network connection closed");
                 }
-                break;
+                if (g_udp_mode || !src_open || !half_close || g_checkpoint) {
+                    break;
+                }
+                net_open = false;
+                continue;
+            }
+            tawqa_bucket_consume(&bucket_in, bytes);
+            if (g_verify) {
+                // Framing and digests are consumed here, only payload goes on
+                bytes = tawqa_verify_recv(netfd, netbuf, bytes);
+                if (!src_open && !net_shut && tawqa_verify_tx_done()) {
+                    tawqa_net_shutdown_wr(netfd);
+                    net_shut = true;
+                }
+            }
+            if (quit_ns) {
+                quit_ns = tawqa_now_ns() + g_wait_time * 1000000000ULL;
             }
             
-            ssize_t written = write(STDOUT_FILENO, g_bigbuf_net.data(), bytes);
+            std::uint64_t write_ns = tawqa_now_ns();
+            ssize_t written = g_discard ? bytes : static_cast<ssize_t>(tawqa_writen(g_dstfd, netbuf, bytes));
+            if (g_discard && bytes > 0) {
+                tawqa_discard(netbuf, bytes);
+            }
+            if (g_ofd && bytes > 0) {
+                tawqa_dump_commit('<', netbuf, bytes);
+            }
+            if (g_record && bytes > 0) {
+                tawqa_record_chunk(false, netbuf, bytes);
+            }
             if (written > 0) {
-                g_wrote_out += written;
+                if (g_discard) {
+                    tawqa_stats_add(TAWQA_STATS_RECV, written);
+                } else {
+                    tawqa_stats_write(TAWQA_STATS_RECV, written, tawqa_now_ns() - write_ns);
+                }
+                if (g_checkpoint) {
+                    tawqa_resume_advance(written);
+                }
             }
         }
         
         // Handle stdin -> network
-        if (FD_ISSET(STDIN_FILENO, &readfds)) {
-            ssize_t bytes = read(STDIN_FILENO, g_bigbuf_in.data(), g_bigbuf_in.size());
+        if (src_open && (src_ready || FD_ISSET(g_srcfd, &readfds))) {
+            ssize_t bytes;
+#ifdef TAWQA_HAVE_SENDFILE
+            std::uint64_t send_ns = tawqa_now_ns();
+            if (src_is_file) {
+                if (g_tls.enabled) {
+                    bytes = tawqa_tls_sendfile(g_srcfd, room_out);
+                } else {
+                    bytes = sendfile(netfd, g_srcfd, nullptr, room_out);
+                }
+                if (bytes < 0) {
+                    tawqa_check_interrupt();
+                    if (errno == EINTR || errno == EAGAIN) continue;
+                    tawqa_holler("sendfile failed");
+                    break;
+                }
+            } else
+#endif
+            {
+                // Paced lines stay buffered across ticks, keep them off the ring
+                if (zerocopy) {
+                    inbuf = tawqa_zc_acquire(netfd);
+                    if (!inbuf) {
+                        continue; // every buffer still in flight
+                    }
+                } else if (g_ofd && !line_ns) {
+                    if (char* slot = tawqa_dump_acquire()) {
+                        inbuf = slot;
+                    }
+                } else if (line_ns) {
+                    // Keep the unterminated tail and read the rest of its line after it
+                    std::memmove(inbuf, inbuf + line_pos, line_end - line_pos);
+                    line_end -= line_pos;
+                    line_pos = 0;
+                    inbuf += line_end;
+                    room_out = std::min(room_out, g_bigbuf_in.size() - line_end);
+                }
+                if (gen) {
+                    bytes = static_cast<ssize_t>(tawqa_gen_next(&inbuf, room_out));
+                } else if (line_eof) {
+                    bytes = 0;
+                } else {
+                    bytes = read(g_srcfd, inbuf, room_out);
+                    tawqa_stats_read(TAWQA_STATS_SENT);
+                }
+            }
+            if (bytes <= 0 && line_end > line_pos) {
+                line_eof = true; // the tail goes out as the last line first
+                continue;
+            }
             if (bytes <= 0) {
                 if (g_verbose) {
-                    tawqa_holler("stdin closed");
+                    tawqa_holler(gen ? "Generator done" : "stdin closed");
                 }
-                break;
+                if ((g_udp_mode && !g_listen) || !net_open) {
+                    break;
+                }
+                // A datagram listener keeps receiving after its input ends
+                if (g_udp_mode) {
+                    src_open = false;
+                    if (g_wait_time) {
+                        quit_ns = tawqa_now_ns() + g_wait_time * 1000000000ULL;
+                    }
+                    continue;
+                }
+                if (!half_close) {
+                    break;
+                }
+                // Half-close so the peer sees EOF, then drain its reply;
+                // with --verify our digest goes first and the peer's
+                // verdict must be sent before the write side can close
+                if (g_verify) {
+                    tawqa_verify_end(netfd);
+                }
+                if (!g_verify || tawqa_verify_tx_done()) {
+                    tawqa_net_shutdown_wr(netfd);
+                    net_shut = true;
+                }
+                src_open = false;
+                if (g_wait_time) {
+                    quit_ns = tawqa_now_ns() + g_wait_time * 1000000000ULL;
+                }
+                continue;
+            }
+            tawqa_bucket_consume(&bucket_out, bytes);
+#ifdef TAWQA_HAVE_SENDFILE
+            if (src_is_file) {
+                tawqa_stats_write(TAWQA_STATS_SENT, bytes, tawqa_now_ns() - send_ns);
+                continue;
+            }
+#endif
+            if (line_ns) {
+                line_end += static_cast<std::size_t>(bytes);
+                continue;
             }
             
-            ssize_t sent = send(netfd, g_bigbuf_in.data(), bytes, 0);
-            if (sent > 0) {
-                g_wrote_net += sent;
+            if (tawqa_relay_send(netfd, inbuf, bytes, zerocopy) <= 0 && !net_open) {
+                break; // peer is gone in both directions
             }
         }
     }
+
+    if (zerocopy) {
+        tawqa_zc_finish(netfd);
+    }
+}
+
+// Load generator connections, all to the one target
+static int tawqa_load_connect() {
+    return tawqa_doconnect(&g_load_addr, g_load_port, nullptr, 0, true);
 }
 
 // Help text
@@ -361,23 +963,218 @@ static void tawqa_help() {
     printf("  -v          Verbose [use twice to be more verbose]\n");
     printf("  -w secs     Timeout for connects and final net reads\n");
     printf("  -z          Zero-I/O mode [used for scanning]\n");
+    printf("  -N          Half-close at stdin EOF and read until the peer closes\n");
     printf("  -n          Numeric-only IP addresses, no DNS\n");
+    printf("  -U path     Unix domain socket instead of TCP/UDP [@name: abstract]\n");
+    printf("  -o file     Hex dump of traffic [written by a background thread]\n");
     printf("  -h          This help text\n");
+    printf("  -i secs     Delay interval for lines sent\n");
+    printf("  --rate-in rate   Cap network -> stdout throughput\n");
+    printf("  --rate-out rate  Cap stdin -> network throughput (also kernel pacing)\n");
+    printf("  --compress codec Framed lz4 or zstd[:level] stream, same codec on both peers\n");
+    printf("                   [built only with make LZ4=1 and/or ZSTD=1]\n");
+    printf("  --streams n      Stripe stdin over n connections to a listener using the same n\n");
+    printf("  --resume         Continue an interrupted transfer from the listener's offset\n");
+    printf("  --checkpoint f   Listener: record durable progress in f (implies --resume)\n");
+    printf("                   [stdout must keep its data: >> file or 1<> file, not > file]\n");
+    printf("  --verify algo    Hash both directions inline (crc32c, xxh64), compare at EOF\n");
+    printf("  --lines-per-sec n  Send stdin one line at a time, n lines per second\n");
+    printf("  --sndbuf n       SO_SNDBUF size in bytes\n");
+    printf("  --rcvbuf n       SO_RCVBUF size in bytes\n");
+    printf("  --nodelay        Disable Nagle (TCP_NODELAY)\n");
+    printf("  --cork           Send only full segments (TCP_CORK)\n");
+    printf("  --notsent-lowat n  Cap unsent bytes queued in the kernel\n");
+    printf("  --congestion cc  TCP congestion control, e.g. bbr or cubic\n");
+    printf("  --keepalive i[,n[,c]]  Keepalive idle/interval secs and probe count\n");
+    printf("  --user-timeout ms  Drop the connection after ms of unacked data\n");
+    printf("  --profile p      Preset: bulk, interactive or lowlat [explicit options win]\n");
+    printf("  --zerocopy       Send stdin with MSG_ZEROCOPY from a pinned buffer pool\n");
+    printf("  --forward h:p    Listener: splice every accepted connection to h:p\n");
+    printf("  --broadcast      Listener: send stdin [or the --forward source] to all clients\n");
+    printf("  --lag-limit n    Bytes a broadcast client may fall behind [default 4M]\n");
+    printf("  --slow policy    Lagging broadcast client: drop [oldest data] or disconnect\n");
+    printf("  --merge          Listener: write all clients' data to stdout in whole lines\n");
+    printf("  --merge-prefix   Start merged lines with a UTC timestamp and the peer\n");
+    printf("  --fastopen       TCP Fast Open: send the first data in the SYN, if input is\n");
+    printf("                   already waiting at connect time\n");
+    printf("  --out file       Write received data to file with O_DIRECT, bypassing the page cache\n");
+    printf("  --prealloc n     Reserve n bytes for --out up front (K/M/G suffix)\n");
+    printf("  --record file    Capture both directions with timestamps for --replay\n");
+    printf("  --replay file    Send the client side of a recording instead of stdin\n");
+    printf("  --replay-speed x Replay pace: 1 recorded, 2 twice as fast, 0 flat out\n");
+    printf("  --load n         Load test: n concurrent connections, report every second\n");
+    printf("  --load-threads t Event loop threads for --load [default: one per CPU]\n");
+    printf("  --load-time s    Length of the --load run [default: 10]\n");
+    printf("  --load-size n    Generated write or request size [default: 16K]\n");
+    printf("  --load-file f    Send the contents of f instead of generated bytes\n");
+    printf("  --load-delim c   Request/response: wait for c after each request\n");
+    printf("  --echo           Listener: send every client's data straight back\n");
+    printf("  --rtt n          Time n ping-pongs against an --echo listener\n");
+    printf("  --rtt-size list  Message sizes: 64, 64,1K or a doubling range 64-64K\n");
+    printf("  --rtt-warmup n   Untimed round trips before each size [default: 1000]\n");
+    printf("  --gen src        Send from memory instead of stdin: zero, pattern or file:path\n");
+    printf("  --gen-bytes n    Stop --gen after n bytes (K/M/G suffix) [default: never]\n");
+    printf("  --discard        Drop received data instead of writing stdout\n");
+    printf("  --discard-verify Drop received data after checking it against --gen pattern\n");
+    printf("  --metrics dest   Export metrics to a file, or serve them on unix:path\n");
+    printf("  --metrics-format f  prom [default] or json\n");
+    printf("  --metrics-interval s  Seconds between --metrics file rewrites [default 5]\n");
+    printf("  --mcast group    UDP multicast on -p port: join with -l, else send stdin\n");
+    printf("  --mcast-source s Source-specific join, only datagrams from s\n");
+    printf("  --mcast-ttl n    Hop limit of sent datagrams [default: 1]\n");
+    printf("  --mcast-loop 0|1 Deliver sent datagrams to local receivers\n");
+    printf("  --mcast-if i     Interface name, index or address to join on or send from\n");
+    printf("  --tls            Encrypt with TLS, records offloaded to kernel TLS if possible\n");
+    printf("  --tls-cert f     PEM certificate chain [required when listening]\n");
+    printf("  --tls-key f      PEM private key [default: the --tls-cert file]\n");
+    printf("  --tls-ca f       Verify the peer against this CA bundle [default: system store]\n");
     printf("\n");
     printf("Port numbers can be individual or ranges: lo-hi [inclusive]\n");
+    printf("Rates are bytes/sec with optional K/M/G suffix; append 'b' for bits (10Gb)\n");
+    printf("Sizes and byte counts take K/M/G as 1024, 1024^2, 1024^3 (4M = 4194304)\n");
+    printf("SIGUSR1 prints relay statistics without stopping; -v prints them in full at exit\n");
+    printf("Listener, fan-out, proxy, multicast and striped modes ignore SIGUSR1\n");
 }
 
+// Long-only options
+enum tawqa_long_opt {
+    TAWQA_OPT_RATE_IN = 256,
+    TAWQA_OPT_RATE_OUT,
+    TAWQA_OPT_COMPRESS,
+    TAWQA_OPT_STREAMS,
+    TAWQA_OPT_RESUME,
+    TAWQA_OPT_CHECKPOINT,
+    TAWQA_OPT_VERIFY,
+    TAWQA_OPT_LINES_PER_SEC,
+    TAWQA_OPT_SNDBUF,
+    TAWQA_OPT_RCVBUF,
+    TAWQA_OPT_NODELAY,
+    TAWQA_OPT_CORK,
+    TAWQA_OPT_NOTSENT_LOWAT,
+    TAWQA_OPT_CONGESTION,
+    TAWQA_OPT_KEEPALIVE,
+    TAWQA_OPT_USER_TIMEOUT,
+    TAWQA_OPT_PROFILE,
+    TAWQA_OPT_ZEROCOPY,
+    TAWQA_OPT_FORWARD,
+    TAWQA_OPT_BROADCAST,
+    TAWQA_OPT_LAG_LIMIT,
+    TAWQA_OPT_SLOW,
+    TAWQA_OPT_MERGE,
+    TAWQA_OPT_MERGE_PREFIX,
+    TAWQA_OPT_FASTOPEN,
+    TAWQA_OPT_OUT,
+    TAWQA_OPT_PREALLOC,
+    TAWQA_OPT_RECORD,
+    TAWQA_OPT_REPLAY,
+    TAWQA_OPT_REPLAY_SPEED,
+    TAWQA_OPT_LOAD,
+    TAWQA_OPT_LOAD_THREADS,
+    TAWQA_OPT_LOAD_TIME,
+    TAWQA_OPT_LOAD_SIZE,
+    TAWQA_OPT_LOAD_FILE,
+    TAWQA_OPT_LOAD_DELIM,
+    TAWQA_OPT_ECHO,
+    TAWQA_OPT_RTT,
+    TAWQA_OPT_RTT_SIZE,
+    TAWQA_OPT_RTT_WARMUP,
+    TAWQA_OPT_GEN,
+    TAWQA_OPT_GEN_BYTES,
+    TAWQA_OPT_DISCARD,
+    TAWQA_OPT_DISCARD_VERIFY,
+    TAWQA_OPT_METRICS,
+    TAWQA_OPT_METRICS_FORMAT,
+    TAWQA_OPT_METRICS_INTERVAL,
+    TAWQA_OPT_MCAST,
+    TAWQA_OPT_MCAST_SOURCE,
+    TAWQA_OPT_MCAST_TTL,
+    TAWQA_OPT_MCAST_LOOP,
+    TAWQA_OPT_MCAST_IF,
+    TAWQA_OPT_TLS,
+    TAWQA_OPT_TLS_CERT,
+    TAWQA_OPT_TLS_KEY,
+    TAWQA_OPT_TLS_CA,
+};
+
+static const tawqa::Option g_long_options[] = {
+    {"rate-in", true, nullptr, TAWQA_OPT_RATE_IN},
+    {"rate-out", true, nullptr, TAWQA_OPT_RATE_OUT},
+    {"compress", true, nullptr, TAWQA_OPT_COMPRESS},
+    {"streams", true, nullptr, TAWQA_OPT_STREAMS},
+    {"resume", false, nullptr, TAWQA_OPT_RESUME},
+    {"checkpoint", true, nullptr, TAWQA_OPT_CHECKPOINT},
+    {"verify", true, nullptr, TAWQA_OPT_VERIFY},
+    {"lines-per-sec", true, nullptr, TAWQA_OPT_LINES_PER_SEC},
+    {"sndbuf", true, nullptr, TAWQA_OPT_SNDBUF},
+    {"rcvbuf", true, nullptr, TAWQA_OPT_RCVBUF},
+    {"nodelay", false, nullptr, TAWQA_OPT_NODELAY},
+    {"cork", false, nullptr, TAWQA_OPT_CORK},
+    {"notsent-lowat", true, nullptr, TAWQA_OPT_NOTSENT_LOWAT},
+    {"congestion", true, nullptr, TAWQA_OPT_CONGESTION},
+    {"keepalive", true, nullptr, TAWQA_OPT_KEEPALIVE},
+    {"user-timeout", true, nullptr, TAWQA_OPT_USER_TIMEOUT},
+    {"profile", true, nullptr, TAWQA_OPT_PROFILE},
+    {"zerocopy", false, nullptr, TAWQA_OPT_ZEROCOPY},
+    {"forward", true, nullptr, TAWQA_OPT_FORWARD},
+    {"broadcast", false, nullptr, TAWQA_OPT_BROADCAST},
+    {"lag-limit", true, nullptr, TAWQA_OPT_LAG_LIMIT},
+    {"slow", true, nullptr, TAWQA_OPT_SLOW},
+    {"merge", false, nullptr, TAWQA_OPT_MERGE},
+    {"merge-prefix", false, nullptr, TAWQA_OPT_MERGE_PREFIX},
+    {"fastopen", false, nullptr, TAWQA_OPT_FASTOPEN},
+    {"out", true, nullptr, TAWQA_OPT_OUT},
+    {"prealloc", true, nullptr, TAWQA_OPT_PREALLOC},
+    {"record", true, nullptr, TAWQA_OPT_RECORD},
+    {"replay", true, nullptr, TAWQA_OPT_REPLAY},
+    {"replay-speed", true, nullptr, TAWQA_OPT_REPLAY_SPEED},
+    {"load", true, nullptr, TAWQA_OPT_LOAD},
+    {"load-threads", true, nullptr, TAWQA_OPT_LOAD_THREADS},
+    {"load-time", true, nullptr, TAWQA_OPT_LOAD_TIME},
+    {"load-size", true, nullptr, TAWQA_OPT_LOAD_SIZE},
+    {"load-file", true, nullptr, TAWQA_OPT_LOAD_FILE},
+    {"load-delim", true, nullptr, TAWQA_OPT_LOAD_DELIM},
+    {"echo", false, nullptr, TAWQA_OPT_ECHO},
+    {"rtt", true, nullptr, TAWQA_OPT_RTT},
+    {"rtt-size", true, nullptr, TAWQA_OPT_RTT_SIZE},
+    {"rtt-warmup", true, nullptr, TAWQA_OPT_RTT_WARMUP},
+    {"gen", true, nullptr, TAWQA_OPT_GEN},
+    {"gen-bytes", true, nullptr, TAWQA_OPT_GEN_BYTES},
+    {"discard", false, nullptr, TAWQA_OPT_DISCARD},
+    {"discard-verify", false, nullptr, TAWQA_OPT_DISCARD_VERIFY},
+    {"metrics", true, nullptr, TAWQA_OPT_METRICS},
+    {"metrics-format", true, nullptr, TAWQA_OPT_METRICS_FORMAT},
+    {"metrics-interval", true, nullptr, TAWQA_OPT_METRICS_INTERVAL},
+    {"mcast", true, nullptr, TAWQA_OPT_MCAST},
+    {"mcast-source", true, nullptr, TAWQA_OPT_MCAST_SOURCE},
+    {"mcast-ttl", true, nullptr, TAWQA_OPT_MCAST_TTL},
+    {"mcast-loop", true, nullptr, TAWQA_OPT_MCAST_LOOP},
+    {"mcast-if", true, nullptr, TAWQA_OPT_MCAST_IF},
+    {"tls", false, nullptr, TAWQA_OPT_TLS},
+    {"tls-cert", true, nullptr, TAWQA_OPT_TLS_CERT},
+    {"tls-key", true, nullptr, TAWQA_OPT_TLS_KEY},
+    {"tls-ca", true, nullptr, TAWQA_OPT_TLS_CA},
+    {"help", false, nullptr, 'h'},
+    {},
+};
+
 // Main function
 int main(int argc, char* argv[]) {
-    std::signal(SIGINT, tawqa_catch_signal);
-    std::signal(SIGTERM, tawqa_catch_signal);
+    // No SA_RESTART: a blocked call returns EINTR and its loop sees the flag
+    struct sigaction sa = {};
+    sa.sa_handler = tawqa_catch_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    tawqa_stats_install();
     
     // Parse command line options
     int opt;
     tawqa_port_t local_port = 0;
     const char* program_path = nullptr;
+    const char* profile = nullptr;
     
-    while ((opt = tawqa_getopt(argc, argv, "lp:uvw:znhe:")) != -1) {
+    while ((opt = tawqa_getopt_long(argc, argv, "lp:uvw:znNhe:o:i:U:",
+                                    g_long_options, nullptr)) != -1) {
         switch (opt) {
             case 'l':
                 g_listen = true;
@@ -400,21 +1197,444 @@ int main(int argc, char* argv[]) {
             case 'n':
                 g_numeric = true;
                 break;
+            case 'N':
+                g_half_close = true;
+                break;
             case 'h':
                 tawqa_help();
                 return 0;
+            case 'i':
+                g_interval = static_cast<std::uint32_t>(std::atoi(optarg));
+                if (!g_interval) {
+                    tawqa_bail("Invalid interval %s", optarg);
+                }
+                break;
+            case 'U':
+                g_unix_path = optarg;
+                break;
+            case 'o':
+                g_ofd = open(optarg, O_WRONLY | O_CREAT | O_TRUNC, 0664);
+                if (g_ofd < 0) {
+                    tawqa_bail("Can't open %s", optarg);
+                }
+                break;
             case 'e':
                 program_path = optarg;
                 tawqa_set_program_path(program_path);
                 break;
+            case TAWQA_OPT_RATE_IN:
+            case TAWQA_OPT_RATE_OUT: {
+                std::uint64_t rate = tawqa_parse_rate(optarg);
+                if (!rate) {
+                    tawqa_bail("Invalid rate %s", optarg);
+                }
+                (opt == TAWQA_OPT_RATE_IN ? g_rate_in : g_rate_out) = rate;
+                break;
+            }
+            case TAWQA_OPT_COMPRESS:
+                if (!tawqa_compress_parse(optarg, &g_compress)) {
+                    tawqa_bail("Unknown codec %s, or not built in (make LZ4=1 ZSTD=1)", optarg);
+                }
+                break;
+            case TAWQA_OPT_STREAMS: {
+                int streams = std::atoi(optarg);
+                if (streams < 1 || static_cast<std::size_t>(streams) > TAWQA_STRIPE_MAX_STREAMS) {
+                    tawqa_bail("Invalid stream count %s", optarg);
+                }
+                g_streams = static_cast<std::size_t>(streams);
+                break;
+            }
+            case TAWQA_OPT_RESUME:
+                g_resume = true;
+                break;
+            case TAWQA_OPT_CHECKPOINT:
+                g_checkpoint = optarg;
+                g_resume = true;
+                break;
+            case TAWQA_OPT_VERIFY:
+                if (!tawqa_hash_parse(optarg, &g_verify)) {
+                    tawqa_bail("Unknown hash %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_LINES_PER_SEC: {
+                int lines = std::atoi(optarg);
+                if (lines < 1) {
+                    tawqa_bail("Invalid line rate %s", optarg);
+                }
+                g_lines_per_sec = static_cast<std::uint32_t>(lines);
+                break;
+            }
+            case TAWQA_OPT_SNDBUF:
+            case TAWQA_OPT_RCVBUF:
+            case TAWQA_OPT_NOTSENT_LOWAT:
+            case TAWQA_OPT_USER_TIMEOUT: {
+                int value = std::atoi(optarg);
+                if (value < 1) {
+                    tawqa_bail("Invalid socket option value %s", optarg);
+                }
+                if (opt == TAWQA_OPT_SNDBUF) {
+                    g_sockopts.sndbuf = value;
+                } else if (opt == TAWQA_OPT_RCVBUF) {
+                    g_sockopts.rcvbuf = value;
+                } else if (opt == TAWQA_OPT_NOTSENT_LOWAT) {
+                    g_sockopts.notsent_lowat = value;
+                } else {
+                    g_sockopts.user_timeout = value;
+                }
+                break;
+            }
+            case TAWQA_OPT_NODELAY:
+                g_sockopts.nodelay = 1;
+                break;
+            case TAWQA_OPT_CORK:
+                g_sockopts.cork = 1;
+                break;
+            case TAWQA_OPT_CONGESTION:
+                g_sockopts.congestion = optarg;
+                break;
+            case TAWQA_OPT_KEEPALIVE:
+                if (!tawqa_sockopt_parse_keepalive(optarg, &g_sockopts)) {
+                    tawqa_bail("Invalid keepalive %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_PROFILE:
+                profile = optarg;
+                break;
+            case TAWQA_OPT_ZEROCOPY:
+                g_zerocopy = true;
+                break;
+            case TAWQA_OPT_FORWARD:
+                g_forward = optarg;
+                break;
+            case TAWQA_OPT_BROADCAST:
+                g_broadcast = true;
+                break;
+            case TAWQA_OPT_LAG_LIMIT: {
+                std::uint64_t limit = tawqa_parse_size(optarg);
+                if (!limit) {
+                    tawqa_bail("Invalid lag limit %s", optarg);
+                }
+                g_broadcast_opts.lag_limit = static_cast<std::size_t>(limit);
+                break;
+            }
+            case TAWQA_OPT_SLOW:
+                if (!tawqa_broadcast_parse_slow(optarg, &g_broadcast_opts.slow)) {
+                    tawqa_bail("Unknown slow client policy %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_MERGE:
+                g_merge = true;
+                break;
+            case TAWQA_OPT_MERGE_PREFIX:
+                g_merge = true;
+                g_merge_prefix = true;
+                break;
+            case TAWQA_OPT_FASTOPEN:
+                g_fastopen = true;
+                break;
+            case TAWQA_OPT_OUT:
+                g_out_path = optarg;
+                break;
+            case TAWQA_OPT_PREALLOC:
+                g_prealloc = tawqa_parse_size(optarg);
+                if (!g_prealloc) {
+                    tawqa_bail("Invalid preallocation %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_RECORD:
+                g_record = optarg;
+                break;
+            case TAWQA_OPT_REPLAY:
+                g_replay = optarg;
+                break;
+            case TAWQA_OPT_REPLAY_SPEED: {
+                char* end = nullptr;
+                g_replay_speed = std::strtod(optarg, &end);
+                if (end == optarg || *end || g_replay_speed < 0) {
+                    tawqa_bail("Invalid replay speed %s", optarg);
+                }
+                break;
+            }
+            case TAWQA_OPT_LOAD:
+                g_load.conns = static_cast<std::size_t>(std::atol(optarg));
+                if (!g_load.conns) {
+                    tawqa_bail("Invalid connection count %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_LOAD_THREADS:
+                g_load.threads = static_cast<std::size_t>(std::atol(optarg));
+                break;
+            case TAWQA_OPT_LOAD_TIME:
+                g_load.secs = static_cast<unsigned>(std::atoi(optarg));
+                if (!g_load.secs) {
+                    tawqa_bail("Invalid load time %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_LOAD_SIZE:
+                g_load.size = static_cast<std::size_t>(tawqa_parse_size(optarg));
+                if (!g_load.size) {
+                    tawqa_bail("Invalid load size %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_LOAD_FILE:
+                g_load.file = optarg;
+                break;
+            case TAWQA_OPT_LOAD_DELIM:
+                // One character; \n, \r, \t and \0 spelled out
+                if (optarg[0] == '\\' && optarg[1] && !optarg[2]) {
+                    switch (optarg[1]) {
+                        case 'n': g_load.delim = '\n'; break;
+                        case 'r': g_load.delim = '\r'; break;
+                        case 't': g_load.delim = '\t'; break;
+                        case '0': g_load.delim = 0; break;
+                        default: tawqa_bail("Unknown delimiter escape %s", optarg);
+                    }
+                } else if (optarg[0] && !optarg[1]) {
+                    g_load.delim = static_cast<unsigned char>(optarg[0]);
+                } else {
+                    tawqa_bail("Delimiter must be one character: %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_ECHO:
+                g_echo = true;
+                break;
+            case TAWQA_OPT_RTT:
+                g_rtt.count = static_cast<std::size_t>(std::atol(optarg));
+                if (!g_rtt.count) {
+                    tawqa_bail("Invalid round trip count %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_RTT_SIZE:
+                g_rtt.sizes = optarg;
+                break;
+            case TAWQA_OPT_RTT_WARMUP:
+                g_rtt.warmup = static_cast<std::size_t>(std::atol(optarg));
+                break;
+            case TAWQA_OPT_GEN:
+                if (!tawqa_gen_parse(optarg, &g_gen)) {
+                    tawqa_bail("Unknown generator %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_GEN_BYTES:
+                g_gen.limit = tawqa_parse_size(optarg);
+                if (!g_gen.limit) {
+                    tawqa_bail("Invalid byte count %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_DISCARD:
+                g_discard = true;
+                break;
+            case TAWQA_OPT_DISCARD_VERIFY:
+                g_discard = true;
+                g_discard_verify = true;
+                break;
+            case TAWQA_OPT_METRICS:
+                g_metrics = optarg;
+                break;
+            case TAWQA_OPT_METRICS_FORMAT:
+                if (!tawqa_metrics_parse_format(optarg, &g_metrics_format)) {
+                    tawqa_bail("Unknown metrics format %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_METRICS_INTERVAL:
+                g_metrics_interval = static_cast<unsigned>(std::atoi(optarg));
+                if (!g_metrics_interval) {
+                    tawqa_bail("Invalid metrics interval %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_MCAST:
+                g_mcast.group = optarg;
+                g_udp_mode = true;
+                break;
+            case TAWQA_OPT_MCAST_SOURCE:
+                g_mcast.source = optarg;
+                break;
+            case TAWQA_OPT_MCAST_TTL:
+                g_mcast.ttl = std::atoi(optarg);
+                if (g_mcast.ttl < 0 || g_mcast.ttl > 255) {
+                    tawqa_bail("Invalid multicast TTL %s", optarg);
+                }
+                break;
+            case TAWQA_OPT_MCAST_LOOP:
+                g_mcast.loop = std::atoi(optarg) ? 1 : 0;
+                break;
+            case TAWQA_OPT_MCAST_IF:
+                g_mcast.iface = optarg;
+                break;
+            case TAWQA_OPT_TLS:
+                if (!tawqa_tls_supported()) {
+                    tawqa_bail("Built without TLS support (make OPENSSL=1)");
+                }
+                g_tls.enabled = true;
+                break;
+            case TAWQA_OPT_TLS_CERT:
+                g_tls.cert = optarg;
+                break;
+            case TAWQA_OPT_TLS_KEY:
+                g_tls.key = optarg;
+                break;
+            case TAWQA_OPT_TLS_CA:
+                g_tls.ca = optarg;
+                break;
             default:
                 tawqa_help();
                 return 1;
         }
     }
     
+    if (g_sockopts.nodelay == 1 && g_sockopts.cork == 1) {
+        tawqa_bail("--nodelay and --cork pull in opposite directions");
+    }
+    if (profile && !tawqa_sockopt_profile(profile, &g_sockopts)) {
+        tawqa_bail("Unknown profile %s", profile);
+    }
+    if (g_compress.codec != TAWQA_CODEC_NONE && g_udp_mode) {
+        tawqa_bail("--compress needs a TCP stream");
+    }
+    if (g_streams > 1 && g_udp_mode) {
+        tawqa_bail("--streams needs a TCP stream");
+    }
+    if (g_streams > 1 && (g_rate_in || g_rate_out)) {
+        tawqa_bail("--rate-in/--rate-out shape a single stream, not --streams");
+    }
+    if (g_resume && (g_udp_mode || g_streams > 1 || g_compress.codec != TAWQA_CODEC_NONE)) {
+        tawqa_bail("--resume works on a single plain TCP stream");
+    }
+    if (g_verify && (g_udp_mode || g_streams > 1 || g_resume)) {
+        tawqa_bail("--verify works on a single TCP stream without --resume");
+    }
+    if ((g_interval || g_lines_per_sec) && (g_streams > 1 || g_compress.codec != TAWQA_CODEC_NONE)) {
+        tawqa_bail("Line pacing needs a single uncompressed stream");
+    }
+    if (g_zerocopy && (g_udp_mode || g_streams > 1 || g_verify || g_interval || g_lines_per_sec)) {
+        tawqa_bail("--zerocopy needs a plain single TCP stream");
+    }
+    if (g_tls.enabled && (g_udp_mode || g_streams > 1 || g_resume || g_verify || g_zerocopy || program_path)) {
+        tawqa_bail("--tls works on a single TCP stream without --resume, --verify, --zerocopy or -e");
+    }
+    if (g_unix_path && (g_streams > 1 || g_fastopen)) {
+        tawqa_bail("-U doesn't combine with --streams or --fastopen");
+    }
+    if (g_unix_path && g_udp_mode && (g_tls.enabled || g_resume || g_verify || g_compress.codec != TAWQA_CODEC_NONE)) {
+        tawqa_bail("-U -u is a plain datagram transport");
+    }
+    if (g_merge && (g_forward || g_broadcast)) {
+        tawqa_bail("--merge can't be combined with --forward or --broadcast");
+    }
+    if (g_echo && (g_forward || g_broadcast || g_merge)) {
+        tawqa_bail("--echo can't be combined with another listener mode");
+    }
+    if ((g_forward || g_broadcast || g_merge || g_echo) && (!g_listen || g_udp_mode || program_path || g_zero_io)) {
+        tawqa_bail("--forward, --broadcast, --merge and --echo need a TCP or Unix stream listener");
+    }
+    if ((g_forward || g_broadcast || g_merge || g_echo) && (g_streams > 1 || g_resume || g_verify || g_tls.enabled || g_ofd || g_zerocopy ||
+                      g_compress.codec != TAWQA_CODEC_NONE || g_interval || g_lines_per_sec ||
+                      g_rate_in || g_rate_out)) {
+        tawqa_bail("--forward, --broadcast, --merge and --echo relay raw bytes, stream options don't apply");
+    }
+    if (g_tls.enabled && g_listen && !g_tls.cert) {
+        tawqa_bail("Listening with --tls needs --tls-cert");
+    }
+    if (g_ofd && g_streams > 1) {
+        tawqa_bail("-o can't capture a striped transfer");
+    }
+    if (g_resume && g_listen && !g_checkpoint) {
+        tawqa_bail("Listening with --resume needs --checkpoint file");
+    }
+    if ((g_mcast.source || g_mcast.ttl >= 0 || g_mcast.loop >= 0 || g_mcast.iface) && !g_mcast.group) {
+        tawqa_bail("--mcast-* options need --mcast group");
+    }
+    if (g_mcast.group && (g_unix_path || program_path || g_zero_io || g_ofd || g_verify || g_tls.enabled ||
+                          g_interval || g_lines_per_sec || g_merge || g_broadcast || g_forward ||
+                          g_rate_in || g_rate_out || g_compress.codec != TAWQA_CODEC_NONE || g_resume ||
+                          g_zerocopy || g_fastopen)) {
+        tawqa_bail("--mcast is a plain datagram feed, stream options don't apply");
+    }
+    if (g_mcast.group && !local_port) {
+        tawqa_bail("--mcast needs the group port in -p");
+    }
+    if ((g_record || g_replay) && (g_streams > 1 || g_compress.codec != TAWQA_CODEC_NONE || g_mcast.group ||
+                                   program_path || g_zero_io || g_forward || g_broadcast || g_merge || g_echo)) {
+        tawqa_bail("--record and --replay work on a single plain session");
+    }
+    if (g_replay && (g_listen || g_resume || g_interval || g_lines_per_sec)) {
+        tawqa_bail("--replay drives the connecting side at its recorded pace");
+    }
+    if (!g_load.conns && (g_load.threads || g_load.file || g_load.delim >= 0)) {
+        tawqa_bail("--load-* options need --load n");
+    }
+    if (g_load.conns && (g_listen || g_udp_mode || g_unix_path || program_path || g_zero_io || g_streams > 1 ||
+                         g_resume || g_verify || g_tls.enabled || g_ofd || g_zerocopy || g_record || g_replay ||
+                         g_out_path || g_mcast.group || g_compress.codec != TAWQA_CODEC_NONE ||
+                         g_interval || g_lines_per_sec || g_rate_in || g_rate_out || g_fastopen)) {
+        // --fastopen too: the handshake would hide behind the first write
+        // and the connect latency would read as nothing
+        tawqa_bail("--load drives plain TCP connections, only socket options apply");
+    }
+    if (g_rtt.count && (g_listen || g_udp_mode || program_path || g_zero_io || g_streams > 1 || g_resume ||
+                        g_verify || g_tls.enabled || g_ofd || g_zerocopy || g_record || g_replay || g_out_path ||
+                        g_load.conns || g_compress.codec != TAWQA_CODEC_NONE || g_interval || g_lines_per_sec ||
+                        g_rate_in || g_rate_out)) {
+        tawqa_bail("--rtt ping-pongs on a plain stream connection");
+    }
+    if (g_gen.limit && g_gen.kind == TAWQA_GEN_NONE) {
+        tawqa_bail("--gen-bytes needs --gen");
+    }
+    if ((g_gen.kind != TAWQA_GEN_NONE || g_discard) &&
+        (program_path || g_zero_io || g_streams > 1 || g_resume || g_compress.codec != TAWQA_CODEC_NONE ||
+         g_record || g_replay || g_load.conns || g_rtt.count || g_mcast.group ||
+         g_forward || g_broadcast || g_merge || g_echo)) {
+        tawqa_bail("--gen and --discard plug into a single plain relay");
+    }
+    if (g_gen.kind != TAWQA_GEN_NONE && (g_udp_mode || g_zerocopy || g_interval || g_lines_per_sec)) {
+        tawqa_bail("--gen streams large chunks over TCP without --zerocopy or line pacing");
+    }
+    if (g_discard && g_out_path) {
+        tawqa_bail("--discard and --out both replace stdout");
+    }
+    if (g_prealloc && !g_out_path) {
+        tawqa_bail("--prealloc needs --out file");
+    }
+    if (g_out_path && (g_resume || program_path || g_zero_io || g_forward || g_broadcast || g_merge || g_echo)) {
+        tawqa_bail("--out replaces stdout of a plain relay, --resume and listener modes keep their own");
+    }
+
+    // A bad recording fails here rather than after connecting
+    if (g_replay) {
+        tawqa_replay_open(g_replay);
+    }
+
+    // Scraped while the listener or relay runs, on its own thread
+    if (g_metrics) {
+        tawqa_metrics_start(g_metrics, g_metrics_format, g_metrics_interval);
+    }
+
+    // Everything the relay would print lands in the file sink instead
+    if (g_out_path) {
+        g_dstfd = tawqa_sink_start(g_out_path, g_prealloc);
+    }
+
+    // Multicast: one socket for the group, batched datagram I/O both ways
+    if (g_mcast.group) {
+        std::uint64_t total = g_listen
+            ? tawqa_mcast_recv(&g_mcast, local_port, g_dstfd, g_wait_time, &g_sockopts)
+            : tawqa_mcast_send(&g_mcast, local_port, STDIN_FILENO, &g_sockopts);
+        if (g_verbose) {
+            static char total_str[24];
+            snprintf(total_str, sizeof(total_str), "%llu", static_cast<unsigned long long>(total));
+            tawqa_holler(g_listen ? "Total: received %s" : "Total: sent %s", total_str);
+        }
+        if (g_out_path) {
+            tawqa_sink_finish();
+            if (g_verbose) {
+                tawqa_sink_report();
+            }
+        }
+        return 0;
+    }
+
     // Parse remaining arguments
-    if (optind >= argc && !g_listen) {
+    if (optind >= argc && !g_listen && !g_unix_path) {
         tawqa_help();
         return 1;
     }
@@ -436,44 +1656,120 @@ int main(int argc, char* argv[]) {
         remote_host = tawqa_gethostpoop(hostname, g_numeric);
     }
     
+    // Load test: the target is connected to many times over
+    if (g_load.conns) {
+        if (!remote_host || !remote_port) {
+            tawqa_bail("--load needs a host and port");
+        }
+        g_load_addr = remote_host->iaddrs[0];
+        g_load_port = remote_port;
+        tawqa_stats_add(TAWQA_STATS_SENT, tawqa_load_run(&g_load, tawqa_load_connect));
+        std::free(remote_host);
+        return 0;
+    }
+    
     // Create connection
-    g_netfd = tawqa_doconnect(
-        remote_host ? &remote_host->iaddrs[0] : nullptr,
-        remote_port,
-        nullptr,
-        local_port
-    );
+    if (g_unix_path) {
+        g_netfd = tawqa_dounix(g_unix_path);
+    } else {
+        g_netfd = tawqa_doconnect(
+            remote_host ? &remote_host->iaddrs[0] : nullptr,
+            remote_port,
+            nullptr,
+            local_port
+        );
+    }
     
-    if (g_listen) {
-        if (listen(g_netfd, 1) < 0) {
+    // Ping-pong timing owns the connection from here on
+    if (g_rtt.count) {
+        tawqa_rtt_run(g_netfd, &g_rtt);
+        close(g_netfd);
+        std::free(remote_host);
+        return 0;
+    }
+    
+    // Extra striped connections bind no fixed local port
+    if (!g_listen) {
+        for (std::size_t i = 1; i < g_streams; ++i) {
+            g_stripe_fds[i] = tawqa_doconnect(&remote_host->iaddrs[0], remote_port, nullptr, 0);
+        }
+    }
+    
+    // Resume: the listener owns the checkpoint and announces the offset
+    std::uint64_t resume_offset = 0;
+    if (g_checkpoint) {
+        resume_offset = tawqa_resume_open(g_checkpoint, STDOUT_FILENO);
+    }
+    
+    // A datagram Unix listener answers whoever writes to it first
+    if (g_listen && g_unix_path && g_udp_mode) {
+        if (g_verbose) {
+            tawqa_holler("Receiving on %s", g_unix_path);
+        }
+        tawqa_unix_dgram_peer(g_netfd);
+    } else if (g_listen) {
+        if (g_fastopen && !tawqa_sockopt_fastopen_listen(g_netfd, 16)) {
+            tawqa_holler("TCP_FASTOPEN unavailable on the listener");
+        }
+        if (listen(g_netfd, g_forward || g_broadcast || g_merge || g_echo ? SOMAXCONN : static_cast<int>(g_streams)) < 0) {
             tawqa_bail("listen failed");
         }
         
-        if (g_verbose) {
+        if (g_verbose && g_unix_path) {
+            tawqa_holler("Listening on %s", g_unix_path);
+        } else if (g_verbose) {
             static char port_str[16];
             snprintf(port_str, sizeof(port_str), "%u", local_port);
             tawqa_holler("Listening on port %s", port_str);
         }
         
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
+        // Fan-out: stdin, or the --forward upstream, goes to every client
+        if (g_broadcast) {
+            struct sockaddr_in source = {};
+            if (g_forward) {
+                source = tawqa_parse_hostport(g_forward);
+            }
+            tawqa_stats_add(TAWQA_STATS_SENT, tawqa_broadcast_run(
+                g_netfd, STDIN_FILENO, g_forward ? &source : nullptr, &g_broadcast_opts, &g_sockopts));
+            close(g_netfd);
+            if (g_verbose) {
+                static char in_str[24];
+                snprintf(in_str, sizeof(in_str), "%llu",
+                         static_cast<unsigned long long>(tawqa_stats_bytes(TAWQA_STATS_SENT)));
+                tawqa_holler("Total: broadcast %s", in_str);
+            }
+            tawqa_metrics_finish();
+            return 0;
+        }
         
-        int client_fd = accept(g_netfd, 
-                              reinterpret_cast<struct sockaddr*>(&client_addr), 
-                              &client_len);
-        if (client_fd < 0) {
-            tawqa_bail("accept failed");
+        // Fan-in: every client's lines interleaved whole on stdout
+        if (g_merge) {
+            tawqa_merge_run(g_netfd, STDOUT_FILENO, g_merge_prefix, &g_sockopts);
         }
         
-        if (g_verbose) {
-            static char port_str[16];
-            snprintf(port_str, sizeof(port_str), "%u", ntohs(client_addr.sin_port));
-            tawqa_holler("Connection from %s:%s", 
-                        inet_ntoa(client_addr.sin_addr), port_str);
+        // Round-trip partner for --rtt clients
+        if (g_echo) {
+            tawqa_echo_run(g_netfd, &g_sockopts);
+        }
+        
+        // Proxy mode serves connections until killed
+        if (g_forward) {
+            struct sockaddr_in target = tawqa_parse_hostport(g_forward);
+            tawqa_forward_run(g_netfd, &target, &g_sockopts);
+        }
+        
+        int client_fd = tawqa_doaccept(g_netfd);
+        
+        // A striped transfer arrives as several connections
+        for (std::size_t i = 1; i < g_streams; ++i) {
+            g_stripe_fds[i] = tawqa_doaccept(g_netfd);
         }
         
         close(g_netfd);
         g_netfd = client_fd;
+        if (g_unix_path && g_unix_path[0] != '@') {
+            unlink(g_unix_path);
+        }
         
         if (program_path) {
             tawqa_doexec(g_netfd);
@@ -486,17 +1782,114 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     
+    if (g_tls.enabled) {
+        g_tls.host = hostname;
+        tawqa_tls_start(g_netfd, g_listen, &g_tls);
+    }
+    
+    if (g_checkpoint) {
+        tawqa_resume_offer(g_netfd, resume_offset);
+    } else if (g_resume) {
+        tawqa_resume_accept(g_netfd, STDIN_FILENO);
+    }
+    
+    // The recording's client chunks stand in for stdin
+    int replay_fd = -1;
+    if (g_replay) {
+        g_srcfd = replay_fd = tawqa_replay_start(g_replay_speed);
+    }
+    if (g_record) {
+        tawqa_record_start(g_record, g_listen);
+    }
+    
+    // Codec threads sit between stdin/stdout and the relay
+    if (g_compress.codec != TAWQA_CODEC_NONE) {
+        tawqa_compress_start(&g_compress, STDIN_FILENO, g_dstfd, &g_srcfd, &g_dstfd);
+    }
+    
     // Main I/O loop
-    tawqa_readwrite(g_netfd);
+    if (g_streams > 1) {
+        // Striped transfers flow one way: connecting side to listener
+        g_stripe_fds[0] = g_netfd;
+        if (g_listen) {
+            tawqa_stats_add(TAWQA_STATS_RECV, tawqa_stripe_recv(g_stripe_fds.data(), g_streams, g_dstfd));
+        } else {
+            tawqa_stats_add(TAWQA_STATS_SENT, tawqa_stripe_send(g_stripe_fds.data(), g_streams, g_srcfd));
+        }
+        for (std::size_t i = 1; i < g_streams; ++i) {
+            close(g_stripe_fds[i]);
+        }
+    } else {
+        if (g_verify) {
+            tawqa_verify_init(g_verify);
+        }
+        if (g_ofd) {
+            tawqa_dump_start(g_ofd);
+        }
+        if (g_gen.kind != TAWQA_GEN_NONE || g_discard) {
+            tawqa_gen_init(&g_gen, g_discard, g_discard_verify);
+        }
+        tawqa_stats_start();
+        tawqa_readwrite(g_netfd);
+        if (g_ofd) {
+            tawqa_dump_stop();
+            close(g_ofd);
+        }
+    }
+    
+    if (g_checkpoint) {
+        tawqa_resume_close();
+    }
+    if (g_tls.enabled) {
+        tawqa_tls_finish();
+    }
+
+    if (g_compress.codec != TAWQA_CODEC_NONE) {
+        tawqa_compress_finish(g_srcfd, g_dstfd);
+    }
+    if (g_out_path) {
+        tawqa_sink_finish();
+    }
+    if (g_replay) {
+        tawqa_replay_finish(replay_fd);
+    }
+    if (g_record) {
+        tawqa_record_finish();
+    }
+    tawqa_metrics_finish();
     
     if (g_verbose) {
-        static char net_str[16], out_str[16];
-        snprintf(net_str, sizeof(net_str), "%u", g_wrote_net);
-        snprintf(out_str, sizeof(out_str), "%u", g_wrote_out);
+        static char net_str[24], out_str[24];
+        snprintf(net_str, sizeof(net_str), "%llu",
+                 static_cast<unsigned long long>(tawqa_stats_bytes(TAWQA_STATS_SENT)));
+        snprintf(out_str, sizeof(out_str), "%llu",
+                 static_cast<unsigned long long>(tawqa_stats_bytes(TAWQA_STATS_RECV)));
         tawqa_holler("Total: sent %s, received %s", net_str, out_str);
+        if (g_streams == 1) {
+            tawqa_stats_dump(true);
+        }
+        if (g_fastopen) {
+            tawqa_sockopt_fastopen_report(g_netfd);
+        }
+        if (g_compress.codec != TAWQA_CODEC_NONE) {
+            tawqa_compress_report();
+        }
+        if (g_out_path) {
+            tawqa_sink_report();
+        }
+    }
+    
+    if (g_verify && !tawqa_verify_report()) {
+        tawqa_bail("Checksum verification failed");
+    }
+    if ((g_gen.kind != TAWQA_GEN_NONE || g_discard) && !tawqa_gen_finish()) {
+        tawqa_bail("Pattern verification failed");
     }
     
     close(g_netfd);
+    if (g_unix_path && g_listen && g_udp_mode && g_unix_path[0] != '@') {
+        unlink(g_unix_path);
+    }
     if (remote_host) {
         std::free(remote_host);
     }
@@ -0,0 +1,312 @@
+// TAWQA Benchmarks
+// Relay engines over socketpairs, pipes and loopback TCP, and the per-byte
+// line kernels (Google Benchmark)
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_bench.hh"
+#include "tawqa_line.hh"
+#include "tawqa_netio.hh"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Bytes pushed through the relay per benchmark iteration
+constexpr std::size_t TAWQA_BENCH_BYTES = 64 * 1024 * 1024;
+constexpr std::size_t TAWQA_BENCH_SIDE_BUF = 1024 * 1024;
+
+enum tawqa_bench_transport : int {
+    TAWQA_BENCH_SOCKETPAIR = 0,
+    TAWQA_BENCH_PIPE,
+    TAWQA_BENCH_TCP,
+};
+
+static const char* g_transport_names[] = {"socketpair", "pipe", "tcp"};
+
+// A one-way channel: bytes written to fd[1] come out of fd[0]
+struct tawqa_bench_chan {
+    int fd[2];
+};
+
+static void tawqa_bench_tcp(tawqa_bench_chan* chan) {
+    int ls = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (ls < 0 || bind(ls, reinterpret_cast<struct sockaddr*>(&addr), len) < 0 || listen(ls, 1) < 0 ||
+        getsockname(ls, reinterpret_cast<struct sockaddr*>(&addr), &len) < 0) {
+        std::abort();
+    }
+    chan->fd[1] = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(chan->fd[1], reinterpret_cast<struct sockaddr*>(&addr), len) < 0) {
+        std::abort();
+    }
+    chan->fd[0] = accept(ls, nullptr, nullptr);
+    close(ls);
+}
+
+static void tawqa_bench_open(tawqa_bench_transport t, tawqa_bench_chan* chan) {
+    int rc = 0;
+    switch (t) {
+        case TAWQA_BENCH_SOCKETPAIR:
+            rc = socketpair(AF_UNIX, SOCK_STREAM, 0, chan->fd);
+            break;
+        case TAWQA_BENCH_PIPE:
+            rc = pipe(chan->fd);
+            break;
+        case TAWQA_BENCH_TCP:
+            tawqa_bench_tcp(chan);
+            break;
+    }
+    if (rc < 0 || chan->fd[0] < 0 || chan->fd[1] < 0) {
+        std::abort();
+    }
+}
+
+// Producer: a memory block written until `total` bytes are out
+static void tawqa_bench_produce(int fd, std::size_t total) {
+    static std::vector<char> block(TAWQA_BENCH_SIDE_BUF, 'x');
+    while (total) {
+        ssize_t n = write(fd, block.data(), std::min(total, block.size()));
+        if (n <= 0) {
+            break;
+        }
+        total -= static_cast<std::size_t>(n);
+    }
+    close(fd);
+}
+
+// Consumer: read and drop until EOF
+static void tawqa_bench_consume(int fd) {
+    std::vector<char> buf(TAWQA_BENCH_SIDE_BUF);
+    while (read(fd, buf.data(), buf.size()) > 0) {
+    }
+}
+
+static std::uint64_t tawqa_bench_cpu_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+// What a relay engine reports back for one iteration
+struct tawqa_bench_run {
+    std::uint64_t bytes;
+    std::uint64_t syscalls;
+};
+
+using tawqa_bench_engine = tawqa_bench_run (*)(int in, int out, std::size_t bufsize);
+
+// The tawqa_readwrite copy step: one read into a user buffer, passed on
+// with tawqa_writen. On blocking fds that is a single write per read.
+static tawqa_bench_run tawqa_bench_copy(int in, int out, std::size_t bufsize) {
+    static std::vector<char> buf;
+    buf.resize(bufsize);
+    tawqa_bench_run run = {};
+    while (true) {
+        ssize_t n = read(in, buf.data(), bufsize);
+        ++run.syscalls;
+        if (n <= 0) {
+            break;
+        }
+        ++run.syscalls;
+        if (tawqa_writen(out, buf.data(), static_cast<std::size_t>(n)) != static_cast<std::size_t>(n)) {
+            break;
+        }
+        run.bytes += static_cast<std::uint64_t>(n);
+    }
+    return run;
+}
+
+// The --forward step: tawqa_splice_pump, woken by poll() where the proxy
+// has epoll
+static tawqa_bench_run tawqa_bench_splice(int in, int out, std::size_t bufsize) {
+    tawqa_splice_dir dir;
+    if (!tawqa_splice_open(&dir, in, out, static_cast<int>(std::max<std::size_t>(bufsize, 4096)))) {
+        std::abort();
+    }
+    tawqa_bench_run run = {};
+    while (tawqa_splice_pump(&dir) && !dir.shut) {
+        struct pollfd pfd[2] = {{in, 0, 0}, {out, 0, 0}};
+        if (!dir.eof && dir.pending < dir.capacity) {
+            pfd[0].events = POLLIN;
+        }
+        if (dir.pending) {
+            pfd[1].events = POLLOUT;
+        }
+        poll(pfd, 2, -1);
+        ++run.syscalls;
+    }
+    run.bytes = dir.moved;
+    run.syscalls += dir.calls;
+    tawqa_splice_close(&dir);
+    return run;
+}
+
+// producer -> [in channel] -> relay engine -> [out channel] -> consumer
+static void tawqa_bench_relay(benchmark::State& state, tawqa_bench_engine engine) {
+    auto transport = static_cast<tawqa_bench_transport>(state.range(0));
+    auto bufsize = static_cast<std::size_t>(state.range(1));
+    state.SetLabel(g_transport_names[transport]);
+
+    std::uint64_t bytes = 0, syscalls = 0, relay_cpu = 0, total_cpu = 0;
+    for (auto _ : state) {
+        tawqa_bench_chan in, out;
+        tawqa_bench_open(transport, &in);
+        tawqa_bench_open(transport, &out);
+
+        std::uint64_t proc0 = tawqa_bench_cpu_ns(CLOCK_PROCESS_CPUTIME_ID);
+        std::uint64_t self0 = tawqa_bench_cpu_ns(CLOCK_THREAD_CPUTIME_ID);
+        std::thread producer(tawqa_bench_produce, in.fd[1], TAWQA_BENCH_BYTES);
+        std::thread consumer(tawqa_bench_consume, out.fd[0]);
+
+        tawqa_bench_run run = engine(in.fd[0], out.fd[1], bufsize);
+        shutdown(out.fd[1], SHUT_WR);
+        close(out.fd[1]);
+        out.fd[1] = -1;
+        producer.join();
+        consumer.join();
+
+        relay_cpu += tawqa_bench_cpu_ns(CLOCK_THREAD_CPUTIME_ID) - self0;
+        total_cpu += tawqa_bench_cpu_ns(CLOCK_PROCESS_CPUTIME_ID) - proc0;
+        bytes += run.bytes;
+        syscalls += run.syscalls;
+        close(in.fd[0]);
+        close(out.fd[0]);
+        if (run.bytes != TAWQA_BENCH_BYTES) {
+            state.SkipWithError("relay lost bytes");
+            break;
+        }
+    }
+
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+    double gb = static_cast<double>(bytes) / 1e9;
+    if (gb > 0) {
+        state.counters["syscalls/GB"] = static_cast<double>(syscalls) / gb;
+        state.counters["relay_cpu_ns/B"] = static_cast<double>(relay_cpu) / static_cast<double>(bytes);
+        state.counters["total_cpu_ns/B"] = static_cast<double>(total_cpu) / static_cast<double>(bytes);
+    }
+}
+
+static void BM_relay_copy(benchmark::State& state) {
+    tawqa_bench_relay(state, tawqa_bench_copy);
+}
+
+static void BM_relay_splice(benchmark::State& state) {
+    tawqa_bench_relay(state, tawqa_bench_splice);
+}
+
+// Every transport at TAWQA_BIGSIZ-like and larger relay buffers
+static void tawqa_bench_relay_args(benchmark::internal::Benchmark* b) {
+    for (int t = TAWQA_BENCH_SOCKETPAIR; t <= TAWQA_BENCH_TCP; ++t) {
+        for (std::int64_t size : {4096, 8192, 65536, 262144, 1048576}) {
+            b->Args({t, size});
+        }
+    }
+    b->ArgNames({"transport", "bufsize"});
+    b->UseRealTime();
+    b->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK(BM_relay_copy)->Apply(tawqa_bench_relay_args);
+BENCHMARK(BM_relay_splice)->Apply(tawqa_bench_relay_args);
+
+// Line kernels: tawqa_findline (pacing, merge), tawqa_findeol and
+// tawqa_crlf_expand (doexec), one variant per ISA
+
+static void tawqa_bench_scan(benchmark::State& state, const tawqa_bench_find* table) {
+    int isa = static_cast<int>(state.range(0));
+    auto size = static_cast<std::size_t>(state.range(1));
+    auto spacing = static_cast<std::size_t>(state.range(2));
+    state.SetLabel(g_isa_names[isa]);
+    if (!tawqa_bench_have(isa)) {
+        state.SkipWithError("CPU lacks this ISA");
+        return;
+    }
+
+    tawqa_bench_find fn = table[isa];
+    std::vector<char> text = tawqa_bench_text(size, spacing, 1);
+    std::uint64_t lines = 0;
+    for (auto _ : state) {
+        for (std::size_t pos = 0; pos < size; ++lines) {
+            pos += fn(text.data() + pos, size - pos);
+        }
+        benchmark::DoNotOptimize(lines);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * size));
+}
+
+static void BM_findline(benchmark::State& state) {
+    tawqa_bench_scan(state, g_findline);
+}
+
+static void BM_findeol(benchmark::State& state) {
+    tawqa_bench_scan(state, g_findeol);
+}
+
+static void BM_crlf_expand(benchmark::State& state) {
+    int isa = static_cast<int>(state.range(0));
+    auto size = static_cast<std::size_t>(state.range(1));
+    auto spacing = static_cast<std::size_t>(state.range(2));
+    state.SetLabel(g_isa_names[isa]);
+    if (!tawqa_bench_have(isa)) {
+        state.SkipWithError("CPU lacks this ISA");
+        return;
+    }
+
+    std::vector<char> text = tawqa_bench_text(size, spacing, 1);
+    std::vector<char> out(2 * size + 1);
+    for (auto _ : state) {
+        char prev = 0;
+        std::size_t n = g_crlf_expand[isa](text.data(), size, out.data(), &prev);
+        benchmark::DoNotOptimize(n);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * size));
+}
+
+// Each ISA across pipe-sized to relay-sized inputs, from no line ends to dense
+static void tawqa_bench_kernel_args(benchmark::internal::Benchmark* b, int isas) {
+    for (int isa = TAWQA_BENCH_SCALAR; isa < isas; ++isa) {
+        for (std::int64_t size : {64, 1024, 16384, 262144}) {
+            for (std::int64_t spacing : {0, 1024, 80, 16}) {
+                b->Args({isa, size, spacing});
+            }
+        }
+    }
+    b->ArgNames({"isa", "size", "spacing"});
+}
+
+BENCHMARK(BM_findline)->Apply([](benchmark::internal::Benchmark* b) {
+    tawqa_bench_kernel_args(b, TAWQA_BENCH_LIBC + 1);
+});
+BENCHMARK(BM_findeol)->Apply([](benchmark::internal::Benchmark* b) {
+    tawqa_bench_kernel_args(b, TAWQA_BENCH_AVX2 + 1);
+});
+BENCHMARK(BM_crlf_expand)->Apply([](benchmark::internal::Benchmark* b) {
+    tawqa_bench_kernel_args(b, TAWQA_BENCH_AVX2 + 1);
+});
+
+// BENCHMARK_MAIN; tawqa_linecheck holds the kernel property checks.
+// Results go out as JSON with --benchmark_format=json or --benchmark_out=file.
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#ifndef TAWQA_BENCH_HH_INCLUDED
+#define TAWQA_BENCH_HH_INCLUDED
+
+// TAWQA Line Kernel Test Bed Header
+// Per-ISA kernel tables and synthetic text shared by tawqa_bench and
+// tawqa_linecheck
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_line.hh"
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+enum tawqa_bench_isa : int {
+    TAWQA_BENCH_SCALAR = 0,
+    TAWQA_BENCH_SSE2,
+    TAWQA_BENCH_AVX2,
+    TAWQA_BENCH_LIBC,
+};
+
+inline const char* g_isa_names[] = {"scalar", "sse2", "avx2", "libc"};
+
+using tawqa_bench_find = std::size_t (*)(const char*, std::size_t);
+using tawqa_bench_expand = std::size_t (*)(const char*, std::size_t, char*, char*);
+
+inline const tawqa_bench_find g_findline[] = {tawqa_findline_scalar, tawqa_findline_sse2,
+                                              tawqa_findline_avx2, tawqa_findline};
+inline const tawqa_bench_find g_findeol[] = {tawqa_findeol_scalar, tawqa_findeol_sse2, tawqa_findeol_avx2};
+inline const tawqa_bench_expand g_crlf_expand[] = {tawqa_crlf_expand_scalar, tawqa_crlf_expand_sse2,
+                                                   tawqa_crlf_expand_avx2};
+
+inline bool tawqa_bench_have(int isa) {
+    switch (isa) {
+        case TAWQA_BENCH_SSE2:
+            return tawqa_line_have_sse2();
+        case TAWQA_BENCH_AVX2:
+            return tawqa_line_have_avx2();
+        default:
+            return true;
+    }
+}
+
+// Printable text with a line end about every `spacing` bytes (0: none).
+// One line end in four is CRLF, one in eight a bare CR.
+inline std::vector<char> tawqa_bench_text(std::size_t size, std::size_t spacing, std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<char> text(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        std::uint32_t r = rng();
+        if (spacing && r % spacing == 0) {
+            switch ((r >> 16) & 7) {
+                case 0:
+                case 1:
+                    text[i] = '\r';
+                    if (i + 1 < size && ((r >> 16) & 7) == 0) {
+                        text[++i] = '\n';
+                    }
+                    break;
+                default:
+                    text[i] = '\n';
+                    break;
+            }
+        } else {
+            text[i] = static_cast<char>(' ' + (r >> 8) % 95);
+        }
+    }
+    return text;
+}
+
+#endif // TAWQA_BENCH_HH_INCLUDED
@@ -0,0 +1,413 @@
+// TAWQA Broadcast Implementation
+// Refcounted chunks queued per client, one epoll loop, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_broadcast.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_metrics.hh"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+constexpr std::size_t TAWQA_BC_CHUNK = 64 * 1024;
+constexpr int TAWQA_BC_IOV = 64;
+constexpr int TAWQA_BC_EVENTS = 64;
+
+// Input data shared by every client queue that references it
+struct tawqa_bc_chunk {
+    tawqa_bc_chunk* next_free;
+    unsigned refs;
+    std::size_t len;
+    char data[TAWQA_BC_CHUNK];
+};
+
+// Per-client FIFO of chunk references
+struct tawqa_bc_node {
+    tawqa_bc_node* next;
+    tawqa_bc_chunk* chunk;
+};
+
+struct tawqa_bc_client {
+    tawqa_bc_client* prev;
+    tawqa_bc_client* next;
+    int fd;
+    tawqa_bc_node* head;
+    tawqa_bc_node* tail;
+    std::size_t head_off;    // bytes of head chunk already written
+    std::size_t queued;      // unsent bytes across the queue
+    std::uint64_t sent;
+    std::uint64_t dropped;
+    bool writable;           // last write did not hit EAGAIN
+    bool rd_closed;          // client half-closed; it may still be reading
+    tawqa_metrics_conn* metrics;
+    char peer[32];
+};
+
+static tawqa_bc_chunk* g_bc_free_chunks = nullptr;
+static tawqa_bc_node* g_bc_free_nodes = nullptr;
+static tawqa_bc_client* g_bc_clients = nullptr;
+static unsigned g_bc_count = 0;
+static int g_bc_epfd = -1;
+static char g_bc_listen_tag, g_bc_input_tag;
+static tawqa_metrics_shard* g_bc_metrics = nullptr;
+
+bool tawqa_broadcast_parse_slow(const char* str, tawqa_slow_policy* policy) {
+    if (std::strcmp(str, "drop") == 0) {
+        *policy = TAWQA_SLOW_DROP;
+    } else if (std::strcmp(str, "disconnect") == 0) {
+        *policy = TAWQA_SLOW_DISCONNECT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static tawqa_bc_chunk* tawqa_bc_chunk_get() {
+    tawqa_bc_chunk* chunk = g_bc_free_chunks;
+    if (chunk) {
+        g_bc_free_chunks = chunk->next_free;
+    } else {
+        chunk = static_cast<tawqa_bc_chunk*>(std::malloc(sizeof(tawqa_bc_chunk)));
+        if (!chunk) {
+            tawqa_bail("Out of memory for broadcast chunks");
+        }
+    }
+    chunk->refs = 0;
+    chunk->len = 0;
+    return chunk;
+}
+
+static void tawqa_bc_chunk_put(tawqa_bc_chunk* chunk) {
+    if (--chunk->refs == 0) {
+        chunk->next_free = g_bc_free_chunks;
+        g_bc_free_chunks = chunk;
+    }
+}
+
+// Unlink the oldest reference from a client's queue
+static void tawqa_bc_pop(tawqa_bc_client* client) {
+    tawqa_bc_node* node = client->head;
+    client->queued -= node->chunk->len - client->head_off;
+    client->head = node->next;
+    if (!client->head) {
+        client->tail = nullptr;
+    }
+    client->head_off = 0;
+    tawqa_bc_chunk_put(node->chunk);
+    node->next = g_bc_free_nodes;
+    g_bc_free_nodes = node;
+}
+
+static void tawqa_bc_drop_client(tawqa_bc_client* client, const char* why) {
+    static char sent_str[24], drop_str[24];
+    std::snprintf(sent_str, sizeof(sent_str), "%llu", static_cast<unsigned long long>(client->sent));
+    std::snprintf(drop_str, sizeof(drop_str), "%llu", static_cast<unsigned long long>(client->dropped));
+    tawqa_holler(why, client->peer, sent_str, drop_str);
+    tawqa_metrics_close(g_bc_metrics, client->metrics);
+
+    while (client->head) {
+        tawqa_bc_pop(client);
+    }
+    close(client->fd);
+    if (client->prev) {
+        client->prev->next = client->next;
+    } else {
+        g_bc_clients = client->next;
+    }
+    if (client->next) {
+        client->next->prev = client->prev;
+    }
+    std::free(client);
+    g_bc_count -= 1;
+}
+
+// Write as much of the queue as the socket takes; false if the client died
+static bool tawqa_bc_flush(tawqa_bc_client* client) {
+    while (client->head) {
+        struct iovec iov[TAWQA_BC_IOV];
+        int iovcnt = 0;
+        std::size_t off = client->head_off;
+        for (tawqa_bc_node* node = client->head; node && iovcnt < TAWQA_BC_IOV; node = node->next) {
+            iov[iovcnt].iov_base = node->chunk->data + off;
+            iov[iovcnt].iov_len = node->chunk->len - off;
+            ++iovcnt;
+            off = 0;
+        }
+
+        ssize_t n = writev(client->fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                client->writable = false;
+                return true;
+            }
+            return false;
+        }
+        client->sent += static_cast<std::uint64_t>(n);
+        tawqa_metrics_out(g_bc_metrics, client->metrics, static_cast<std::uint64_t>(n));
+
+        std::size_t left = static_cast<std::size_t>(n);
+        while (left && client->head) {
+            std::size_t avail = client->head->chunk->len - client->head_off;
+            if (left < avail) {
+                client->head_off += left;
+                client->queued -= left;
+                left = 0;
+            } else {
+                left -= avail;
+                tawqa_bc_pop(client);
+            }
+        }
+    }
+    client->writable = true;
+    return true;
+}
+
+// Queue a chunk reference on a client, applying the lag policy
+static bool tawqa_bc_enqueue(tawqa_bc_client* client, tawqa_bc_chunk* chunk,
+                             const tawqa_broadcast_opts* opts) {
+    if (client->queued + chunk->len > opts->lag_limit) {
+        if (opts->slow == TAWQA_SLOW_DISCONNECT) {
+            return false;
+        }
+        // Drop whole chunks, but never one that is partly on the wire
+        while (client->head && client->head_off == 0 &&
+               client->queued + chunk->len > opts->lag_limit) {
+            client->dropped += client->head->chunk->len;
+            tawqa_metrics_bump(&g_bc_metrics->dropped, client->head->chunk->len);
+            tawqa_bc_pop(client);
+        }
+    }
+
+    tawqa_bc_node* node = g_bc_free_nodes;
+    if (node) {
+        g_bc_free_nodes = node->next;
+    } else {
+        node = static_cast<tawqa_bc_node*>(std::malloc(sizeof(tawqa_bc_node)));
+        if (!node) {
+            tawqa_bail("Out of memory for broadcast queues");
+        }
+    }
+    node->next = nullptr;
+    node->chunk = chunk;
+    chunk->refs += 1;
+    if (client->tail) {
+        client->tail->next = node;
+    } else {
+        client->head = node;
+    }
+    client->tail = node;
+    client->queued += chunk->len;
+    return true;
+}
+
+static void tawqa_bc_accept(int listenfd, const tawqa_sockopts* sockopts) {
+    while (true) {
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept4(listenfd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                tawqa_holler("accept failed");
+            }
+            return;
+        }
+
+        auto* client = static_cast<tawqa_bc_client*>(std::calloc(1, sizeof(tawqa_bc_client)));
+        if (!client) {
+            close(fd);
+            continue;
+        }
+        client->fd = fd;
+        client->writable = true;
+        if (addr.ss_family == AF_INET) {
+            const auto* sin = reinterpret_cast<const struct sockaddr_in*>(&addr);
+            std::snprintf(client->peer, sizeof(client->peer), "%s:%u", inet_ntoa(sin->sin_addr),
+                          ntohs(sin->sin_port));
+        } else {
+            std::snprintf(client->peer, sizeof(client->peer), "local");
+        }
+        client->metrics = tawqa_metrics_open(g_bc_metrics, client->peer);
+        tawqa_sockopt_apply(fd, sockopts, addr.ss_family == AF_INET);
+
+        client->next = g_bc_clients;
+        if (g_bc_clients) {
+            g_bc_clients->prev = client;
+        }
+        g_bc_clients = client;
+        g_bc_count += 1;
+
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = client;
+        epoll_ctl(g_bc_epfd, EPOLL_CTL_ADD, fd, &ev);
+
+        static char count_str[16];
+        std::snprintf(count_str, sizeof(count_str), "%u", g_bc_count);
+        errno = 0;
+        tawqa_holler("Subscriber %s joined [%s connected]", client->peer, count_str);
+    }
+}
+
+// Clients only listen; anything they send is discarded. A half-close
+// is normal (nc with no input), only a reset means the client is gone.
+static bool tawqa_bc_drain_input(tawqa_bc_client* client) {
+    char sink[4096];
+    while (!client->rd_closed) {
+        ssize_t n = recv(client->fd, sink, sizeof(sink), 0);
+        if (n > 0) {
+            tawqa_metrics_in(g_bc_metrics, client->metrics, static_cast<std::uint64_t>(n));
+            continue;
+        }
+        if (n == 0) {
+            client->rd_closed = true;
+        } else {
+            return errno == EAGAIN || errno == EINTR;
+        }
+    }
+    return true;
+}
+
+std::uint64_t tawqa_broadcast_run(int listenfd, int in_fd, const struct sockaddr_in* upstream,
+                                  const tawqa_broadcast_opts* opts, const tawqa_sockopts* sockopts) {
+    std::signal(SIGPIPE, SIG_IGN);
+    g_bc_metrics = tawqa_metrics_shard_new();
+
+    if (upstream) {
+        std::uint64_t start_ns = tawqa_now_ns();
+        in_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (in_fd < 0 || connect(in_fd, reinterpret_cast<const struct sockaddr*>(upstream),
+                                 sizeof(*upstream)) < 0) {
+            tawqa_bail("Can't connect to broadcast source");
+        }
+        tawqa_metrics_connected(g_bc_metrics, tawqa_now_ns() - start_ns);
+        // Nothing goes upstream
+        shutdown(in_fd, SHUT_WR);
+    }
+
+    fcntl(listenfd, F_SETFL, fcntl(listenfd, F_GETFL) | O_NONBLOCK);
+    g_bc_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_bc_epfd < 0) {
+        tawqa_bail("epoll_create1 failed");
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &g_bc_listen_tag;
+    epoll_ctl(g_bc_epfd, EPOLL_CTL_ADD, listenfd, &ev);
+
+    // Regular files can't be polled; they are always readable
+    bool input_open = true;
+    bool input_polled = true;
+    ev.data.ptr = &g_bc_input_tag;
+    if (epoll_ctl(g_bc_epfd, EPOLL_CTL_ADD, in_fd, &ev) < 0) {
+        input_polled = false;
+    }
+
+    // Input is only consumed while someone is subscribed, so a push made
+    // before the first client connects is not lost
+    bool input_armed = true;
+
+    std::uint64_t total = 0;
+    struct epoll_event events[TAWQA_BC_EVENTS];
+    while (input_open || g_bc_clients) {
+        bool want_input = input_open && g_bc_count > 0;
+        if (input_polled && input_open && want_input != input_armed) {
+            ev.events = want_input ? static_cast<std::uint32_t>(EPOLLIN) : 0U;
+            ev.data.ptr = &g_bc_input_tag;
+            epoll_ctl(g_bc_epfd, EPOLL_CTL_MOD, in_fd, &ev);
+            input_armed = want_input;
+        }
+
+        int n = epoll_wait(g_bc_epfd, events, TAWQA_BC_EVENTS, want_input && !input_polled ? 0 : -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            tawqa_bail("epoll_wait failed");
+        }
+
+        bool input_ready = want_input && !input_polled;
+        for (int i = 0; i < n; ++i) {
+            void* tag = events[i].data.ptr;
+            if (tag == &g_bc_listen_tag) {
+                tawqa_bc_accept(listenfd, sockopts);
+            } else if (tag == &g_bc_input_tag) {
+                input_ready = input_open;
+            } else if (tag) {
+                auto* client = static_cast<tawqa_bc_client*>(tag);
+                if ((events[i].events & EPOLLIN) && !tawqa_bc_drain_input(client)) {
+                    tawqa_bc_drop_client(client, "Subscriber %s left: sent %s, dropped %s");
+                    // Stale pointers to it later in this batch are unlikely
+                    // but possible; clear them
+                    for (int j = i + 1; j < n; ++j) {
+                        if (events[j].data.ptr == client) {
+                            events[j].data.ptr = nullptr;
+                        }
+                    }
+                    continue;
+                }
+                if ((events[i].events & EPOLLOUT) && !tawqa_bc_flush(client)) {
+                    tawqa_bc_drop_client(client, "Subscriber %s reset: sent %s, dropped %s");
+                    for (int j = i + 1; j < n; ++j) {
+                        if (events[j].data.ptr == client) {
+                            events[j].data.ptr = nullptr;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (input_ready && g_bc_count) {
+            tawqa_bc_chunk* chunk = tawqa_bc_chunk_get();
+            ssize_t got = read(in_fd, chunk->data, TAWQA_BC_CHUNK);
+            if (got <= 0 && !(got < 0 && (errno == EAGAIN || errno == EINTR))) {
+                input_open = false;
+                epoll_ctl(g_bc_epfd, EPOLL_CTL_DEL, in_fd, nullptr);
+                errno = 0;
+                tawqa_holler("Broadcast input ended");
+            }
+            if (got > 0) {
+                chunk->len = static_cast<std::size_t>(got);
+                total += chunk->len;
+                // The extra reference keeps the chunk alive while fanning out
+                chunk->refs = 1;
+                for (tawqa_bc_client* c = g_bc_clients, *next; c; c = next) {
+                    next = c->next;
+                    if (!tawqa_bc_enqueue(c, chunk, opts)) {
+                        errno = 0;
+                        tawqa_bc_drop_client(c, "Subscriber %s too slow: sent %s, dropped %s");
+                    } else if (c->writable && !tawqa_bc_flush(c)) {
+                        tawqa_bc_drop_client(c, "Subscriber %s reset: sent %s, dropped %s");
+                    }
+                }
+            } else {
+                chunk->refs = 1;
+            }
+            tawqa_bc_chunk_put(chunk);
+        }
+
+        // Once input is over, clients that got everything are let go
+        if (!input_open) {
+            for (tawqa_bc_client* c = g_bc_clients, *next; c; c = next) {
+                next = c->next;
+                if (!c->head) {
+                    errno = 0;
+                    tawqa_bc_drop_client(c, "Subscriber %s done: sent %s, dropped %s");
+                }
+            }
+        }
+    }
+
+    close(g_bc_epfd);
+    return total;
+}
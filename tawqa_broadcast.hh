@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef TAWQA_BROADCAST_HH_INCLUDED
+#define TAWQA_BROADCAST_HH_INCLUDED
+
+// TAWQA Broadcast Header
+// One input fanned out to every client of a listener
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_sockopt.hh"
+#include <cstdint>
+#include <cstddef>
+#include <netinet/in.h>
+
+// What to do with a client whose backlog passes the lag limit
+enum tawqa_slow_policy {
+    TAWQA_SLOW_DROP = 0,       // discard its oldest queued chunks
+    TAWQA_SLOW_DISCONNECT = 1, // close it
+};
+
+struct tawqa_broadcast_opts {
+    std::size_t lag_limit;     // queued bytes per client before the policy applies
+    tawqa_slow_policy slow;
+};
+
+bool tawqa_broadcast_parse_slow(const char* str, tawqa_slow_policy* policy);
+
+// Read `in_fd` (or connect to `upstream` when non-null) and send every
+// chunk to all clients accepted on `listenfd`. Chunks are shared by
+// reference, never copied per client. Returns once input has ended and
+// every client has drained or left; the result is bytes read.
+std::uint64_t tawqa_broadcast_run(int listenfd, int in_fd, const struct sockaddr_in* upstream,
+                                  const tawqa_broadcast_opts* opts, const tawqa_sockopts* sockopts);
+
+#endif // TAWQA_BROADCAST_HH_INCLUDED
@@ -0,0 +1,403 @@
+// TAWQA Compression Implementation
+// Codec threads joined to the relay through pipes, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_compress.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_netio.hh"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef TAWQA_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef TAWQA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// Wire format: an 8-byte stream header, then frames of
+// [u32 raw_len][u32 packed_len][payload]. packed_len == raw_len marks a
+// stored (incompressible) frame; raw_len == 0 ends the stream.
+constexpr unsigned char TAWQA_COMPRESS_MAGIC[4] = {'T', 'W', 'Q', 'Z'};
+constexpr std::uint8_t TAWQA_COMPRESS_VERSION = 1;
+constexpr std::size_t TAWQA_COMPRESS_HDR = 8;
+constexpr std::size_t TAWQA_COMPRESS_CHUNK = 128 * 1024;
+constexpr std::size_t TAWQA_COMPRESS_MAX_FRAME = 4 * 1024 * 1024;
+constexpr int TAWQA_COMPRESS_PIPE_SIZE = 1024 * 1024;
+
+// Per-direction codec accounting
+struct tawqa_codec_stats {
+    std::atomic<std::uint64_t> raw;
+    std::atomic<std::uint64_t> packed;
+    std::atomic<std::uint64_t> busy_ns;
+};
+
+// Codec scratch state owned by one thread
+struct tawqa_codec_ctx {
+    tawqa_codec codec;
+    int level;
+#ifdef TAWQA_HAVE_ZSTD
+    ZSTD_CCtx* zc;
+    ZSTD_DCtx* zd;
+#endif
+};
+
+static tawqa_compress_opts g_opts = {TAWQA_CODEC_NONE, 0};
+static tawqa_codec g_peer_codec = TAWQA_CODEC_NONE;
+static tawqa_codec_stats g_enc_stats;
+static tawqa_codec_stats g_dec_stats;
+static std::thread g_enc_thread;
+static std::thread g_dec_thread;
+static std::atomic<bool> g_enc_done{false};
+
+static const char* tawqa_codec_name(tawqa_codec codec) {
+    switch (codec) {
+        case TAWQA_CODEC_LZ4: return "lz4";
+        case TAWQA_CODEC_ZSTD: return "zstd";
+        default: return "none";
+    }
+}
+
+static bool tawqa_codec_available(tawqa_codec codec) {
+    switch (codec) {
+#ifdef TAWQA_HAVE_LZ4
+        case TAWQA_CODEC_LZ4: return true;
+#endif
+#ifdef TAWQA_HAVE_ZSTD
+        case TAWQA_CODEC_ZSTD: return true;
+#endif
+        default: return false;
+    }
+}
+
+bool tawqa_compress_parse(const char* spec, tawqa_compress_opts* opts) {
+    const char* colon = std::strchr(spec, ':');
+    std::size_t name_len = colon ? static_cast<std::size_t>(colon - spec) : std::strlen(spec);
+
+    if (name_len == 3 && std::strncmp(spec, "lz4", 3) == 0) {
+        opts->codec = TAWQA_CODEC_LZ4;
+        opts->level = 1; // acceleration factor
+    } else if (name_len == 4 && std::strncmp(spec, "zstd", 4) == 0) {
+        opts->codec = TAWQA_CODEC_ZSTD;
+        opts->level = 3;
+    } else {
+        return false;
+    }
+
+    if (colon) {
+        char* end = nullptr;
+        long level = std::strtol(colon + 1, &end, 10);
+        if (end == colon + 1 || *end != '\0' || level < 1 || level > 22) {
+            return false;
+        }
+        opts->level = static_cast<int>(level);
+    }
+
+    return tawqa_codec_available(opts->codec);
+}
+
+static void tawqa_codec_ctx_init(tawqa_codec_ctx* ctx, tawqa_codec codec, int level) {
+    ctx->codec = codec;
+    ctx->level = level;
+#ifdef TAWQA_HAVE_ZSTD
+    ctx->zc = nullptr;
+    ctx->zd = nullptr;
+    if (codec == TAWQA_CODEC_ZSTD) {
+        ctx->zc = ZSTD_createCCtx();
+        ctx->zd = ZSTD_createDCtx();
+    }
+#endif
+}
+
+static void tawqa_codec_ctx_free(tawqa_codec_ctx* ctx) {
+#ifdef TAWQA_HAVE_ZSTD
+    ZSTD_freeCCtx(ctx->zc);
+    ZSTD_freeDCtx(ctx->zd);
+#else
+    (void)ctx;
+#endif
+}
+
+static std::size_t tawqa_codec_bound(tawqa_codec codec, std::size_t size) {
+    switch (codec) {
+#ifdef TAWQA_HAVE_LZ4
+        case TAWQA_CODEC_LZ4: return LZ4_compressBound(static_cast<int>(size));
+#endif
+#ifdef TAWQA_HAVE_ZSTD
+        case TAWQA_CODEC_ZSTD: return ZSTD_compressBound(size);
+#endif
+        default: return size;
+    }
+}
+
+// Returns the packed size, or 0 when the codec failed or didn't help
+static std::size_t tawqa_codec_encode(tawqa_codec_ctx* ctx, const char* src, std::size_t len,
+                                      char* dst, std::size_t cap) {
+    std::size_t packed = 0;
+
+    switch (ctx->codec) {
+#ifdef TAWQA_HAVE_LZ4
+        case TAWQA_CODEC_LZ4: {
+            int n = LZ4_compress_fast(src, dst, static_cast<int>(len),
+                                      static_cast<int>(cap), ctx->level);
+            packed = n > 0 ? static_cast<std::size_t>(n) : 0;
+            break;
+        }
+#endif
+#ifdef TAWQA_HAVE_ZSTD
+        case TAWQA_CODEC_ZSTD: {
+            std::size_t n = ZSTD_compressCCtx(ctx->zc, dst, cap, src, len, ctx->level);
+            packed = ZSTD_isError(n) ? 0 : n;
+            break;
+        }
+#endif
+        default:
+            (void)src;
+            (void)dst;
+            (void)cap;
+            break;
+    }
+
+    return packed < len ? packed : 0;
+}
+
+static bool tawqa_codec_decode(tawqa_codec_ctx* ctx, const char* src, std::size_t len,
+                               char* dst, std::size_t raw_len) {
+    switch (ctx->codec) {
+#ifdef TAWQA_HAVE_LZ4
+        case TAWQA_CODEC_LZ4:
+            return LZ4_decompress_safe(src, dst, static_cast<int>(len),
+                                       static_cast<int>(raw_len)) == static_cast<int>(raw_len);
+#endif
+#ifdef TAWQA_HAVE_ZSTD
+        case TAWQA_CODEC_ZSTD: {
+            std::size_t n = ZSTD_decompressDCtx(ctx->zd, dst, raw_len, src, len);
+            return !ZSTD_isError(n) && n == raw_len;
+        }
+#endif
+        default:
+            (void)src;
+            (void)len;
+            (void)dst;
+            (void)raw_len;
+            return false;
+    }
+}
+
+// Reader side of the pipeline: stdin -> frames -> relay
+static void tawqa_encode_loop(int in_fd, int pipe_fd) {
+    tawqa_codec_ctx ctx;
+    tawqa_codec_ctx_init(&ctx, g_opts.codec, g_opts.level);
+
+    std::vector<char> raw(TAWQA_COMPRESS_CHUNK);
+    std::vector<char> frame(TAWQA_COMPRESS_HDR + tawqa_codec_bound(g_opts.codec, raw.size()));
+    auto* hdr = reinterpret_cast<unsigned char*>(frame.data());
+
+    std::memcpy(hdr, TAWQA_COMPRESS_MAGIC, sizeof(TAWQA_COMPRESS_MAGIC));
+    hdr[4] = TAWQA_COMPRESS_VERSION;
+    hdr[5] = g_opts.codec;
+    hdr[6] = static_cast<unsigned char>(g_opts.level);
+    hdr[7] = 0;
+    bool alive = tawqa_writen(pipe_fd, hdr, TAWQA_COMPRESS_HDR) == TAWQA_COMPRESS_HDR;
+
+    while (alive) {
+        ssize_t n = read(in_fd, raw.data(), raw.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        auto len = static_cast<std::size_t>(n);
+        std::uint64_t start = tawqa_now_ns();
+        std::size_t packed = tawqa_codec_encode(&ctx, raw.data(), len,
+                                                frame.data() + TAWQA_COMPRESS_HDR,
+                                                frame.size() - TAWQA_COMPRESS_HDR);
+        g_enc_stats.busy_ns += tawqa_now_ns() - start;
+
+        if (packed == 0) {
+            std::memcpy(frame.data() + TAWQA_COMPRESS_HDR, raw.data(), len);
+            packed = len;
+        }
+
+        tawqa_put_be32(hdr, static_cast<std::uint32_t>(len));
+        tawqa_put_be32(hdr + 4, static_cast<std::uint32_t>(packed));
+        alive = tawqa_writen(pipe_fd, frame.data(), TAWQA_COMPRESS_HDR + packed)
+                == TAWQA_COMPRESS_HDR + packed;
+
+        g_enc_stats.raw += len;
+        g_enc_stats.packed += packed;
+    }
+
+    if (alive) {
+        std::memset(hdr, 0, TAWQA_COMPRESS_HDR);
+        tawqa_writen(pipe_fd, hdr, TAWQA_COMPRESS_HDR);
+    }
+
+    tawqa_codec_ctx_free(&ctx);
+    g_enc_done = true;
+    close(pipe_fd);
+}
+
+// Writer side of the pipeline: relay -> frames -> stdout
+static void tawqa_decode_loop(int pipe_fd, int out_fd) {
+    unsigned char hdr[TAWQA_COMPRESS_HDR];
+
+    if (tawqa_readn(pipe_fd, hdr, sizeof(hdr)) != sizeof(hdr)) {
+        close(pipe_fd);
+        return; // peer sent nothing at all
+    }
+    if (std::memcmp(hdr, TAWQA_COMPRESS_MAGIC, sizeof(TAWQA_COMPRESS_MAGIC)) != 0 ||
+        hdr[4] != TAWQA_COMPRESS_VERSION) {
+        tawqa_bail("Peer is not sending a tawqa compressed stream");
+    }
+
+    // Each side only announces its codec, nothing is negotiated: a peer
+    // configured differently is a setup mistake, so stop at its header
+    g_peer_codec = static_cast<tawqa_codec>(hdr[5]);
+    if (g_peer_codec != g_opts.codec) {
+        tawqa_bail("Peer compresses with %s, we use %s", tawqa_codec_name(g_peer_codec),
+                   tawqa_codec_name(g_opts.codec));
+    }
+
+    tawqa_codec_ctx ctx;
+    tawqa_codec_ctx_init(&ctx, g_peer_codec, hdr[6]);
+    std::vector<char> packed;
+    std::vector<char> raw;
+    bool ended = false;
+
+    while (tawqa_readn(pipe_fd, hdr, sizeof(hdr)) == sizeof(hdr)) {
+        std::uint32_t raw_len = tawqa_get_be32(hdr);
+        std::uint32_t packed_len = tawqa_get_be32(hdr + 4);
+
+        if (raw_len == 0) {
+            ended = true;
+            break;
+        }
+        if (raw_len > TAWQA_COMPRESS_MAX_FRAME || packed_len > raw_len) {
+            tawqa_bail("Corrupt compressed frame");
+        }
+
+        packed.resize(packed_len);
+        if (tawqa_readn(pipe_fd, packed.data(), packed_len) != packed_len) {
+            break;
+        }
+
+        const char* out = packed.data();
+        if (packed_len < raw_len) {
+            raw.resize(raw_len);
+            std::uint64_t start = tawqa_now_ns();
+            if (!tawqa_codec_decode(&ctx, packed.data(), packed_len, raw.data(), raw_len)) {
+                tawqa_bail("Corrupt compressed frame");
+            }
+            g_dec_stats.busy_ns += tawqa_now_ns() - start;
+            out = raw.data();
+        }
+
+        g_dec_stats.packed += packed_len;
+        g_dec_stats.raw += raw_len;
+        if (tawqa_writen(out_fd, out, raw_len) != raw_len) {
+            break;
+        }
+    }
+
+    if (!ended) {
+        errno = 0;
+        tawqa_holler("Compressed stream truncated");
+    }
+
+    tawqa_codec_ctx_free(&ctx);
+    close(pipe_fd);
+}
+
+static void tawqa_compress_pipe(int fds[2]) {
+    if (pipe(fds) < 0) {
+        tawqa_bail("Can't create compression pipe");
+    }
+#ifdef F_SETPIPE_SZ
+    // Deeper pipes let the codec run a few frames ahead of the network
+    fcntl(fds[1], F_SETPIPE_SZ, TAWQA_COMPRESS_PIPE_SIZE);
+#endif
+}
+
+// Ctrl-C, or a codec thread that bailed, leaves through exit() with the
+// threads still running; a joinable one there would abort the process
+static void tawqa_compress_exit() {
+    for (std::thread* t : {&g_enc_thread, &g_dec_thread}) {
+        if (t->joinable()) {
+            t->detach();
+        }
+    }
+}
+
+void tawqa_compress_start(const tawqa_compress_opts* opts, int in_fd, int out_fd,
+                          int* relay_in, int* relay_out) {
+    int enc[2], dec[2];
+
+    g_opts = *opts;
+    tawqa_compress_pipe(enc);
+    tawqa_compress_pipe(dec);
+
+    // A codec thread must see EPIPE rather than kill the process
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sigset_t saved;
+    tawqa_signals_block(&saved);
+    g_enc_thread = std::thread(tawqa_encode_loop, in_fd, enc[1]);
+    g_dec_thread = std::thread(tawqa_decode_loop, dec[0], out_fd);
+    tawqa_signals_restore(&saved);
+    std::atexit(tawqa_compress_exit);
+
+    *relay_in = enc[0];
+    *relay_out = dec[1];
+}
+
+void tawqa_compress_finish(int relay_in, int relay_out) {
+    close(relay_out);
+    g_dec_thread.join();
+
+    // The encoder may still be parked in read() on an idle stdin
+    close(relay_in);
+    if (g_enc_done) {
+        g_enc_thread.join();
+    } else {
+        g_enc_thread.detach();
+    }
+}
+
+static void tawqa_compress_report_dir(const char* verb, tawqa_codec codec,
+                                      const tawqa_codec_stats* stats) {
+    std::uint64_t raw = stats->raw;
+    std::uint64_t packed = stats->packed;
+    std::uint64_t busy = stats->busy_ns;
+    if (raw == 0) {
+        return;
+    }
+
+    char line[160];
+    int len = std::snprintf(line, sizeof(line), "%s %s: %llu raw, %llu on wire (ratio %.2f)",
+                            verb, tawqa_codec_name(codec),
+                            static_cast<unsigned long long>(raw),
+                            static_cast<unsigned long long>(packed),
+                            packed ? static_cast<double>(raw) / packed : 0.0);
+    if (busy && len > 0 && static_cast<std::size_t>(len) < sizeof(line)) {
+        std::snprintf(line + len, sizeof(line) - len, ", codec %.1f MB/s",
+                      static_cast<double>(raw) * 1e3 / busy);
+    }
+    errno = 0;
+    tawqa_holler("%s", line);
+}
+
+void tawqa_compress_report() {
+    tawqa_compress_report_dir("Compressed", g_opts.codec, &g_enc_stats);
+    tawqa_compress_report_dir("Decompressed", g_peer_codec, &g_dec_stats);
+}
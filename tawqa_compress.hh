@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef TAWQA_COMPRESS_HH_INCLUDED
+#define TAWQA_COMPRESS_HH_INCLUDED
+
+// TAWQA Compression Header
+// Framed LZ4/Zstd stream between two tawqa peers
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstdint>
+
+// Codecs are opt-in at build time: -DTAWQA_HAVE_LZ4 / -DTAWQA_HAVE_ZSTD
+enum tawqa_codec : std::uint8_t {
+    TAWQA_CODEC_NONE = 0,
+    TAWQA_CODEC_LZ4 = 1,
+    TAWQA_CODEC_ZSTD = 2,
+};
+
+struct tawqa_compress_opts {
+    tawqa_codec codec;
+    int level;
+};
+
+// Parse "lz4" or "zstd[:level]"; false if unknown or not compiled in
+bool tawqa_compress_parse(const char* spec, tawqa_compress_opts* opts);
+
+// Start the codec threads. Each side compresses what it reads from
+// `in_fd` and decompresses the peer's stream onto `out_fd`; the peer must
+// announce the same codec. The relay then uses *relay_in / *relay_out.
+void tawqa_compress_start(const tawqa_compress_opts* opts, int in_fd, int out_fd,
+                          int* relay_in, int* relay_out);
+
+// Close the relay-side ends, wait for the decoder to drain
+void tawqa_compress_finish(int relay_in, int relay_out);
+
+// Ratio and throughput for the verbose summary
+void tawqa_compress_report();
+
+#endif // TAWQA_COMPRESS_HH_INCLUDED
@@ -3,6 +3,7 @@
 // Using TAWQA prefix to avoid naming conflicts
 
 #include "tawqa_generic.hh"
+#include "tawqa_line.hh"
 #include <cstdlib>
 #include <cstring>
 #include <unistd.h>
@@ -19,10 +20,6 @@
 // Global variables
 static char* tawqa_program_path = nullptr;
 
-// Function declarations
-void tawqa_holler(const char* str, const char* p1 = nullptr, 
-                  const char* p2 = nullptr, const char* p3 = nullptr);
-
 // Session data structure (C-style, no OOP)
 struct tawqa_session_data {
     int read_pipe_fd;
@@ -99,6 +96,7 @@ static void tawqa_shell_to_client(int read_pipe, int client_socket) {
     constexpr size_t buffer_size = TAWQA_BUFFER_SIZE;
     char buffer[buffer_size];
     char output_buffer[buffer_size * 2];
+    char prev_char = 0;
     
     while (true) {
         ssize_t bytes_read = read(read_pipe, buffer, buffer_size);
@@ -106,16 +104,9 @@ static void tawqa_shell_to_client(int read_pipe, int client_socket) {
             break;
         }
         
-        // Process data: convert LF to CRLF
-        size_t output_pos = 0;
-        char prev_char = 0;
-        
-        for (ssize_t i = 0; i < bytes_read; ++i) {
-            if (buffer[i] == '\n' && prev_char != '\r') {
-                output_buffer[output_pos++] = '\r';
-            }
-            prev_char = output_buffer[output_pos++] = buffer[i];
-        }
+        // Process data: convert LF to CRLF, carrying the last byte across reads
+        size_t output_pos = tawqa_crlf_expand(buffer, static_cast<size_t>(bytes_read),
+                                              output_buffer, &prev_char);
         
         if (send(client_socket, output_buffer, output_pos, 0) <= 0) {
             break;
@@ -125,32 +116,28 @@ static void tawqa_shell_to_client(int read_pipe, int client_socket) {
 
 // Handle data transfer from client to shell
 static void tawqa_client_to_shell(int client_socket, int write_pipe) {
-    char recv_buffer[1];
-    char line_buffer[TAWQA_BUFFER_SIZE];
-    size_t buffer_pos = 0;
+    char recv_buffer[TAWQA_SHELL_LINE];
+    tawqa_shell_lines lines = {};
     
-    while (recv(client_socket, recv_buffer, 1, 0) > 0) {
-        line_buffer[buffer_pos++] = recv_buffer[0];
-        
-        if (recv_buffer[0] == '\r') {
-            line_buffer[buffer_pos++] = '\n';
-        }
-        
-        // Check for exit command
-        if (buffer_pos >= 6 && 
-            strncasecmp(line_buffer, "exit\r\n", 6) == 0) {
+    while (true) {
+        ssize_t bytes_read = recv(client_socket, recv_buffer, sizeof(recv_buffer), 0);
+        if (bytes_read <= 0) {
             break;
         }
         
-        // Send line when complete or buffer full
-        if (recv_buffer[0] == '\n' || recv_buffer[0] == '\r' || 
-            buffer_pos >= TAWQA_BUFFER_SIZE - 1) {
-            
-            if (write(write_pipe, line_buffer, buffer_pos) == -1) {
-                break;
+        // Send complete lines; on exit only the ones before it
+        size_t ready = 0;
+        bool done = tawqa_shell_feed(&lines, recv_buffer, static_cast<size_t>(bytes_read), &ready);
+        if (ready && write(write_pipe, lines.buf, ready) == -1) {
+            if (done) {
+                tawqa_holler("Failed to write to shell");
             }
-            buffer_pos = 0;
+            break;
+        }
+        if (done) {
+            return;
         }
+        tawqa_shell_consume(&lines, ready);
     }
 }
 
@@ -0,0 +1,249 @@
+// TAWQA Hex Dump Implementation
+// SPSC ring between the relay and a formatting thread, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_dump.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_netio.hh"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+constexpr std::size_t TAWQA_DUMP_SLOTS = 64;
+constexpr std::size_t TAWQA_DUMP_LINE = 16;
+constexpr std::size_t TAWQA_DUMP_OUTBUF = 64 * 1024;
+
+// Directions index the per-direction arrays: 0 sent ('>'), 1 received
+static int tawqa_dump_side(char dir) {
+    return dir == '>' ? 0 : 1;
+}
+
+static const char* g_side_names[2] = {"sent", "received"};
+
+// One captured chunk plus whatever was dropped just before it
+struct tawqa_dump_slot {
+    std::array<char, TAWQA_DUMP_SLOT_SIZE> data;
+    std::size_t len;
+    char dir;
+    std::uint64_t dropped_bytes[2];
+    std::uint64_t dropped_chunks[2];
+};
+
+// Formatting lookup tables, built once
+struct tawqa_dump_tables {
+    std::array<std::array<char, 3>, 256> hex;   // "xx "
+    std::array<char, 256> ascii;                // printable or '.'
+};
+
+static constexpr tawqa_dump_tables tawqa_dump_make_tables() {
+    tawqa_dump_tables t{};
+    constexpr char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 256; ++i) {
+        t.hex[i] = {digits[i >> 4], digits[i & 15], ' '};
+        t.ascii[i] = (i >= 0x20 && i < 0x7f) ? static_cast<char>(i) : '.';
+    }
+    return t;
+}
+
+static constexpr tawqa_dump_tables g_tables = tawqa_dump_make_tables();
+
+static std::array<tawqa_dump_slot, TAWQA_DUMP_SLOTS> g_slots;
+static std::atomic<std::uint64_t> g_head{0};   // next slot the relay fills
+static std::atomic<std::uint64_t> g_tail{0};   // next slot the writer drains
+static std::atomic<std::uint32_t> g_wake{0};   // writer parks on this
+static std::atomic<bool> g_stop{false};
+static std::thread g_writer;
+static int g_fd = -1;
+
+// Relay-side drop accounting, flushed into the next published slot
+static std::uint64_t g_pending_bytes[2] = {};
+static std::uint64_t g_pending_chunks[2] = {};
+static std::uint64_t g_total_dropped = 0;
+
+// Writer-side output buffer and per-direction offsets
+static char g_out[TAWQA_DUMP_OUTBUF];
+static std::size_t g_out_len = 0;
+static std::uint64_t g_offset[2] = {};
+
+static void tawqa_dump_flush() {
+    if (g_out_len && tawqa_writen(g_fd, g_out, g_out_len) != g_out_len) {
+        tawqa_holler("Hex dump write failed");
+    }
+    g_out_len = 0;
+}
+
+// Emit lines in netcat's -o layout: "< 00000010 68 65 ... # he..."
+static void tawqa_dump_format(char dir, const unsigned char* p, std::size_t len) {
+    std::uint64_t& offset = g_offset[tawqa_dump_side(dir)];
+    constexpr std::size_t line_max = 2 + 9 + TAWQA_DUMP_LINE * 3 + 2 + TAWQA_DUMP_LINE + 1;
+
+    while (len) {
+        std::size_t n = std::min(len, TAWQA_DUMP_LINE);
+        if (g_out_len + line_max > sizeof(g_out)) {
+            tawqa_dump_flush();
+        }
+
+        char* o = g_out + g_out_len;
+        *o++ = dir;
+        *o++ = ' ';
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            *o++ = "0123456789abcdef"[(offset >> shift) & 15];
+        }
+        *o++ = ' ';
+        for (std::size_t i = 0; i < TAWQA_DUMP_LINE; ++i) {
+            if (i < n) {
+                std::memcpy(o, g_tables.hex[p[i]].data(), 3);
+            } else {
+                std::memcpy(o, "   ", 3);
+            }
+            o += 3;
+        }
+        *o++ = '#';
+        *o++ = ' ';
+        for (std::size_t i = 0; i < n; ++i) {
+            *o++ = g_tables.ascii[p[i]];
+        }
+        *o++ = '\n';
+
+        g_out_len = static_cast<std::size_t>(o - g_out);
+        offset += n;
+        p += n;
+        len -= n;
+    }
+}
+
+// Note a gap in one direction; its offsets carry on past the skipped bytes
+static void tawqa_dump_skipped(int side, std::uint64_t bytes, std::uint64_t chunks) {
+    char note[112];
+    int n = std::snprintf(note, sizeof(note), "# overloaded, skipped %llu %s bytes in %llu chunks\n",
+                          static_cast<unsigned long long>(bytes), g_side_names[side],
+                          static_cast<unsigned long long>(chunks));
+    if (g_out_len + static_cast<std::size_t>(n) > sizeof(g_out)) {
+        tawqa_dump_flush();
+    }
+    std::memcpy(g_out + g_out_len, note, static_cast<std::size_t>(n));
+    g_out_len += static_cast<std::size_t>(n);
+    g_offset[side] += bytes;
+}
+
+static void tawqa_dump_loop() {
+    while (true) {
+        std::uint32_t wake = g_wake.load(std::memory_order_acquire);
+        std::uint64_t tail = g_tail.load(std::memory_order_relaxed);
+        std::uint64_t head = g_head.load(std::memory_order_acquire);
+
+        if (tail == head) {
+            tawqa_dump_flush();
+            if (g_stop.load(std::memory_order_acquire)) {
+                break;
+            }
+            g_wake.wait(wake, std::memory_order_acquire);
+            continue;
+        }
+
+        tawqa_dump_slot& slot = g_slots[tail % TAWQA_DUMP_SLOTS];
+        for (int side = 0; side < 2; ++side) {
+            if (slot.dropped_chunks[side]) {
+                tawqa_dump_skipped(side, slot.dropped_bytes[side], slot.dropped_chunks[side]);
+            }
+        }
+        tawqa_dump_format(slot.dir, reinterpret_cast<const unsigned char*>(slot.data.data()),
+                          slot.len);
+
+        g_tail.store(tail + 1, std::memory_order_release);
+    }
+}
+
+void tawqa_dump_start(int fd) {
+    g_fd = fd;
+    sigset_t saved;
+    tawqa_signals_block(&saved);
+    g_writer = std::thread(tawqa_dump_loop);
+    tawqa_signals_restore(&saved);
+
+    // Ctrl-C and bail leave through exit(), which must not find the writer
+    // still joinable; a no-op after the relay's own tawqa_dump_stop
+    std::atexit(tawqa_dump_stop);
+}
+
+char* tawqa_dump_acquire() {
+    std::uint64_t head = g_head.load(std::memory_order_relaxed);
+    if (head - g_tail.load(std::memory_order_acquire) >= TAWQA_DUMP_SLOTS) {
+        return nullptr;
+    }
+    return g_slots[head % TAWQA_DUMP_SLOTS].data.data();
+}
+
+void tawqa_dump_commit(char dir, const char* buf, std::size_t len) {
+    // Zerocopy pool buffers outgrow a slot, copy them in slot-sized pieces
+    while (len > TAWQA_DUMP_SLOT_SIZE) {
+        tawqa_dump_commit(dir, buf, TAWQA_DUMP_SLOT_SIZE);
+        buf += TAWQA_DUMP_SLOT_SIZE;
+        len -= TAWQA_DUMP_SLOT_SIZE;
+    }
+
+    std::uint64_t head = g_head.load(std::memory_order_relaxed);
+    tawqa_dump_slot& slot = g_slots[head % TAWQA_DUMP_SLOTS];
+
+    // A chunk read outside the ring is copied if a slot is free (small
+    // paced lines), otherwise only counted, never waited on
+    if (buf != slot.data.data() &&
+        head - g_tail.load(std::memory_order_acquire) < TAWQA_DUMP_SLOTS) {
+        std::memcpy(slot.data.data(), buf, len);
+    } else if (buf != slot.data.data()) {
+        int side = tawqa_dump_side(dir);
+        g_pending_bytes[side] += len;
+        g_pending_chunks[side] += 1;
+        g_total_dropped += len;
+        return;
+    }
+
+    slot.len = len;
+    slot.dir = dir;
+    for (int side = 0; side < 2; ++side) {
+        slot.dropped_bytes[side] = g_pending_bytes[side];
+        slot.dropped_chunks[side] = g_pending_chunks[side];
+        g_pending_bytes[side] = g_pending_chunks[side] = 0;
+    }
+
+    g_head.store(head + 1, std::memory_order_release);
+    g_wake.fetch_add(1, std::memory_order_release);
+    g_wake.notify_one();
+}
+
+void tawqa_dump_stop() {
+    if (g_fd < 0) {
+        return;
+    }
+
+    g_stop.store(true, std::memory_order_release);
+    g_wake.fetch_add(1, std::memory_order_release);
+    g_wake.notify_one();
+    if (g_writer.get_id() == std::this_thread::get_id()) {
+        // The writer itself bailed, nothing is left to drain
+        g_writer.detach();
+        g_fd = -1;
+        return;
+    }
+    g_writer.join();
+
+    for (int side = 0; side < 2; ++side) {
+        if (g_pending_chunks[side]) {
+            tawqa_dump_skipped(side, g_pending_bytes[side], g_pending_chunks[side]);
+        }
+    }
+    tawqa_dump_flush();
+    if (g_total_dropped) {
+        char num[24];
+        std::snprintf(num, sizeof(num), "%llu", static_cast<unsigned long long>(g_total_dropped));
+        errno = 0;
+        tawqa_holler("Hex dump summarized %s bytes under load", num);
+    }
+    g_fd = -1;
+}
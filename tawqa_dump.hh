@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef TAWQA_DUMP_HH_INCLUDED
+#define TAWQA_DUMP_HH_INCLUDED
+
+// TAWQA Hex Dump Header
+// Asynchronous -o traffic capture fed by the relay
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstddef>
+
+constexpr std::size_t TAWQA_DUMP_SLOT_SIZE = 8192;
+
+// Start the writer thread formatting into `fd`
+void tawqa_dump_start(int fd);
+
+// Borrow the next free ring slot to read into, so the relay hands the
+// writer its buffer by reference. nullptr when the ring is full: the
+// relay then uses its own buffer and the chunk is only summarized.
+char* tawqa_dump_acquire();
+
+// Publish `len` bytes for direction '<' (received) or '>' (sent). Data
+// in an acquired slot must not be modified after this call; other
+// buffers are copied into a free slot or summarized as dropped.
+void tawqa_dump_commit(char dir, const char* buf, std::size_t len);
+
+// Drain the ring, stop the writer and report any dropped data
+void tawqa_dump_stop();
+
+#endif // TAWQA_DUMP_HH_INCLUDED
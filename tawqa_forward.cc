@@ -0,0 +1,209 @@
+// TAWQA Forwarding Proxy Implementation
+// Non-blocking epoll loop with per-connection splice pipes, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_forward.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_metrics.hh"
+#include "tawqa_netio.hh"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+constexpr int TAWQA_FWD_PIPE_SIZE = 256 * 1024;
+constexpr int TAWQA_FWD_EVENTS = 64;
+
+struct tawqa_fwd_conn {
+    int client;
+    int upstream;
+    bool connecting;       // upstream connect() still in flight
+    std::uint64_t connect_start_ns;
+    tawqa_metrics_conn* metrics;
+    tawqa_splice_dir up;   // client -> upstream
+    tawqa_splice_dir down; // upstream -> client
+    char peer[32];
+};
+
+static int g_epfd = -1;
+static char g_listen_tag;   // epoll cookie of the listening socket
+static unsigned g_fwd_live = 0;
+static tawqa_metrics_shard* g_fwd_metrics = nullptr;
+
+static void tawqa_fwd_close(tawqa_fwd_conn* conn, const char* why) {
+    static char up_str[24], down_str[24];
+    std::snprintf(up_str, sizeof(up_str), "%llu", static_cast<unsigned long long>(conn->up.moved));
+    std::snprintf(down_str, sizeof(down_str), "%llu", static_cast<unsigned long long>(conn->down.moved));
+    tawqa_holler(why, conn->peer, up_str, down_str);
+    tawqa_metrics_close(g_fwd_metrics, conn->metrics);
+    close(conn->client);
+    close(conn->upstream);
+    tawqa_splice_close(&conn->up);
+    tawqa_splice_close(&conn->down);
+    std::free(conn);
+    g_fwd_live -= 1;
+}
+
+static void tawqa_fwd_event(tawqa_fwd_conn* conn) {
+    if (conn->connecting) {
+        // The event may be the client's; SO_ERROR is 0 both while the
+        // connect is in flight and once it succeeded, only a peer name
+        // tells them apart
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(conn->upstream, SOL_SOCKET, SO_ERROR, &err, &len);
+        struct sockaddr_storage peer;
+        socklen_t peer_len = sizeof(peer);
+        if (!err && getpeername(conn->upstream, reinterpret_cast<struct sockaddr*>(&peer), &peer_len) < 0) {
+            err = errno;
+        }
+        if (err == ENOTCONN || err == EINPROGRESS || err == EALREADY) {
+            return;
+        }
+        if (err) {
+            errno = err;
+            tawqa_fwd_close(conn, "Upstream connect for %s failed");
+            return;
+        }
+        conn->connecting = false;
+        tawqa_metrics_connected(g_fwd_metrics, tawqa_now_ns() - conn->connect_start_ns);
+    }
+
+    std::uint64_t up_was = conn->up.moved, down_was = conn->down.moved;
+    bool ok = tawqa_splice_pump(&conn->up) && tawqa_splice_pump(&conn->down);
+    tawqa_metrics_in(g_fwd_metrics, conn->metrics, conn->up.moved - up_was);
+    tawqa_metrics_out(g_fwd_metrics, conn->metrics, conn->down.moved - down_was);
+    if (!ok) {
+        tawqa_fwd_close(conn, "Reset %s: sent %s, received %s");
+        return;
+    }
+    if (conn->up.shut && conn->down.shut) {
+        errno = 0;
+        tawqa_fwd_close(conn, "Closed %s: sent %s, received %s");
+    }
+}
+
+static void tawqa_fwd_accept(int listenfd, const struct sockaddr_in* target,
+                             const tawqa_sockopts* opts) {
+    while (true) {
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        int client = accept4(listenfd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len,
+                             SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                tawqa_holler("accept failed");
+            }
+            return;
+        }
+
+        auto* conn = static_cast<tawqa_fwd_conn*>(std::calloc(1, sizeof(tawqa_fwd_conn)));
+        int upstream = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (!conn || upstream < 0) {
+            tawqa_holler("Out of resources, dropping connection");
+            close(client);
+            if (upstream >= 0) {
+                close(upstream);
+            }
+            std::free(conn);
+            continue;
+        }
+        g_fwd_live += 1;
+        conn->client = client;
+        conn->upstream = upstream;
+        conn->up.pipe_rd = conn->down.pipe_rd = -1;
+        if (addr.ss_family == AF_INET) {
+            const auto* sin = reinterpret_cast<const struct sockaddr_in*>(&addr);
+            std::snprintf(conn->peer, sizeof(conn->peer), "%s:%u", inet_ntoa(sin->sin_addr),
+                          ntohs(sin->sin_port));
+        } else {
+            std::snprintf(conn->peer, sizeof(conn->peer), "local");
+        }
+        conn->metrics = tawqa_metrics_open(g_fwd_metrics, conn->peer);
+
+        tawqa_sockopt_apply(client, opts, addr.ss_family == AF_INET);
+        tawqa_sockopt_apply(upstream, opts, true);
+        if (!tawqa_splice_open(&conn->up, client, upstream, TAWQA_FWD_PIPE_SIZE) ||
+            !tawqa_splice_open(&conn->down, upstream, client, TAWQA_FWD_PIPE_SIZE)) {
+            tawqa_fwd_close(conn, "No pipes for %s");
+            continue;
+        }
+
+        conn->connect_start_ns = tawqa_now_ns();
+        int rc = connect(upstream, reinterpret_cast<const struct sockaddr*>(target), sizeof(*target));
+        if (rc < 0 && errno != EINPROGRESS) {
+            tawqa_fwd_close(conn, "Upstream connect for %s failed");
+            continue;
+        }
+        conn->connecting = rc < 0;
+        if (!conn->connecting) {
+            tawqa_metrics_connected(g_fwd_metrics, tawqa_now_ns() - conn->connect_start_ns);
+        }
+
+        // Edge-triggered: every wakeup pumps both directions to EAGAIN
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn;
+        epoll_ctl(g_epfd, EPOLL_CTL_ADD, client, &ev);
+        epoll_ctl(g_epfd, EPOLL_CTL_ADD, upstream, &ev);
+
+        static char live_str[16];
+        std::snprintf(live_str, sizeof(live_str), "%u", g_fwd_live);
+        errno = 0;
+        tawqa_holler("Forwarding %s [%s open]", conn->peer, live_str);
+    }
+}
+
+void tawqa_forward_run(int listenfd, const struct sockaddr_in* target, const tawqa_sockopts* opts) {
+    // A peer resetting mid-splice must not take the proxy down
+    std::signal(SIGPIPE, SIG_IGN);
+    g_fwd_metrics = tawqa_metrics_shard_new();
+
+    fcntl(listenfd, F_SETFL, fcntl(listenfd, F_GETFL) | O_NONBLOCK);
+    g_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_epfd < 0) {
+        tawqa_bail("epoll_create1 failed");
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &g_listen_tag;
+    epoll_ctl(g_epfd, EPOLL_CTL_ADD, listenfd, &ev);
+
+    struct epoll_event events[TAWQA_FWD_EVENTS];
+    while (true) {
+        int n = epoll_wait(g_epfd, events, TAWQA_FWD_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            tawqa_bail("epoll_wait failed");
+        }
+
+        // Both sockets of a connection may report in one batch; it is
+        // pumped once and later duplicates are dropped, as it may be freed
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr == &g_listen_tag) {
+                tawqa_fwd_accept(listenfd, target, opts);
+                continue;
+            }
+            auto* conn = static_cast<tawqa_fwd_conn*>(events[i].data.ptr);
+            if (!conn) {
+                continue;
+            }
+            for (int j = i + 1; j < n; ++j) {
+                if (events[j].data.ptr == conn) {
+                    events[j].data.ptr = nullptr;
+                }
+            }
+            tawqa_fwd_event(conn);
+        }
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#ifndef TAWQA_FORWARD_HH_INCLUDED
+#define TAWQA_FORWARD_HH_INCLUDED
+
+// TAWQA Forwarding Proxy Header
+// --forward: accepted connections spliced to an upstream TCP endpoint
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_sockopt.hh"
+#include <netinet/in.h>
+
+// Accept on `listenfd` forever, connecting each client to `target` and
+// relaying both directions through kernel pipes with splice(). All
+// sockets are non-blocking and driven by one epoll loop.
+[[noreturn]] void tawqa_forward_run(int listenfd, const struct sockaddr_in* target,
+                                    const tawqa_sockopts* opts);
+
+#endif // TAWQA_FORWARD_HH_INCLUDED
@@ -0,0 +1,200 @@
+// TAWQA Generator / Discard Implementation
+// One repeating block serves as both source and reference, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_gen.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_netio.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr std::size_t TAWQA_GEN_BLOCK = 1024 * 1024;          // generated period
+constexpr std::size_t TAWQA_GEN_FILE_MAX = 64 * 1024 * 1024;  // file block cap
+constexpr std::uint64_t TAWQA_GEN_SEED = 0x7461777161UL;     // "tawqa"
+
+static char* g_block = nullptr;
+static std::size_t g_block_len = 0;
+static std::size_t g_gen_pos = 0;
+static std::uint64_t g_gen_left = 0;
+static bool g_gen_limited = false;
+
+static char* g_sink = nullptr;
+static char* g_ref = nullptr;                 // pattern block the sink checks against
+static std::uint64_t g_mismatch_at = ~0ULL;
+
+static std::uint64_t g_sent = 0;
+static std::uint64_t g_received = 0;
+static std::uint64_t g_start_ns = 0;
+static std::uint64_t g_next_ns = 0;
+static std::uint64_t g_last_ns = 0;
+static std::uint64_t g_last_sent = 0;
+static std::uint64_t g_last_received = 0;
+static unsigned g_tick = 0;
+
+bool tawqa_gen_parse(const char* spec, tawqa_gen_opts* opts) {
+    if (std::strcmp(spec, "zero") == 0) {
+        opts->kind = TAWQA_GEN_ZERO;
+    } else if (std::strcmp(spec, "pattern") == 0) {
+        opts->kind = TAWQA_GEN_PATTERN;
+    } else if (std::strncmp(spec, "file:", 5) == 0 && spec[5]) {
+        opts->kind = TAWQA_GEN_FILE;
+        opts->file = spec + 5;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static char* tawqa_gen_alloc(std::size_t len) {
+    auto* block = static_cast<char*>(std::aligned_alloc(4096, (len + 4095) & ~std::size_t{4095}));
+    if (!block) {
+        tawqa_bail("Can't allocate generator block");
+    }
+    return block;
+}
+
+// xorshift64*, identical on both peers so the receiver can check it
+static char* tawqa_gen_pattern() {
+    char* block = tawqa_gen_alloc(TAWQA_GEN_BLOCK);
+    std::uint64_t x = TAWQA_GEN_SEED;
+    for (std::size_t i = 0; i < TAWQA_GEN_BLOCK; i += sizeof(x)) {
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        std::uint64_t v = x * 0x2545F4914F6CDD1DULL;
+        std::memcpy(block + i, &v, sizeof(v));
+    }
+    return block;
+}
+
+static void tawqa_gen_load_file(const char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+        tawqa_bail("Can't use %s as generator block", path);
+    }
+    g_block_len = std::min(static_cast<std::size_t>(st.st_size), TAWQA_GEN_FILE_MAX);
+    g_block = tawqa_gen_alloc(g_block_len);
+    if (tawqa_readn(fd, g_block, g_block_len) != g_block_len) {
+        tawqa_bail("Can't read %s", path);
+    }
+    close(fd);
+}
+
+void tawqa_gen_init(const tawqa_gen_opts* opts, bool discard, bool verify) {
+    switch (opts->kind) {
+        case TAWQA_GEN_ZERO:
+            g_block_len = TAWQA_GEN_BLOCK;
+            g_block = tawqa_gen_alloc(g_block_len);
+            std::memset(g_block, 0, g_block_len);
+            break;
+        case TAWQA_GEN_PATTERN:
+            g_block_len = TAWQA_GEN_BLOCK;
+            g_block = tawqa_gen_pattern();
+            break;
+        case TAWQA_GEN_FILE:
+            tawqa_gen_load_file(opts->file);
+            break;
+        case TAWQA_GEN_NONE:
+            break;
+    }
+    g_gen_left = opts->limit;
+    g_gen_limited = opts->limit != 0;
+
+    if (discard) {
+        g_sink = tawqa_gen_alloc(TAWQA_GEN_CHUNK);
+    }
+    if (verify) {
+        g_ref = opts->kind == TAWQA_GEN_PATTERN ? g_block : tawqa_gen_pattern();
+    }
+
+    g_start_ns = g_last_ns = tawqa_now_ns();
+    g_next_ns = g_start_ns + 1000000000ULL;
+}
+
+std::size_t tawqa_gen_next(char** data, std::size_t want) {
+    // Runs stop at the block end so every chunk is one contiguous slice
+    want = std::min(want, g_block_len - g_gen_pos);
+    if (g_gen_limited) {
+        want = static_cast<std::size_t>(std::min<std::uint64_t>(want, g_gen_left));
+        g_gen_left -= want;
+    }
+    *data = g_block + g_gen_pos;
+    g_gen_pos += want;
+    if (g_gen_pos == g_block_len) {
+        g_gen_pos = 0;
+    }
+    g_sent += want;
+    return want;
+}
+
+char* tawqa_discard_buffer() {
+    return g_sink;
+}
+
+void tawqa_discard(const char* buf, std::size_t len) {
+    if (g_ref && g_mismatch_at == ~0ULL) {
+        std::uint64_t off = g_received;
+        std::size_t done = 0;
+        while (done < len) {
+            std::size_t at = static_cast<std::size_t>((off + done) % TAWQA_GEN_BLOCK);
+            std::size_t run = std::min(len - done, TAWQA_GEN_BLOCK - at);
+            if (std::memcmp(buf + done, g_ref + at, run) != 0) {
+                for (std::size_t i = 0; i < run; ++i) {
+                    if (buf[done + i] != g_ref[at + i]) {
+                        g_mismatch_at = off + done + i;
+                        break;
+                    }
+                }
+                break;
+            }
+            done += run;
+        }
+    }
+    g_received += len;
+}
+
+static void tawqa_gen_line(const char* label, std::uint64_t sent, std::uint64_t received, double secs) {
+    std::fprintf(stderr, "%s %10.1f MB/s out %10.1f MB/s in %12llu bytes out %12llu bytes in\n", label,
+                 static_cast<double>(sent) / 1e6 / secs, static_cast<double>(received) / 1e6 / secs,
+                 static_cast<unsigned long long>(g_sent), static_cast<unsigned long long>(g_received));
+}
+
+std::uint64_t tawqa_gen_report(std::uint64_t now_ns) {
+    if (now_ns < g_next_ns) {
+        return g_next_ns - now_ns;
+    }
+    char label[16];
+    std::snprintf(label, sizeof(label), "[%4us]", ++g_tick);
+    tawqa_gen_line(label, g_sent - g_last_sent, g_received - g_last_received,
+                   static_cast<double>(now_ns - g_last_ns) / 1e9);
+    g_last_sent = g_sent;
+    g_last_received = g_received;
+    g_last_ns = now_ns;
+    g_next_ns += 1000000000ULL;
+    if (g_next_ns <= now_ns) {
+        g_next_ns = now_ns + 1000000000ULL;
+    }
+    return g_next_ns - now_ns;
+}
+
+bool tawqa_gen_finish() {
+    double secs = static_cast<double>(tawqa_now_ns() - g_start_ns) / 1e9;
+    tawqa_gen_line("[total]", g_sent, g_received, secs > 0 ? secs : 1e-9);
+    if (!g_ref) {
+        return true;
+    }
+    if (g_mismatch_at != ~0ULL) {
+        std::fprintf(stderr, "[total] pattern mismatch at byte %llu\n",
+                     static_cast<unsigned long long>(g_mismatch_at));
+        return false;
+    }
+    std::fprintf(stderr, "[total] pattern verified, %llu bytes\n", static_cast<unsigned long long>(g_received));
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef TAWQA_GEN_HH_INCLUDED
+#define TAWQA_GEN_HH_INCLUDED
+
+// TAWQA Generator / Discard Header
+// In-memory source and sink for measuring the network path alone
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstddef>
+#include <cstdint>
+
+// Largest chunk handed to the relay per send or recv
+constexpr std::size_t TAWQA_GEN_CHUNK = 256 * 1024;
+
+enum tawqa_gen_kind : std::uint8_t {
+    TAWQA_GEN_NONE = 0,
+    TAWQA_GEN_ZERO,            // zeros
+    TAWQA_GEN_PATTERN,         // fixed-seed PRNG stream, checkable by --discard-verify
+    TAWQA_GEN_FILE,            // a file's contents repeated from memory
+};
+
+struct tawqa_gen_opts {
+    tawqa_gen_kind kind;
+    const char* file;
+    std::uint64_t limit;       // bytes to send, 0: until the peer or ^C stops us
+};
+
+// Parse "zero", "pattern" or "file:path"
+bool tawqa_gen_parse(const char* spec, tawqa_gen_opts* opts);
+
+// Build the in-memory block; with `discard` the sink is set up as well
+// (`verify`: check received data against the pattern stream)
+void tawqa_gen_init(const tawqa_gen_opts* opts, bool discard, bool verify);
+
+// Next run of generated bytes, at most `want`; 0 once the limit is sent
+std::size_t tawqa_gen_next(char** data, std::size_t want);
+
+// Receive buffer for the discard sink
+char* tawqa_discard_buffer();
+
+// Account (and with verify, check) `len` received bytes
+void tawqa_discard(const char* buf, std::size_t len);
+
+// Print the last second's throughput once a second has passed;
+// returns ns until the next report is due
+std::uint64_t tawqa_gen_report(std::uint64_t now_ns);
+
+// Whole-run totals; false if verification found a mismatch
+bool tawqa_gen_finish();
+
+#endif // TAWQA_GEN_HH_INCLUDED
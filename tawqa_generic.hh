@@ -7,7 +7,9 @@
 // Modern C++23 port of netcat's generic.h
 // Using TAWQA prefix to avoid naming conflicts
 
+#include <csignal>
 #include <cstdint>
+#include <ctime>
 #include <string_view>
 
 // Feature detection macros
@@ -19,6 +21,8 @@
 #define TAWQA_HAVE_UTMPX
 #define TAWQA_HAVE_SETPRIORITY
 #define TAWQA_HAVE_SYSINFO
+#define TAWQA_HAVE_SENDFILE
+#define TAWQA_HAVE_ZEROCOPY
 
 // Standard headers availability
 #define TAWQA_HAVE_STDLIB_H
@@ -40,6 +44,8 @@
     // macOS specific settings
     #undef TAWQA_HAVE_UTMPX
     #undef TAWQA_HAVE_SYSINFO
+    #undef TAWQA_HAVE_SENDFILE
+    #undef TAWQA_HAVE_ZEROCOPY
 #endif
 
 #ifdef __linux__
@@ -52,6 +58,8 @@
 #ifdef __FreeBSD__
     #undef TAWQA_HAVE_UTMPX
     #undef TAWQA_HAVE_SYSINFO
+    #undef TAWQA_HAVE_SENDFILE
+    #undef TAWQA_HAVE_ZEROCOPY
     #undef TAWQA_HAVE_LASTLOG_H
     #undef TAWQA_HAVE_SYSMACROS_H
 #endif
@@ -59,6 +67,8 @@
 #ifdef __NetBSD__
     #undef TAWQA_HAVE_UTMPX
     #undef TAWQA_HAVE_SYSINFO
+    #undef TAWQA_HAVE_SENDFILE
+    #undef TAWQA_HAVE_ZEROCOPY
     #undef TAWQA_HAVE_LASTLOG_H
 #endif
 
@@ -73,11 +83,27 @@ constexpr std::size_t TAWQA_BUFFER_SIZE = 8192;
 constexpr std::size_t TAWQA_SMALL_BUFFER_SIZE = 256;
 constexpr std::uint16_t TAWQA_DEFAULT_PORT = 31337;
 
+// Monotonic clock in nanoseconds
+inline std::uint64_t tawqa_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
 // Function declarations
 void tawqa_holler(const char* str, const char* p1 = nullptr, 
                   const char* p2 = nullptr, const char* p3 = nullptr);
 void tawqa_bail(const char* str, const char* p1 = nullptr, 
                 const char* p2 = nullptr, const char* p3 = nullptr);
+
+// Bail if SIGINT/SIGTERM arrived; main-thread loops call it on EINTR
+void tawqa_check_interrupt();
+
+// Helper threads are spawned with SIGINT/SIGTERM blocked, so the signal
+// always lands on the main thread where the loops check for it
+void tawqa_signals_block(sigset_t* saved);
+void tawqa_signals_restore(const sigset_t* saved);
+
 bool tawqa_doexec(int client_socket);
 void tawqa_set_program_path(const char* path);
 void tawqa_doexec_cleanup();
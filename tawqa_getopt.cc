@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <string_view>
 #include <string>
+#include <vector>
 
 using namespace std::string_view_literals;
 
@@ -92,8 +93,77 @@ static const char* initialize_getopt(const char* optstring) noexcept {
     return optstring;
 }
 
+// Handle a "--name[=value]" element; nextchar points past the dashes
+static int tawqa_getopt_long_option(int argc, char* const* argv,
+                                    const tawqa::Option* longopts, int* longindex) {
+    std::string_view arg{nextchar};
+    std::string_view name = arg.substr(0, arg.find('='));
+    const tawqa::Option* match = nullptr;
+    bool ambiguous = false;
+
+    nextchar = nullptr;
+    ++optind;
+
+    // Exact match wins, otherwise accept a unique prefix
+    for (const tawqa::Option* o = longopts; !o->name.empty(); ++o) {
+        if (o->name == name) {
+            match = o;
+            ambiguous = false;
+            break;
+        }
+        if (o->name.substr(0, name.size()) == name) {
+            ambiguous = (match != nullptr);
+            match = o;
+        }
+    }
+
+    if (match == nullptr || ambiguous) {
+        if (opterr) {
+            std::fprintf(stderr, "%s: %s option '--%.*s'\n", argv[0],
+                         ambiguous ? "ambiguous" : "unrecognized",
+                         static_cast<int>(name.size()), name.data());
+        }
+        optopt = 0;
+        return '?';
+    }
+
+    if (longindex != nullptr) {
+        *longindex = static_cast<int>(match - longopts);
+    }
+
+    if (name.size() < arg.size()) {
+        if (!match->has_arg) {
+            if (opterr) {
+                std::fprintf(stderr, "%s: option '--%.*s' doesn't allow an argument\n",
+                             argv[0], static_cast<int>(name.size()), name.data());
+            }
+            optopt = match->val;
+            return '?';
+        }
+        optarg = const_cast<char*>(arg.data() + name.size() + 1);
+    } else if (match->has_arg) {
+        if (optind == argc) {
+            if (opterr) {
+                std::fprintf(stderr, "%s: option '--%.*s' requires an argument\n",
+                             argv[0], static_cast<int>(name.size()), name.data());
+            }
+            optopt = match->val;
+            return '?';
+        }
+        optarg = argv[optind++];
+    }
+
+    if (match->flag != nullptr) {
+        *match->flag = match->val;
+        return 0;
+    }
+    return match->val;
+}
+
 // Main getopt implementation
-int tawqa_getopt_internal(int argc, char* const* argv, const char* optstring) {
+int tawqa_getopt_internal(int argc, char* const* argv, const char* optstring,
+                          const tawqa::Option* longopts = nullptr,
+                          int* longindex = nullptr) {
     optarg = nullptr;
 
     if (optind == 0) {
@@ -148,6 +218,11 @@ int tawqa_getopt_internal(int argc, char* const* argv, const char* optstring) {
         }
 
         nextchar = argv[optind] + 1;
+
+        if (longopts != nullptr && *nextchar == '-') {
+            ++nextchar;
+            return tawqa_getopt_long_option(argc, argv, longopts, longindex);
+        }
     }
 
     // Process current option character
@@ -203,6 +278,11 @@ extern "C" int tawqa_getopt(int argc, char* const argv[], const char* optstring)
     return tawqa_getopt_internal(argc, argv, optstring);
 }
 
+extern "C" int tawqa_getopt_long(int argc, char* const argv[], const char* optstring,
+                                 const tawqa::Option* longopts, int* longindex) {
+    return tawqa_getopt_internal(argc, argv, optstring, longopts, longindex);
+}
+
 // Namespace implementation
 namespace tawqa {
 
@@ -212,6 +292,15 @@ int GetOpt::getopt(int argc, char* const argv[], std::string_view optstring) {
     return tawqa_getopt_internal(argc, argv, opt_str.c_str());
 }
 
+int GetOpt::getopt_long(int argc, char* const argv[], std::string_view optstring,
+                        std::span<const Option> longopts, int* longindex) {
+    // The internal parser walks a table terminated by an empty name
+    std::string opt_str{optstring};
+    std::vector<Option> table{longopts.begin(), longopts.end()};
+    table.push_back(Option{});
+    return tawqa_getopt_internal(argc, argv, opt_str.c_str(), table.data(), longindex);
+}
+
 std::string_view GetOpt::initialize_getopt(std::string_view optstring) {
     first_nonopt = last_nonopt = optind = 1;
     nextchar = {};
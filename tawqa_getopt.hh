@@ -72,6 +72,10 @@ extern "C" {
     extern int optopt;
     
     int tawqa_getopt(int argc, char* const argv[], const char* optstring);
+
+    // Long options: table is terminated by an entry with an empty name
+    int tawqa_getopt_long(int argc, char* const argv[], const char* optstring,
+                          const tawqa::Option* longopts, int* longindex);
 }
 
 #endif // TAWQA_GETOPT_HH_INCLUDED
\ No newline at end of file
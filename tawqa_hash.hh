@@ -0,0 +1,40 @@
+#pragma once
+
+#ifndef TAWQA_HASH_HH_INCLUDED
+#define TAWQA_HASH_HH_INCLUDED
+
+// TAWQA Streaming Hash Header
+// CRC32C (SSE4.2 when the CPU has it) and XXH64
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstdint>
+#include <cstddef>
+
+enum tawqa_hash_algo : std::uint8_t {
+    TAWQA_HASH_NONE = 0,
+    TAWQA_HASH_CRC32C = 1,
+    TAWQA_HASH_XXH64 = 2,
+};
+
+// Incremental hash state (C-style, no OOP)
+struct tawqa_hash_state {
+    tawqa_hash_algo algo;
+    std::uint32_t crc;
+    std::uint64_t acc[4];       // XXH64 lanes
+    std::uint64_t total;        // bytes hashed
+    unsigned char tail[32];     // XXH64 partial stripe
+    std::size_t tail_len;
+};
+
+// Parse "crc32c" or "xxh64"
+bool tawqa_hash_parse(const char* name, tawqa_hash_algo* algo);
+const char* tawqa_hash_name(tawqa_hash_algo algo);
+
+void tawqa_hash_init(tawqa_hash_state* st, tawqa_hash_algo algo);
+void tawqa_hash_update(tawqa_hash_state* st, const void* data, std::size_t len);
+std::uint64_t tawqa_hash_digest(const tawqa_hash_state* st);
+
+// One-shot CRC32C continuing from `crc` (pre/post inversion included)
+std::uint32_t tawqa_crc32c(std::uint32_t crc, const void* data, std::size_t len);
+
+#endif // TAWQA_HASH_HH_INCLUDED
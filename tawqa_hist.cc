@@ -0,0 +1,118 @@
+// TAWQA Latency Histogram Implementation
+// Bucket index from the leading bit, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_hist.hh"
+#include <cstdio>
+
+constexpr std::uint64_t TAWQA_HIST_SUB = 1ULL << TAWQA_HIST_SUB_BITS;
+
+// Values below 2*SUB map to themselves; above that, each power of two
+// gets SUB buckets of width 2^shift
+static std::size_t tawqa_hist_index(std::uint64_t value) {
+    if (value < 2 * TAWQA_HIST_SUB) {
+        return static_cast<std::size_t>(value);
+    }
+    int shift = 63 - __builtin_clzll(value) - TAWQA_HIST_SUB_BITS;
+    return static_cast<std::size_t>((static_cast<std::uint64_t>(shift) << TAWQA_HIST_SUB_BITS) + (value >> shift));
+}
+
+static std::uint64_t tawqa_hist_highest(std::size_t index) {
+    if (index < 2 * TAWQA_HIST_SUB) {
+        return index;
+    }
+    int shift = static_cast<int>(index >> TAWQA_HIST_SUB_BITS) - 1;
+    std::uint64_t sub = index - (static_cast<std::uint64_t>(shift) << TAWQA_HIST_SUB_BITS);
+    return ((sub + 1) << shift) - 1;
+}
+
+void tawqa_hist_record(tawqa_hist* hist, std::uint64_t value) {
+    std::atomic<std::uint64_t>& slot = hist->counts[tawqa_hist_index(value)];
+    slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void tawqa_hist_add(tawqa_hist_sum* sum, const tawqa_hist* hist) {
+    for (std::size_t i = 0; i < TAWQA_HIST_BUCKETS; ++i) {
+        std::uint64_t n = hist->counts[i].load(std::memory_order_relaxed);
+        sum->counts[i] += n;
+        sum->total += n;
+    }
+}
+
+std::uint64_t tawqa_hist_value_at(const tawqa_hist_sum* sum, double pct) {
+    if (!sum->total) {
+        return 0;
+    }
+    auto rank = static_cast<std::uint64_t>(static_cast<double>(sum->total) * pct / 100.0 + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    std::uint64_t seen = 0;
+    std::size_t last = 0;
+    for (std::size_t i = 0; i < TAWQA_HIST_BUCKETS; ++i) {
+        if (!sum->counts[i]) {
+            continue;
+        }
+        seen += sum->counts[i];
+        last = i;
+        if (seen >= rank) {
+            break;
+        }
+    }
+    return tawqa_hist_highest(last);
+}
+
+std::uint64_t tawqa_hist_count_upto(const tawqa_hist_sum* sum, std::uint64_t value) {
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < TAWQA_HIST_BUCKETS && tawqa_hist_highest(i) <= value; ++i) {
+        seen += sum->counts[i];
+    }
+    return seen;
+}
+
+static int tawqa_hist_ns(char* out, std::size_t size, std::uint64_t ns) {
+    if (ns < 1000) {
+        return std::snprintf(out, size, "%lluns", static_cast<unsigned long long>(ns));
+    }
+    if (ns < 1000000) {
+        return std::snprintf(out, size, "%.1fus", static_cast<double>(ns) / 1e3);
+    }
+    if (ns < 1000000000) {
+        return std::snprintf(out, size, "%.2fms", static_cast<double>(ns) / 1e6);
+    }
+    return std::snprintf(out, size, "%.2fs", static_cast<double>(ns) / 1e9);
+}
+
+static int tawqa_hist_bytes(char* out, std::size_t size, std::uint64_t bytes) {
+    if (bytes < 1024) {
+        return std::snprintf(out, size, "%lluB", static_cast<unsigned long long>(bytes));
+    }
+    if (bytes < 1024 * 1024) {
+        return std::snprintf(out, size, "%.1fK", static_cast<double>(bytes) / 1024);
+    }
+    return std::snprintf(out, size, "%.1fM", static_cast<double>(bytes) / (1024 * 1024));
+}
+
+void tawqa_hist_format(const tawqa_hist_sum* sum, char* out, std::size_t size, tawqa_hist_unit unit) {
+    static const double pcts[] = {50, 90, 99, 99.9, 100};
+    static const char* names[] = {"p50", "p90", "p99", "p99.9", "max"};
+    if (!sum->total) {
+        std::snprintf(out, size, "no samples");
+        return;
+    }
+    std::size_t len = 0;
+    for (std::size_t i = 0; i < sizeof(pcts) / sizeof(pcts[0]) && len < size; ++i) {
+        int n = std::snprintf(out + len, size - len, "%s%s ", i ? " " : "", names[i]);
+        if (n < 0 || static_cast<std::size_t>(n) >= size - len) {
+            break;
+        }
+        len += static_cast<std::size_t>(n);
+        std::uint64_t value = tawqa_hist_value_at(sum, pcts[i]);
+        n = unit == TAWQA_HIST_BYTES ? tawqa_hist_bytes(out + len, size - len, value)
+                                     : tawqa_hist_ns(out + len, size - len, value);
+        if (n < 0) {
+            break;
+        }
+        len += static_cast<std::size_t>(n);
+    }
+}
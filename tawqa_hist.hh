@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef TAWQA_HIST_HH_INCLUDED
+#define TAWQA_HIST_HH_INCLUDED
+
+// TAWQA Latency Histogram Header
+// HDR-style log-linear buckets, one writer thread, readers merge
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 64 linear sub-buckets per power of two: under 1.6% error anywhere
+// from 1 ns up to the full 64-bit range
+constexpr int TAWQA_HIST_SUB_BITS = 6;
+constexpr std::size_t TAWQA_HIST_BUCKETS = (64 - TAWQA_HIST_SUB_BITS + 1) << TAWQA_HIST_SUB_BITS;
+
+// Live histogram; only its owner thread records, anyone may read
+struct tawqa_hist {
+    std::array<std::atomic<std::uint64_t>, TAWQA_HIST_BUCKETS> counts;
+};
+
+// Plain totals merged from one or more live histograms
+struct tawqa_hist_sum {
+    std::array<std::uint64_t, TAWQA_HIST_BUCKETS> counts;
+    std::uint64_t total;
+};
+
+// Single-writer record, no locked instructions on the hot path
+void tawqa_hist_record(tawqa_hist* hist, std::uint64_t value);
+
+// sum += hist
+void tawqa_hist_add(tawqa_hist_sum* sum, const tawqa_hist* hist);
+
+// Samples in buckets lying wholly at or below value, for cumulative
+// (Prometheus "le") buckets
+std::uint64_t tawqa_hist_count_upto(const tawqa_hist_sum* sum, std::uint64_t value);
+
+// Highest value within the bucket holding the pct-th percentile (0-100)
+std::uint64_t tawqa_hist_value_at(const tawqa_hist_sum* sum, double pct);
+
+// What recorded values measure, for formatting
+enum tawqa_hist_unit {
+    TAWQA_HIST_NS,
+    TAWQA_HIST_BYTES,
+};
+
+// "p50 12.1us p90 ... p99.9 ... max ..." with the values read as ns,
+// or "p50 64.0K ..." for byte counts
+void tawqa_hist_format(const tawqa_hist_sum* sum, char* out, std::size_t size,
+                       tawqa_hist_unit unit = TAWQA_HIST_NS);
+
+#endif // TAWQA_HIST_HH_INCLUDED
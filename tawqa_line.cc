@@ -0,0 +1,334 @@
+// TAWQA Line Scanning Implementation
+// memchr/memrchr plus scalar, SSE2 and AVX2 kernels picked at startup, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_line.hh"
+#include <cstdint>
+#include <cstring>
+#include <string.h>
+#include <strings.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TAWQA_LINE_X86 1
+#define TAWQA_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+std::size_t tawqa_findline(const char* buf, std::size_t size) {
+    if (!buf) {
+        return 0;
+    }
+
+    // glibc's memchr already picks the widest vector unit the CPU has
+    const void* nl = std::memchr(buf, '\n', size);
+    if (!nl) {
+        return size;
+    }
+    return static_cast<std::size_t>(static_cast<const char*>(nl) - buf) + 1;
+}
+
+std::size_t tawqa_findlast(const char* buf, std::size_t size) {
+    if (!buf || !size) {
+        return 0;
+    }
+
+#ifdef __GLIBC__
+    const void* nl = memrchr(buf, '\n', size);
+    if (!nl) {
+        return 0;
+    }
+    return static_cast<std::size_t>(static_cast<const char*>(nl) - buf) + 1;
+#else
+    for (std::size_t i = size; i > 0; --i) {
+        if (buf[i - 1] == '\n') {
+            return i;
+        }
+    }
+    return 0;
+#endif
+}
+
+// Scalar kernels, the reference the vector ones are checked against
+
+std::size_t tawqa_findline_scalar(const char* buf, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        if (buf[i] == '\n') {
+            return i + 1;
+        }
+    }
+    return size;
+}
+
+std::size_t tawqa_findeol_scalar(const char* buf, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        if (buf[i] == '\n' || buf[i] == '\r') {
+            return i + 1;
+        }
+    }
+    return size;
+}
+
+std::size_t tawqa_crlf_expand_scalar(const char* in, std::size_t size, char* out, char* prev) {
+    std::size_t o = 0;
+    char last = *prev;
+    for (std::size_t i = 0; i < size; ++i) {
+        if (in[i] == '\n' && last != '\r') {
+            out[o++] = '\r';
+        }
+        out[o++] = last = in[i];
+    }
+    *prev = last;
+    return o;
+}
+
+#ifdef TAWQA_LINE_X86
+
+// Copy one block of width bytes, a '\r' going in before each bit of lone
+static inline std::size_t tawqa_crlf_block(const char* in, std::size_t width, std::uint32_t lone, char* out) {
+    std::size_t o = 0, from = 0;
+    while (lone) {
+        std::size_t at = static_cast<std::size_t>(__builtin_ctz(lone));
+        std::memcpy(out + o, in + from, at - from);
+        o += at - from;
+        out[o++] = '\r';
+        from = at;
+        lone &= lone - 1;
+    }
+    std::memcpy(out + o, in + from, width - from);
+    return o + width - from;
+}
+
+TAWQA_TARGET("sse2")
+std::size_t tawqa_findline_sse2(const char* buf, std::size_t size) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+        if (mask) {
+            return i + static_cast<std::size_t>(__builtin_ctz(mask)) + 1;
+        }
+    }
+    return i + tawqa_findline_scalar(buf + i, size - i);
+}
+
+TAWQA_TARGET("sse2")
+std::size_t tawqa_findeol_sse2(const char* buf, std::size_t size) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, cr));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) {
+            return i + static_cast<std::size_t>(__builtin_ctz(mask)) + 1;
+        }
+    }
+    return i + tawqa_findeol_scalar(buf + i, size - i);
+}
+
+TAWQA_TARGET("sse2")
+std::size_t tawqa_crlf_expand_sse2(const char* in, std::size_t size, char* out, char* prev) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    std::size_t i = 0, o = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        std::uint32_t nls = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+        if (nls) {
+            // A '\n' is lone unless the byte before it, maybe in the last block, is '\r'
+            std::uint32_t crs = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, cr)));
+            char before = i ? in[i - 1] : *prev;
+            std::uint32_t lone = nls & ~((crs << 1) | (before == '\r'));
+            if (lone) {
+                o += tawqa_crlf_block(in + i, 16, lone, out + o);
+                continue;
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o), v);
+        o += 16;
+    }
+    if (i) {
+        *prev = in[i - 1];
+    }
+    return o + tawqa_crlf_expand_scalar(in + i, size - i, out + o, prev);
+}
+
+TAWQA_TARGET("avx2")
+std::size_t tawqa_findline_avx2(const char* buf, std::size_t size) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i));
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+        if (mask) {
+            return i + static_cast<std::size_t>(__builtin_ctz(mask)) + 1;
+        }
+    }
+    return i + tawqa_findline_sse2(buf + i, size - i);
+}
+
+TAWQA_TARGET("avx2")
+std::size_t tawqa_findeol_avx2(const char* buf, std::size_t size) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, cr));
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask) {
+            return i + static_cast<std::size_t>(__builtin_ctz(mask)) + 1;
+        }
+    }
+    return i + tawqa_findeol_sse2(buf + i, size - i);
+}
+
+TAWQA_TARGET("avx2")
+std::size_t tawqa_crlf_expand_avx2(const char* in, std::size_t size, char* out, char* prev) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    std::size_t i = 0, o = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        std::uint32_t nls = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+        if (nls) {
+            std::uint32_t crs = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, cr)));
+            char before = i ? in[i - 1] : *prev;
+            std::uint32_t lone = nls & ~((crs << 1) | (before == '\r'));
+            if (lone) {
+                o += tawqa_crlf_block(in + i, 32, lone, out + o);
+                continue;
+            }
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + o), v);
+        o += 32;
+    }
+    if (i) {
+        *prev = in[i - 1];
+    }
+    return o + tawqa_crlf_expand_sse2(in + i, size - i, out + o, prev);
+}
+
+bool tawqa_line_have_sse2() {
+    return __builtin_cpu_supports("sse2");
+}
+
+bool tawqa_line_have_avx2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+std::size_t tawqa_findline_sse2(const char* buf, std::size_t size) {
+    return tawqa_findline_scalar(buf, size);
+}
+
+std::size_t tawqa_findline_avx2(const char* buf, std::size_t size) {
+    return tawqa_findline_scalar(buf, size);
+}
+
+std::size_t tawqa_findeol_sse2(const char* buf, std::size_t size) {
+    return tawqa_findeol_scalar(buf, size);
+}
+
+std::size_t tawqa_findeol_avx2(const char* buf, std::size_t size) {
+    return tawqa_findeol_scalar(buf, size);
+}
+
+std::size_t tawqa_crlf_expand_sse2(const char* in, std::size_t size, char* out, char* prev) {
+    return tawqa_crlf_expand_scalar(in, size, out, prev);
+}
+
+std::size_t tawqa_crlf_expand_avx2(const char* in, std::size_t size, char* out, char* prev) {
+    return tawqa_crlf_expand_scalar(in, size, out, prev);
+}
+
+bool tawqa_line_have_sse2() {
+    return false;
+}
+
+bool tawqa_line_have_avx2() {
+    return false;
+}
+
+#endif // TAWQA_LINE_X86
+
+// Widest kernel this CPU runs, resolved on first use
+
+using tawqa_find_fn = std::size_t (*)(const char*, std::size_t);
+using tawqa_expand_fn = std::size_t (*)(const char*, std::size_t, char*, char*);
+
+static tawqa_find_fn tawqa_pick_findeol() {
+    if (tawqa_line_have_avx2()) {
+        return tawqa_findeol_avx2;
+    }
+    if (tawqa_line_have_sse2()) {
+        return tawqa_findeol_sse2;
+    }
+    return tawqa_findeol_scalar;
+}
+
+static tawqa_expand_fn tawqa_pick_crlf_expand() {
+    if (tawqa_line_have_avx2()) {
+        return tawqa_crlf_expand_avx2;
+    }
+    if (tawqa_line_have_sse2()) {
+        return tawqa_crlf_expand_sse2;
+    }
+    return tawqa_crlf_expand_scalar;
+}
+
+std::size_t tawqa_findeol(const char* buf, std::size_t size) {
+    static const tawqa_find_fn fn = tawqa_pick_findeol();
+    if (!buf) {
+        return 0;
+    }
+    return fn(buf, size);
+}
+
+std::size_t tawqa_crlf_expand(const char* in, std::size_t size, char* out, char* prev) {
+    static const tawqa_expand_fn fn = tawqa_pick_crlf_expand();
+    return fn(in, size, out, prev);
+}
+
+bool tawqa_shell_feed(tawqa_shell_lines* lines, const char* in, std::size_t size, std::size_t* ready) {
+    std::size_t in_pos = 0;
+    std::size_t out_pos = lines->pending;
+    std::size_t line_start = 0;
+    while (in_pos < size) {
+        std::size_t len = tawqa_findeol(in + in_pos, size - in_pos);
+        std::memcpy(lines->buf + out_pos, in + in_pos, len);
+        in_pos += len;
+        out_pos += len;
+
+        char last = lines->buf[out_pos - 1];
+        if (last != '\r' && last != '\n') {
+            break;
+        }
+        if (last == '\r') {
+            lines->buf[out_pos++] = '\n';
+        }
+
+        if (out_pos - line_start == 6 && strncasecmp(lines->buf + line_start, "exit\r\n", 6) == 0) {
+            *ready = line_start;
+            lines->end = out_pos;
+            return true;
+        }
+        line_start = out_pos;
+    }
+
+    // A partial line goes out as it is once it fills the buffer
+    if (out_pos - line_start >= TAWQA_SHELL_LINE - 1) {
+        line_start = out_pos;
+    }
+    *ready = line_start;
+    lines->end = out_pos;
+    return false;
+}
+
+void tawqa_shell_consume(tawqa_shell_lines* lines, std::size_t ready) {
+    lines->pending = lines->end - ready;
+    std::memmove(lines->buf, lines->buf + ready, lines->pending);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef TAWQA_LINE_HH_INCLUDED
+#define TAWQA_LINE_HH_INCLUDED
+
+// TAWQA Line Scanning Header
+// Newline search shared by line pacing, the fan-in merger and doexec
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstddef>
+
+// Length of the first line in buffer, newline included, or the whole
+// buffer if it holds no newline
+std::size_t tawqa_findline(const char* buf, std::size_t size);
+
+// Length of the buffer up to and including its last newline, 0 if none.
+// Everything before it is whole lines.
+std::size_t tawqa_findlast(const char* buf, std::size_t size);
+
+// Length of the first line in buffer ending at '\r' or '\n', delimiter
+// included, or the whole buffer if it holds neither
+std::size_t tawqa_findeol(const char* buf, std::size_t size);
+
+// Copy size bytes to out putting a '\r' before every '\n' that does not
+// already follow one. *prev is the last byte already sent, updated on
+// return. out needs room for 2 * size bytes; returns the bytes stored.
+std::size_t tawqa_crlf_expand(const char* in, std::size_t size, char* out, char* prev);
+
+// Client -> shell line filter for -e. Each '\r' gains a '\n' and a line
+// reading "exit\r\n" in any case ends the session; an unfinished line is
+// held until the rest arrives, or passed on once it fills TAWQA_SHELL_LINE.
+constexpr std::size_t TAWQA_SHELL_LINE = 8192;
+
+struct tawqa_shell_lines {
+    char buf[TAWQA_SHELL_LINE * 3]; // held line, then one read with CRs expanded
+    std::size_t pending;            // bytes of the held line
+    std::size_t end;                // bytes in buf after the last feed
+};
+
+// Add one read of at most TAWQA_SHELL_LINE bytes. *ready is set to the
+// length of the whole lines at the start of buf that can go to the shell,
+// and true is returned when exit was seen (the lines before it are ready).
+// Call tawqa_shell_consume once they are written.
+bool tawqa_shell_feed(tawqa_shell_lines* lines, const char* in, std::size_t size, std::size_t* ready);
+void tawqa_shell_consume(tawqa_shell_lines* lines, std::size_t ready);
+
+// Per-ISA kernels behind the calls above, exported for tawqa_bench.
+// Only call the SSE2/AVX2 ones when tawqa_line_have_sse2/avx2() say so;
+// on non-x86 builds they are the scalar kernels.
+std::size_t tawqa_findline_scalar(const char* buf, std::size_t size);
+std::size_t tawqa_findline_sse2(const char* buf, std::size_t size);
+std::size_t tawqa_findline_avx2(const char* buf, std::size_t size);
+std::size_t tawqa_findeol_scalar(const char* buf, std::size_t size);
+std::size_t tawqa_findeol_sse2(const char* buf, std::size_t size);
+std::size_t tawqa_findeol_avx2(const char* buf, std::size_t size);
+std::size_t tawqa_crlf_expand_scalar(const char* in, std::size_t size, char* out, char* prev);
+std::size_t tawqa_crlf_expand_sse2(const char* in, std::size_t size, char* out, char* prev);
+std::size_t tawqa_crlf_expand_avx2(const char* in, std::size_t size, char* out, char* prev);
+
+bool tawqa_line_have_sse2();
+bool tawqa_line_have_avx2();
+
+#endif // TAWQA_LINE_HH_INCLUDED
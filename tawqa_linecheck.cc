@@ -0,0 +1,243 @@
+// TAWQA Line Kernel Checks
+// Line kernels and the -e shell filter against byte-loop oracles, run by
+// ctest and make check
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_bench.hh"
+#include "tawqa_line.hh"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// Oracles written as the plainest byte loops, sharing no code with the
+// kernels, so a bug in the scalar reference can't hide behind agreement
+
+static std::size_t tawqa_oracle_findline(const char* buf, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        if (buf[i] == '\n') {
+            return i + 1;
+        }
+    }
+    return size;
+}
+
+static std::size_t tawqa_oracle_findeol(const char* buf, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        if (buf[i] == '\r' || buf[i] == '\n') {
+            return i + 1;
+        }
+    }
+    return size;
+}
+
+static std::string tawqa_oracle_crlf(const std::string& in, char* prev) {
+    std::string out;
+    for (char c : in) {
+        if (c == '\n' && *prev != '\r') {
+            out += '\r';
+        }
+        out += c;
+        *prev = c;
+    }
+    return out;
+}
+
+static bool tawqa_linecheck_fail(const char* kernel, int isa, std::size_t size, std::size_t offset) {
+    std::fprintf(stderr, "tawqa_linecheck: %s/%s disagrees with the oracle (size %zu, offset %zu)\n", kernel,
+                 g_isa_names[isa], size, offset);
+    return false;
+}
+
+static bool tawqa_linecheck_vector(const char* what, const std::string& input) {
+    std::string shown;
+    for (char c : input) {
+        shown += c == '\r' ? "\\r" : c == '\n' ? "\\n" : std::string(1, c);
+    }
+    std::fprintf(stderr, "tawqa_linecheck: %s wrong for \"%s\"\n", what, shown.c_str());
+    return false;
+}
+
+// Fixed vectors with hand-written answers, through the dispatching calls
+struct tawqa_linecheck_case {
+    const char* in;
+    std::size_t line;
+    std::size_t eol;
+    const char* crlf; // expanded with 'x' as the byte before
+};
+
+static const tawqa_linecheck_case g_cases[] = {
+    {"", 0, 0, ""},
+    {"\n", 1, 1, "\r\n"},
+    {"\r", 1, 1, "\r"},
+    {"abc", 3, 3, "abc"},
+    {"ab\r\ncd", 4, 3, "ab\r\ncd"},
+    {"\r\n\n", 2, 1, "\r\n\r\n"},
+    {"a\rb\nc", 4, 2, "a\rb\r\nc"},
+    {"\n\r\n", 1, 1, "\r\n\r\n"},
+};
+
+static bool tawqa_linecheck_fixed() {
+    for (const auto& c : g_cases) {
+        std::size_t size = std::strlen(c.in);
+        if (tawqa_findline(c.in, size) != c.line) {
+            return tawqa_linecheck_vector("findline", c.in);
+        }
+        if (tawqa_findeol(c.in, size) != c.eol) {
+            return tawqa_linecheck_vector("findeol", c.in);
+        }
+        char out[32];
+        char prev = 'x';
+        std::size_t len = tawqa_crlf_expand(c.in, size, out, &prev);
+        if (std::string(out, len) != c.crlf) {
+            return tawqa_linecheck_vector("crlf_expand", c.in);
+        }
+    }
+
+    // A CR sent at the end of the previous chunk pairs with this LF
+    char out[4];
+    char prev = '\r';
+    if (tawqa_crlf_expand("\n", 1, out, &prev) != 1 || out[0] != '\n') {
+        return tawqa_linecheck_vector("crlf_expand after CR", "\n");
+    }
+
+    // A lone newline at every position across the 16/32-byte vector widths
+    for (std::size_t size = 1; size <= 130; ++size) {
+        for (std::size_t at = 0; at < size; ++at) {
+            std::string text(size, 'a');
+            text[at] = '\n';
+            if (tawqa_findline(text.data(), size) != at + 1 || tawqa_findeol(text.data(), size) != at + 1) {
+                return tawqa_linecheck_vector("newline position", text);
+            }
+            text[at] = '\r';
+            if (tawqa_findline(text.data(), size) != size || tawqa_findeol(text.data(), size) != at + 1) {
+                return tawqa_linecheck_vector("CR position", text);
+            }
+        }
+    }
+    return true;
+}
+
+// Property checks: every variant, scalar included, must agree with the
+// oracles on random text at random alignments, and CRLF expansion must
+// not depend on where the input is split. Variants the CPU lacks are
+// skipped.
+static bool tawqa_linecheck_kernels() {
+    std::mt19937 rng(42);
+    for (int trial = 0; trial < 20000; ++trial) {
+        std::size_t size = rng() % 700;
+        std::size_t offset = rng() % 64;
+        std::size_t spacing = std::vector<std::size_t>{0, 2, 3, 16, 80}[rng() % 5];
+        std::vector<char> text = tawqa_bench_text(size + offset, spacing, rng());
+        const char* buf = text.data() + offset;
+        std::size_t start = size ? rng() % size : 0;
+
+        std::size_t line = tawqa_oracle_findline(buf + start, size - start);
+        std::size_t eol = tawqa_oracle_findeol(buf + start, size - start);
+        std::vector<char> got(2 * size + 1);
+        char seed_prev = (rng() & 1) ? '\r' : 'x';
+        char want_prev = seed_prev;
+        std::string want = tawqa_oracle_crlf(std::string(buf, size), &want_prev);
+
+        for (int isa = TAWQA_BENCH_SCALAR; isa <= TAWQA_BENCH_LIBC; ++isa) {
+            if (!tawqa_bench_have(isa)) {
+                continue;
+            }
+            if (g_findline[isa](buf + start, size - start) != line) {
+                return tawqa_linecheck_fail("findline", isa, size, offset);
+            }
+            if (isa == TAWQA_BENCH_LIBC) {
+                continue;
+            }
+            if (g_findeol[isa](buf + start, size - start) != eol) {
+                return tawqa_linecheck_fail("findeol", isa, size, offset);
+            }
+
+            // Expand in two pieces, carrying the last byte over
+            char prev = seed_prev;
+            std::size_t len = g_crlf_expand[isa](buf, start, got.data(), &prev);
+            len += g_crlf_expand[isa](buf + start, size - start, got.data() + len, &prev);
+            if (std::string(got.data(), len) != want || prev != want_prev) {
+                return tawqa_linecheck_fail("crlf_expand", isa, size, offset);
+            }
+        }
+    }
+    return true;
+}
+
+// Run the -e filter over reads split at the given points; returns what
+// reaches the shell and whether the session ended
+static std::string tawqa_shell_run(const std::string& text, const std::vector<std::size_t>& cuts, bool* done) {
+    static tawqa_shell_lines lines;
+    lines.pending = 0;
+    std::string shell;
+    std::size_t from = 0;
+    *done = false;
+    for (std::size_t i = 0; i <= cuts.size() && !*done; ++i) {
+        std::size_t to = i < cuts.size() ? cuts[i] : text.size();
+        std::size_t ready = 0;
+        *done = tawqa_shell_feed(&lines, text.data() + from, to - from, &ready);
+        shell.append(lines.buf, ready);
+        tawqa_shell_consume(&lines, ready);
+        from = to;
+    }
+    return shell;
+}
+
+struct tawqa_shell_case {
+    const char* in;
+    const char* shell; // what the shell receives
+    bool done;
+};
+
+static const tawqa_shell_case g_shell_cases[] = {
+    {"ls\n", "ls\n", false},
+    {"ls\r", "ls\r\n", false},
+    {"ls\r\n", "ls\r\n\n", false},
+    {"pwd\nexit\r\nrm x\n", "pwd\n", true},
+    {"EXIT\r\n", "", true},
+    {"exit\r", "", true},
+    {"exit\n", "exit\n", false},
+    {" exit\r\n", " exit\r\n\n", false},
+    {"exitx\r\n", "exitx\r\n\n", false},
+    {"partial", "", false},
+};
+
+static bool tawqa_linecheck_shell() {
+    for (const auto& c : g_shell_cases) {
+        bool done;
+        if (tawqa_shell_run(c.in, {}, &done) != c.shell || done != c.done) {
+            return tawqa_linecheck_vector("shell filter", c.in);
+        }
+    }
+
+    // However the reads split "exit\r\n", the session ends right after
+    // the line before it, and a lone CR split from its LF still counts
+    const std::string text = "pwd\nexit\r\nrm x\n";
+    for (std::size_t a = 0; a <= text.size(); ++a) {
+        for (std::size_t b = a; b <= text.size(); ++b) {
+            bool done;
+            if (tawqa_shell_run(text, {a, b}, &done) != "pwd\n" || !done) {
+                return tawqa_linecheck_vector("shell filter split", text);
+            }
+        }
+    }
+
+    // An overlong line is passed on once it fills the buffer
+    std::string line(TAWQA_SHELL_LINE, 'a');
+    bool done;
+    std::string shell = tawqa_shell_run(line, {TAWQA_SHELL_LINE / 2}, &done);
+    if (shell.size() != TAWQA_SHELL_LINE || done) {
+        return tawqa_linecheck_vector("shell filter long line", "a...");
+    }
+    return true;
+}
+
+int main() {
+    if (!tawqa_linecheck_fixed() || !tawqa_linecheck_kernels() || !tawqa_linecheck_shell()) {
+        return 1;
+    }
+    std::printf("tawqa_linecheck: line kernels and shell filter agree with the oracles\n");
+    return 0;
+}
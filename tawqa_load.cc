@@ -0,0 +1,367 @@
+// TAWQA Load Generator Implementation
+// Edge-triggered epoll per thread, single-writer counters, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_load.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_hist.hh"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+constexpr int TAWQA_LOAD_EVENTS = 256;
+constexpr std::size_t TAWQA_LOAD_RECV = 64 * 1024;
+constexpr std::uint64_t TAWQA_LOAD_RETRY_NS = 100000000ULL;   // refused connects back off
+
+// Counters are written by one loop thread and read by the reporter
+struct alignas(64) tawqa_load_stats {
+    std::atomic<std::uint64_t> bytes_out;
+    std::atomic<std::uint64_t> bytes_in;
+    std::atomic<std::uint64_t> connects;
+    std::atomic<std::uint64_t> errors;
+    std::atomic<std::uint64_t> requests;
+    tawqa_hist connect_ns;
+    tawqa_hist latency_ns;
+};
+
+struct tawqa_load_conn {
+    int fd;
+    bool connected;
+    std::uint64_t start_ns;    // connect start, then request send time
+    std::uint64_t retry_ns;    // when a failed connect may be retried
+    std::size_t pos;           // next payload byte to send
+    std::size_t req;           // current request index
+    bool awaiting;             // request sent, response not yet complete
+};
+
+// Shared, read-only payload and request boundaries
+static const char* g_payload = nullptr;
+static std::size_t g_payload_len = 0;
+static std::vector<std::size_t> g_req_ends;
+static tawqa_load_connect_fn g_connect_fn = nullptr;
+static int g_delim = -1;
+static std::atomic<bool> g_stop{false};
+
+static void tawqa_load_bump(std::atomic<std::uint64_t>& counter, std::uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static void tawqa_load_catch(int) {
+    g_stop = true;
+}
+
+static bool tawqa_load_open(int ep, tawqa_load_conn* c, std::uint64_t now) {
+    *c = {};
+    c->fd = g_connect_fn();
+    c->start_ns = now;
+    if (c->fd < 0) {
+        c->retry_ns = now + TAWQA_LOAD_RETRY_NS;
+        return false;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = c;
+    epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev);
+    return true;
+}
+
+static void tawqa_load_drop(tawqa_load_conn* c, tawqa_load_stats* st, std::uint64_t now) {
+    if (!g_stop) {
+        tawqa_load_bump(st->errors, 1);
+    }
+    close(c->fd);
+    c->fd = -1;
+    c->retry_ns = c->connected ? now : now + TAWQA_LOAD_RETRY_NS;
+}
+
+// Send until the socket is full; stream mode cycles the payload forever,
+// request mode stops at the end of the current request
+static bool tawqa_load_send(tawqa_load_conn* c, tawqa_load_stats* st) {
+    while (true) {
+        std::size_t end = g_delim < 0 ? g_payload_len : g_req_ends[c->req];
+        if (c->pos >= end) {
+            if (g_delim >= 0) {
+                c->awaiting = true;
+                return true;
+            }
+            c->pos = 0;
+        }
+        ssize_t n = send(c->fd, g_payload + c->pos, end - c->pos, MSG_NOSIGNAL);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        c->pos += static_cast<std::size_t>(n);
+        tawqa_load_bump(st->bytes_out, static_cast<std::uint64_t>(n));
+    }
+}
+
+static void tawqa_load_next_request(tawqa_load_conn* c, std::uint64_t now) {
+    c->req = (c->req + 1) % g_req_ends.size();
+    c->pos = c->req ? g_req_ends[c->req - 1] : 0;
+    c->awaiting = false;
+    c->start_ns = now;
+}
+
+static bool tawqa_load_recv(tawqa_load_conn* c, tawqa_load_stats* st, char* buf) {
+    while (true) {
+        ssize_t n = recv(c->fd, buf, TAWQA_LOAD_RECV, 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        tawqa_load_bump(st->bytes_in, static_cast<std::uint64_t>(n));
+        if (g_delim < 0) {
+            continue;
+        }
+
+        // Each delimiter completes the outstanding request
+        const char* p = buf;
+        const char* end = buf + n;
+        while (c->awaiting && (p = static_cast<const char*>(std::memchr(p, g_delim, end - p)))) {
+            std::uint64_t now = tawqa_now_ns();
+            tawqa_hist_record(&st->latency_ns, now - c->start_ns);
+            tawqa_load_bump(st->requests, 1);
+            tawqa_load_next_request(c, now);
+            if (!tawqa_load_send(c, st)) {
+                return false;
+            }
+            ++p;
+        }
+    }
+}
+
+static void tawqa_load_loop(std::size_t conns, tawqa_load_stats* st) {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        tawqa_bail("Can't create epoll instance");
+    }
+    std::vector<tawqa_load_conn> pool(conns);
+    std::unique_ptr<char[]> buf(new char[TAWQA_LOAD_RECV]);
+
+    std::uint64_t now = tawqa_now_ns();
+    for (tawqa_load_conn& c : pool) {
+        if (!tawqa_load_open(ep, &c, now)) {
+            tawqa_load_bump(st->errors, 1);
+        }
+    }
+
+    struct epoll_event events[TAWQA_LOAD_EVENTS];
+    while (!g_stop) {
+        int n = epoll_wait(ep, events, TAWQA_LOAD_EVENTS, 10);
+        now = tawqa_now_ns();
+        for (int i = 0; i < n; ++i) {
+            auto* c = static_cast<tawqa_load_conn*>(events[i].data.ptr);
+            if (c->fd < 0) {
+                continue;
+            }
+            if (!c->connected) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err || (events[i].events & (EPOLLERR | EPOLLHUP))) {
+                    tawqa_load_drop(c, st, now);
+                    continue;
+                }
+                if (!(events[i].events & EPOLLOUT)) {
+                    continue;
+                }
+                c->connected = true;
+                tawqa_hist_record(&st->connect_ns, now - c->start_ns);
+                tawqa_load_bump(st->connects, 1);
+                c->start_ns = now;
+            }
+            bool alive = !(events[i].events & EPOLLERR);
+            if (alive && (events[i].events & EPOLLOUT) && !c->awaiting) {
+                alive = tawqa_load_send(c, st);
+            }
+            if (alive && (events[i].events & (EPOLLIN | EPOLLRDHUP))) {
+                alive = tawqa_load_recv(c, st, buf.get());
+            }
+            if (!alive) {
+                tawqa_load_drop(c, st, now);
+            }
+        }
+
+        // Closed connections are replaced, refused ones after a pause
+        for (tawqa_load_conn& c : pool) {
+            if (c.fd < 0 && now >= c.retry_ns && !g_stop) {
+                if (!tawqa_load_open(ep, &c, now)) {
+                    tawqa_load_bump(st->errors, 1);
+                }
+            }
+        }
+    }
+
+    for (tawqa_load_conn& c : pool) {
+        if (c.fd >= 0) {
+            close(c.fd);
+        }
+    }
+    close(ep);
+}
+
+// Payload: the file mapped as is, or `size` generated printable bytes.
+// In request mode each delimiter ends a request; a payload without one
+// is a single request with the delimiter appended.
+static void tawqa_load_payload(const tawqa_load_opts* opts) {
+    static std::vector<char> generated;
+    if (opts->file) {
+        int fd = open(opts->file, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+            tawqa_bail("Can't use %s as load payload", opts->file);
+        }
+        void* map = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            tawqa_bail("Can't map %s", opts->file);
+        }
+        g_payload = static_cast<const char*>(map);
+        g_payload_len = static_cast<std::size_t>(st.st_size);
+    } else {
+        generated.resize(opts->size);
+        for (std::size_t i = 0; i < generated.size(); ++i) {
+            generated[i] = static_cast<char>('a' + i % 26);
+        }
+        g_payload = generated.data();
+        g_payload_len = generated.size();
+    }
+
+    if (opts->delim < 0) {
+        return;
+    }
+    for (std::size_t i = 0; i < g_payload_len; ++i) {
+        if (static_cast<unsigned char>(g_payload[i]) == opts->delim) {
+            g_req_ends.push_back(i + 1);
+        }
+    }
+    if (g_req_ends.empty()) {
+        if (g_payload != generated.data()) {
+            generated.assign(g_payload, g_payload + g_payload_len);
+        }
+        generated.push_back(static_cast<char>(opts->delim));
+        g_payload = generated.data();
+        g_payload_len = generated.size();
+        g_req_ends.push_back(g_payload_len);
+    }
+    // Bytes after the last delimiter never form a request
+    g_payload_len = g_req_ends.back();
+}
+
+struct tawqa_load_totals {
+    std::uint64_t bytes_out, bytes_in, connects, errors, requests;
+    tawqa_hist_sum connect_ns;
+    tawqa_hist_sum latency_ns;
+};
+
+static void tawqa_load_collect(const tawqa_load_stats* stats, std::size_t threads, tawqa_load_totals* t) {
+    std::memset(t, 0, sizeof(*t));
+    for (std::size_t i = 0; i < threads; ++i) {
+        t->bytes_out += stats[i].bytes_out.load(std::memory_order_relaxed);
+        t->bytes_in += stats[i].bytes_in.load(std::memory_order_relaxed);
+        t->connects += stats[i].connects.load(std::memory_order_relaxed);
+        t->errors += stats[i].errors.load(std::memory_order_relaxed);
+        t->requests += stats[i].requests.load(std::memory_order_relaxed);
+        tawqa_hist_add(&t->connect_ns, &stats[i].connect_ns);
+        tawqa_hist_add(&t->latency_ns, &stats[i].latency_ns);
+    }
+}
+
+// One line covering [prev, cur) over `secs`
+static void tawqa_load_print(const char* label, const tawqa_load_totals* cur, const tawqa_load_totals* prev,
+                             double secs, bool requests) {
+    static tawqa_hist_sum span;
+    const tawqa_hist_sum* cur_h = requests ? &cur->latency_ns : &cur->connect_ns;
+    const tawqa_hist_sum* prev_h = requests ? &prev->latency_ns : &prev->connect_ns;
+    for (std::size_t i = 0; i < TAWQA_HIST_BUCKETS; ++i) {
+        span.counts[i] = cur_h->counts[i] - prev_h->counts[i];
+    }
+    span.total = cur_h->total - prev_h->total;
+    char pct[160];
+    tawqa_hist_format(&span, pct, sizeof(pct));
+
+    std::printf("%s %8.1f MB/s out %8.1f MB/s in %8.0f conn/s %6llu err",
+                label,
+                static_cast<double>(cur->bytes_out - prev->bytes_out) / 1e6 / secs,
+                static_cast<double>(cur->bytes_in - prev->bytes_in) / 1e6 / secs,
+                static_cast<double>(cur->connects - prev->connects) / secs,
+                static_cast<unsigned long long>(cur->errors - prev->errors));
+    if (requests) {
+        std::printf(" %9.0f req/s", static_cast<double>(cur->requests - prev->requests) / secs);
+    }
+    std::printf(" | %s %s\n", requests ? "latency" : "connect", pct);
+    std::fflush(stdout);
+}
+
+std::uint64_t tawqa_load_run(const tawqa_load_opts* opts, tawqa_load_connect_fn connect_fn) {
+    g_connect_fn = connect_fn;
+    g_delim = opts->delim;
+    tawqa_load_payload(opts);
+
+    std::size_t threads = opts->threads;
+    if (!threads) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, opts->conns);
+
+    // Stop cleanly on ^C so the summary still prints
+    std::signal(SIGINT, tawqa_load_catch);
+    std::signal(SIGTERM, tawqa_load_catch);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::unique_ptr<tawqa_load_stats[]> stats(new tawqa_load_stats[threads]());
+    std::vector<std::thread> loops;
+    for (std::size_t i = 0; i < threads; ++i) {
+        // Spread the remainder over the first threads
+        std::size_t share = opts->conns / threads + (i < opts->conns % threads ? 1 : 0);
+        loops.emplace_back(tawqa_load_loop, share, &stats[i]);
+    }
+
+    static tawqa_load_totals prev, cur;
+    std::uint64_t start = tawqa_now_ns();
+    std::uint64_t last = start;
+    for (unsigned tick = 1; !g_stop && tick <= opts->secs; ++tick) {
+        std::uint64_t due = start + tick * 1000000000ULL;
+        while (!g_stop && tawqa_now_ns() < due) {
+            usleep(10000);
+        }
+        std::uint64_t now = tawqa_now_ns();
+        tawqa_load_collect(stats.get(), threads, &cur);
+        char label[16];
+        std::snprintf(label, sizeof(label), "[%4us]", tick);
+        tawqa_load_print(label, &cur, &prev, static_cast<double>(now - last) / 1e9, opts->delim >= 0);
+        prev = cur;
+        last = now;
+    }
+    g_stop = true;
+    for (std::thread& t : loops) {
+        t.join();
+    }
+
+    // Whole-run summary: throughput, then both latency distributions
+    static tawqa_load_totals zero;
+    tawqa_load_collect(stats.get(), threads, &cur);
+    double secs = static_cast<double>(tawqa_now_ns() - start) / 1e9;
+    tawqa_load_print("[total]", &cur, &zero, secs, opts->delim >= 0);
+    if (opts->delim >= 0) {
+        char pct[160];
+        tawqa_hist_format(&cur.connect_ns, pct, sizeof(pct));
+        std::printf("[total] %llu connects | connect %s\n",
+                    static_cast<unsigned long long>(cur.connects), pct);
+    }
+    return cur.bytes_out;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef TAWQA_LOAD_HH_INCLUDED
+#define TAWQA_LOAD_HH_INCLUDED
+
+// TAWQA Load Generator Header
+// Many concurrent connections on per-thread epoll loops
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstddef>
+#include <cstdint>
+
+// --load settings (C-style, no OOP)
+struct tawqa_load_opts {
+    std::size_t conns;         // concurrent connections
+    std::size_t threads;       // event loops, 0: one per CPU
+    unsigned secs;             // run time
+    std::size_t size;          // generated write or request size
+    const char* file;          // payload file instead of generated bytes
+    int delim;                 // request/response delimiter, -1: stream only
+};
+
+// Opens a non-blocking connection to the target, -1 if it failed outright
+using tawqa_load_connect_fn = int (*)();
+
+// Run the load, print a report line every second and a summary at the
+// end. Returns the bytes sent.
+std::uint64_t tawqa_load_run(const tawqa_load_opts* opts, tawqa_load_connect_fn connect_fn);
+
+#endif // TAWQA_LOAD_HH_INCLUDED
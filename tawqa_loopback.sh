@@ -0,0 +1,156 @@
+#!/bin/sh
+# TAWQA Loopback Tests
+# End-to-end sessions between two tawqa processes on 127.0.0.1
+# Usage: tawqa_loopback.sh [path/to/tawqa]
+
+TAWQA=${1:-./tawqa}
+PORT=${TAWQA_TEST_PORT:-47800}
+TMP=$(mktemp -d /tmp/tawqa_loopback.XXXXXX)
+FAILED=0
+
+trap 'rm -rf "$TMP"' EXIT
+
+fail() {
+    echo "FAIL: $1"
+    FAILED=1
+}
+
+pass() {
+    echo "ok: $1"
+}
+
+next_port() {
+    PORT=$((PORT + 1))
+}
+
+# --checkpoint listener with its stdin still open and a --resume sender:
+# the data must arrive and both sides must exit on their own
+test_resume_exits() {
+    next_port
+    head -c 3000000 /dev/urandom > "$TMP/src"
+    : > "$TMP/out"
+    rm -f "$TMP/hold"
+    mkfifo "$TMP/hold"
+    sleep 20 > "$TMP/hold" &
+    holder=$!
+    timeout 10 "$TAWQA" -l -p $PORT --checkpoint "$TMP/ck" < "$TMP/hold" >> "$TMP/out" &
+    listener=$!
+    sleep 0.3
+    timeout 10 "$TAWQA" --resume 127.0.0.1 $PORT < "$TMP/src"
+    crc=$?
+    wait $listener
+    lrc=$?
+    kill $holder 2>/dev/null
+    if [ "$crc" != 0 ] || [ "$lrc" != 0 ]; then
+        fail "resume: sender exit $crc, listener exit $lrc"
+    elif ! cmp -s "$TMP/src" "$TMP/out"; then
+        fail "resume: output differs"
+    else
+        pass "resume with checkpoint, both sides exit"
+    fi
+}
+
+# --fastopen against a server that speaks first, with a cookie cached by
+# two earlier connections: idle stdin must not hold the SYN back
+test_fastopen_server_first() {
+    for _ in 1 2; do
+        next_port
+        (sleep 1 | timeout 5 "$TAWQA" -l -p $PORT > /dev/null) &
+        sleep 0.2
+        echo warm | timeout 3 "$TAWQA" -N --fastopen 127.0.0.1 $PORT
+        wait
+    done
+    next_port
+    printf 'hello\n' | timeout 5 "$TAWQA" -l -p $PORT &
+    listener=$!
+    sleep 0.2
+    got=$(sleep 1 | timeout 3 "$TAWQA" --fastopen 127.0.0.1 $PORT)
+    wait $listener
+    if [ "$got" = hello ]; then
+        pass "fastopen client hears a server that speaks first"
+    else
+        fail "fastopen: got '$got' instead of hello"
+    fi
+}
+
+# --streams with input that arrives in bursts: every block must land in
+# order even when the source stalls between reads
+test_streams_slow_input() {
+    next_port
+    head -c 2000000 /dev/urandom > "$TMP/src"
+    timeout 10 "$TAWQA" -l -p $PORT --streams 3 < /dev/null > "$TMP/out" &
+    listener=$!
+    sleep 0.3
+    (head -c 100000 "$TMP/src"; sleep 0.5; tail -c +100001 "$TMP/src") |
+        timeout 10 "$TAWQA" --streams 3 127.0.0.1 $PORT
+    crc=$?
+    wait $listener
+    lrc=$?
+    if [ "$crc" != 0 ] || [ "$lrc" != 0 ]; then
+        fail "streams: sender exit $crc, listener exit $lrc"
+    elif ! cmp -s "$TMP/src" "$TMP/out"; then
+        fail "streams: output differs"
+    else
+        pass "streams with stalling input"
+    fi
+}
+
+# SIGINT on a listener writing through --out: it must leave on its own,
+# report only the interrupt and keep what arrived
+test_interrupt_sink() {
+    next_port
+    rm -f "$TMP/hold" "$TMP/sink"
+    mkfifo "$TMP/hold"
+    sleep 20 > "$TMP/hold" &
+    holder=$!
+    "$TAWQA" -l -p $PORT --out "$TMP/sink" < "$TMP/hold" 2> "$TMP/err" &
+    listener=$!
+    sleep 0.3
+    head -c 5000000 /dev/zero | timeout 10 "$TAWQA" -N --rate-out 2M 127.0.0.1 $PORT 2> /dev/null &
+    sender=$!
+    sleep 1
+    kill -INT $listener
+    (sleep 5; kill -9 $listener 2> /dev/null) &
+    guard=$!
+    wait $listener
+    lrc=$?
+    kill $guard $holder 2> /dev/null
+    wait $sender
+    if [ "$lrc" != 1 ]; then
+        fail "interrupt: listener exit $lrc"
+    elif [ "$(cat "$TMP/err")" != "Interrupted!" ]; then
+        fail "interrupt: stderr '$(cat "$TMP/err")'"
+    elif [ ! -s "$TMP/sink" ]; then
+        fail "interrupt: --out file is empty"
+    else
+        pass "SIGINT ends a --out listener cleanly"
+    fi
+}
+
+# -U -u listener: it connects to the first sender, so its stdin goes back
+test_unix_dgram_reply() {
+    sock="$TMP/dgram.sock"
+    (printf 'reply\n'; sleep 1) | timeout 5 "$TAWQA" -l -w 1 -U "$sock" -u > "$TMP/lout" &
+    listener=$!
+    sleep 0.3
+    got=$( (printf 'hi\n'; sleep 1) | timeout 2 "$TAWQA" -U "$sock" -u)
+    wait $listener
+    lrc=$?
+    if [ "$lrc" != 0 ]; then
+        fail "unix dgram: listener exit $lrc"
+    elif [ "$(cat "$TMP/lout")" != hi ]; then
+        fail "unix dgram: listener got '$(cat "$TMP/lout")'"
+    elif [ "$got" != reply ]; then
+        fail "unix dgram: client got '$got'"
+    else
+        pass "unix datagram listener replies to its sender"
+    fi
+}
+
+test_resume_exits
+test_fastopen_server_first
+test_streams_slow_input
+test_interrupt_sink
+test_unix_dgram_reply
+
+exit $FAILED
@@ -0,0 +1,308 @@
+// TAWQA Multicast Implementation
+// Protocol-independent joins (RFC 3678) and recvmmsg/sendmmsg, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_mcast.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_line.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+constexpr int TAWQA_MCAST_BATCH = 64;
+constexpr std::size_t TAWQA_MCAST_SLOT = 9216;      // fits jumbo frames
+constexpr std::size_t TAWQA_MCAST_PAYLOAD = 1472;   // one Ethernet frame over IPv4
+
+static char g_mcast_buf[TAWQA_MCAST_BATCH][TAWQA_MCAST_SLOT];
+
+// Numeric address to sockaddr, with the port filled in
+static bool tawqa_mcast_addr(const char* host, std::uint16_t port, struct sockaddr_storage* out,
+                             socklen_t* len) {
+    struct addrinfo hints = {};
+    hints.ai_flags = AI_NUMERICHOST;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* res = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &res) != 0 || !res) {
+        return false;
+    }
+    std::memcpy(out, res->ai_addr, res->ai_addrlen);
+    *len = res->ai_addrlen;
+    freeaddrinfo(res);
+
+    if (out->ss_family == AF_INET) {
+        reinterpret_cast<struct sockaddr_in*>(out)->sin_port = htons(port);
+    } else {
+        reinterpret_cast<struct sockaddr_in6*>(out)->sin6_port = htons(port);
+    }
+    return true;
+}
+
+// --mcast-if takes a name, an index or one of the interface's addresses
+static unsigned tawqa_mcast_ifindex(const char* iface) {
+    if (!iface) {
+        return 0;
+    }
+    unsigned index = if_nametoindex(iface);
+    if (!index) {
+        struct sockaddr_storage want;
+        socklen_t want_len;
+        struct ifaddrs* list = nullptr;
+        if (tawqa_mcast_addr(iface, 0, &want, &want_len) && getifaddrs(&list) == 0) {
+            for (struct ifaddrs* ifa = list; ifa && !index; ifa = ifa->ifa_next) {
+                if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != want.ss_family) {
+                    continue;
+                }
+                bool match = want.ss_family == AF_INET
+                    ? reinterpret_cast<struct sockaddr_in*>(ifa->ifa_addr)->sin_addr.s_addr ==
+                          reinterpret_cast<struct sockaddr_in*>(&want)->sin_addr.s_addr
+                    : std::memcmp(&reinterpret_cast<struct sockaddr_in6*>(ifa->ifa_addr)->sin6_addr,
+                                  &reinterpret_cast<struct sockaddr_in6*>(&want)->sin6_addr,
+                                  sizeof(struct in6_addr)) == 0;
+                if (match) {
+                    index = if_nametoindex(ifa->ifa_name);
+                }
+            }
+            freeifaddrs(list);
+        }
+    }
+    if (!index) {
+        index = static_cast<unsigned>(std::atoi(iface));
+    }
+    if (!index) {
+        tawqa_bail("Unknown interface %s", iface);
+    }
+    errno = 0;
+    return index;
+}
+
+static int tawqa_mcast_socket(const tawqa_mcast_opts* opts, std::uint16_t port,
+                              struct sockaddr_storage* group, socklen_t* group_len) {
+    if (!tawqa_mcast_addr(opts->group, port, group, group_len)) {
+        tawqa_bail("Invalid multicast group %s", opts->group);
+    }
+    int fd = socket(group->ss_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        tawqa_bail("Can't get socket");
+    }
+    return fd;
+}
+
+std::uint64_t tawqa_mcast_recv(const tawqa_mcast_opts* opts, std::uint16_t port, int out_fd,
+                               unsigned idle_secs, const tawqa_sockopts* sockopts) {
+    struct sockaddr_storage group;
+    socklen_t group_len;
+    int fd = tawqa_mcast_socket(opts, port, &group, &group_len);
+    bool v6 = group.ss_family == AF_INET6;
+    unsigned ifindex = tawqa_mcast_ifindex(opts->iface);
+    if (v6) {
+        reinterpret_cast<struct sockaddr_in6*>(&group)->sin6_scope_id = ifindex;
+    }
+    int level = v6 ? IPPROTO_IPV6 : IPPROTO_IP;
+
+    tawqa_sockopt_apply(fd, sockopts, false);
+
+    // Several receivers of one feed may share the port
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#ifdef SO_REUSEPORT
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+#endif
+    // Binding the group address filters out other groups on the same port
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&group), group_len) < 0) {
+        tawqa_bail("Can't bind to multicast group %s", opts->group);
+    }
+
+    if (opts->source) {
+        struct group_source_req req = {};
+        req.gsr_interface = ifindex;
+        std::memcpy(&req.gsr_group, &group, group_len);
+        socklen_t src_len;
+        if (!tawqa_mcast_addr(opts->source, 0, &req.gsr_source, &src_len) ||
+            req.gsr_source.ss_family != group.ss_family) {
+            tawqa_bail("Invalid multicast source %s", opts->source);
+        }
+        if (setsockopt(fd, level, MCAST_JOIN_SOURCE_GROUP, &req, sizeof(req)) < 0) {
+            tawqa_bail("Can't join %s from %s", opts->group, opts->source);
+        }
+    } else {
+        struct group_req req = {};
+        req.gr_interface = ifindex;
+        std::memcpy(&req.gr_group, &group, group_len);
+        if (setsockopt(fd, level, MCAST_JOIN_GROUP, &req, sizeof(req)) < 0) {
+            tawqa_bail("Can't join %s", opts->group);
+        }
+    }
+    tawqa_holler("Joined %s", opts->group, nullptr, nullptr);
+
+    struct mmsghdr msgs[TAWQA_MCAST_BATCH];
+    struct iovec iovs[TAWQA_MCAST_BATCH];
+    for (int i = 0; i < TAWQA_MCAST_BATCH; ++i) {
+        iovs[i].iov_base = g_mcast_buf[i];
+        iovs[i].iov_len = TAWQA_MCAST_SLOT;
+        std::memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    std::uint64_t total = 0;
+    std::uint64_t truncated = 0;
+    struct iovec out[TAWQA_MCAST_BATCH];
+    while (true) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, idle_secs ? static_cast<int>(idle_secs * 1000) : -1);
+        if (ready < 0 && errno == EINTR) {
+            tawqa_check_interrupt();
+            continue;
+        }
+        if (ready <= 0) {
+            break;
+        }
+
+        // One syscall drains up to a full batch of queued datagrams
+        int n = recvmmsg(fd, msgs, TAWQA_MCAST_BATCH, MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            tawqa_bail("recvmmsg failed");
+        }
+
+        std::size_t batch = 0;
+        for (int i = 0; i < n; ++i) {
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                ++truncated;
+            }
+            out[i].iov_base = g_mcast_buf[i];
+            out[i].iov_len = msgs[i].msg_len;
+            batch += msgs[i].msg_len;
+        }
+        if (writev(out_fd, out, n) != static_cast<ssize_t>(batch)) {
+            tawqa_bail("Write to output failed");
+        }
+        total += batch;
+    }
+
+    if (truncated) {
+        static char trunc_str[24];
+        std::snprintf(trunc_str, sizeof(trunc_str), "%llu", static_cast<unsigned long long>(truncated));
+        errno = 0;
+        tawqa_holler("%s datagrams exceeded the receive slot and were truncated", trunc_str);
+    }
+    close(fd);
+    return total;
+}
+
+std::uint64_t tawqa_mcast_send(const tawqa_mcast_opts* opts, std::uint16_t port, int in_fd,
+                               const tawqa_sockopts* sockopts) {
+    struct sockaddr_storage group;
+    socklen_t group_len;
+    int fd = tawqa_mcast_socket(opts, port, &group, &group_len);
+    bool v6 = group.ss_family == AF_INET6;
+
+    tawqa_sockopt_apply(fd, sockopts, false);
+    unsigned ifindex = tawqa_mcast_ifindex(opts->iface);
+    if (v6) {
+        reinterpret_cast<struct sockaddr_in6*>(&group)->sin6_scope_id = ifindex;
+        int hops = opts->ttl;
+        int loop = opts->loop;
+        int index = static_cast<int>(ifindex);
+        if ((ifindex && setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_IF, &index, sizeof(index)) < 0) ||
+            (hops >= 0 && setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops)) < 0) ||
+            (loop >= 0 && setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &loop, sizeof(loop)) < 0)) {
+            tawqa_bail("Can't set IPv6 multicast options");
+        }
+    } else {
+        // An address given as the interface also becomes the source
+        struct ip_mreqn mreq = {};
+        mreq.imr_ifindex = static_cast<int>(ifindex);
+        if (opts->iface) {
+            inet_pton(AF_INET, opts->iface, &mreq.imr_address);
+        }
+        int ttl = opts->ttl;
+        int loop = opts->loop;
+        if ((ifindex && setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &mreq, sizeof(mreq)) < 0) ||
+            (ttl >= 0 && setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) ||
+            (loop >= 0 && setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0)) {
+            tawqa_bail("Can't set multicast options");
+        }
+    }
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&group), group_len) < 0) {
+        tawqa_bail("Can't send to %s", opts->group);
+    }
+
+    // Input is read in one large block and cut into datagrams; a partial
+    // trailing line is carried over so records don't straddle datagrams
+    static char block[TAWQA_MCAST_BATCH * TAWQA_MCAST_PAYLOAD];
+    std::size_t have = 0;
+    bool eof = false;
+    std::uint64_t total = 0;
+    struct mmsghdr msgs[TAWQA_MCAST_BATCH];
+    struct iovec iovs[TAWQA_MCAST_BATCH];
+
+    while (!eof || have) {
+        if (!eof && have < sizeof(block)) {
+            ssize_t n = read(in_fd, block + have, sizeof(block) - have);
+            if (n < 0 && errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            if (n <= 0) {
+                eof = true;
+            } else {
+                have += static_cast<std::size_t>(n);
+            }
+        }
+
+        int count = 0;
+        std::size_t pos = 0;
+        while (count < TAWQA_MCAST_BATCH && pos < have) {
+            std::size_t len = std::min(TAWQA_MCAST_PAYLOAD, have - pos);
+            std::size_t whole = tawqa_findlast(block + pos, len);
+            if (whole) {
+                len = whole;
+            } else if (len < TAWQA_MCAST_PAYLOAD && !eof) {
+                break; // wait for the rest of this line
+            }
+            iovs[count].iov_base = block + pos;
+            iovs[count].iov_len = len;
+            std::memset(&msgs[count], 0, sizeof(msgs[count]));
+            msgs[count].msg_hdr.msg_iov = &iovs[count];
+            msgs[count].msg_hdr.msg_iovlen = 1;
+            ++count;
+            pos += len;
+        }
+        if (!count) {
+            continue;
+        }
+
+        int sent = 0;
+        while (sent < count) {
+            int n = sendmmsg(fd, msgs + sent, static_cast<unsigned>(count - sent), 0);
+            if (n < 0) {
+                if (errno == EINTR || errno == ENOBUFS) {
+                    tawqa_check_interrupt();
+                    continue;
+                }
+                tawqa_bail("sendmmsg failed");
+            }
+            sent += n;
+        }
+        total += pos;
+        std::memmove(block, block + pos, have - pos);
+        have -= pos;
+    }
+
+    close(fd);
+    return total;
+}
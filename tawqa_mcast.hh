@@ -0,0 +1,34 @@
+#pragma once
+
+#ifndef TAWQA_MCAST_HH_INCLUDED
+#define TAWQA_MCAST_HH_INCLUDED
+
+// TAWQA Multicast Header
+// Group join and batched datagram I/O for IPv4 and IPv6 feeds
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_sockopt.hh"
+#include <cstdint>
+
+// --mcast settings (C-style, no OOP). -1 / nullptr keep kernel defaults.
+struct tawqa_mcast_opts {
+    const char* group;    // numeric IPv4 or IPv6 group address
+    const char* source;   // source-specific join when set
+    const char* iface;    // interface name or index
+    int ttl;              // hop limit for sent datagrams
+    int loop;             // deliver our own datagrams locally, 0/1
+};
+
+// Join the group on `port` and copy datagrams to `out_fd` with recvmmsg
+// batches; --rcvbuf sizes the queue that absorbs bursts. Returns bytes
+// received once `idle_secs` pass without traffic (0: run until
+// interrupted).
+std::uint64_t tawqa_mcast_recv(const tawqa_mcast_opts* opts, std::uint16_t port, int out_fd,
+                               unsigned idle_secs, const tawqa_sockopts* sockopts);
+
+// Cut `in_fd` into datagrams, at line ends when a line fits, and send
+// them to the group with sendmmsg batches. Returns bytes sent.
+std::uint64_t tawqa_mcast_send(const tawqa_mcast_opts* opts, std::uint16_t port, int in_fd,
+                               const tawqa_sockopts* sockopts);
+
+#endif // TAWQA_MCAST_HH_INCLUDED
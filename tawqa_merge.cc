@@ -0,0 +1,275 @@
+// TAWQA Fan-in Merge Implementation
+// Per-connection line assembly, batched writev, one epoll loop, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_merge.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_line.hh"
+#include "tawqa_metrics.hh"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+constexpr std::size_t TAWQA_MERGE_BUF = 64 * 1024;
+constexpr int TAWQA_MERGE_IOV = 1024;
+constexpr int TAWQA_MERGE_EVENTS = 256;
+
+// Line assembler for one client: buf[0, len) is received data,
+// buf[0, ready) the whole lines queued for the next writev
+struct tawqa_merge_conn {
+    int fd;
+    bool closed;
+    bool queued;             // on the flush list for this batch
+    std::size_t len;
+    std::size_t ready;
+    tawqa_merge_conn* next_flush;
+    char peer[40];           // "addr:port " line prefix
+    std::size_t peer_len;
+    tawqa_metrics_conn* metrics;
+    char name[40];           // the same without the separator, for logs
+    char buf[TAWQA_MERGE_BUF + 1];   // +1 for a newline closing a cut line
+};
+
+static char g_merge_listen_tag;
+static struct iovec g_iov[TAWQA_MERGE_IOV];
+static int g_iovcnt = 0;
+static int g_merge_out = -1;
+static char g_stamp[40];
+static std::size_t g_stamp_len = 0;
+static tawqa_metrics_shard* g_merge_metrics = nullptr;
+
+static void tawqa_merge_writev() {
+    struct iovec* iov = g_iov;
+    int cnt = g_iovcnt;
+    while (cnt > 0) {
+        ssize_t n = writev(g_merge_out, iov, cnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            tawqa_bail("Write to output failed");
+        }
+        // Skip what went out, trimming a partially written entry
+        std::size_t left = static_cast<std::size_t>(n);
+        while (cnt > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            ++iov;
+            --cnt;
+        }
+        if (cnt > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    g_iovcnt = 0;
+}
+
+static void tawqa_merge_add(const char* p, std::size_t len) {
+    if (g_iovcnt == TAWQA_MERGE_IOV) {
+        tawqa_merge_writev();
+    }
+    g_iov[g_iovcnt].iov_base = const_cast<char*>(p);
+    g_iov[g_iovcnt].iov_len = len;
+    ++g_iovcnt;
+}
+
+// Queue conn->buf[0, end) which holds only whole lines
+static void tawqa_merge_queue(tawqa_merge_conn* conn, std::size_t end, bool prefix) {
+    if (!prefix) {
+        tawqa_merge_add(conn->buf, end);
+        return;
+    }
+    std::size_t pos = 0;
+    while (pos < end) {
+        std::size_t len = tawqa_findline(conn->buf + pos, end - pos);
+        tawqa_merge_add(g_stamp, g_stamp_len);
+        tawqa_merge_add(conn->peer, conn->peer_len);
+        tawqa_merge_add(conn->buf + pos, len);
+        pos += len;
+    }
+}
+
+// One timestamp per batch keeps the per-line cost at three iovecs
+static void tawqa_merge_stamp() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct tm tm;
+    gmtime_r(&ts.tv_sec, &tm);
+    std::size_t n = std::strftime(g_stamp, sizeof(g_stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+    n += static_cast<std::size_t>(std::snprintf(g_stamp + n, sizeof(g_stamp) - n, ".%06ldZ ",
+                                                ts.tv_nsec / 1000));
+    g_stamp_len = n;
+}
+
+// Pull everything the socket has, marking whole lines ready. False once
+// the peer is done and its last partial line has been queued.
+static bool tawqa_merge_read(tawqa_merge_conn* conn) {
+    while (true) {
+        if (conn->len == TAWQA_MERGE_BUF) {
+            // A line longer than the buffer is cut rather than interleaved
+            if (!conn->ready) {
+                conn->buf[conn->len++] = '\n';
+                conn->ready = conn->len;
+            }
+            return true;
+        }
+
+        ssize_t n = recv(conn->fd, conn->buf + conn->len, TAWQA_MERGE_BUF - conn->len, 0);
+        if (n > 0) {
+            tawqa_metrics_in(g_merge_metrics, conn->metrics, static_cast<std::uint64_t>(n));
+            std::size_t old = conn->len;
+            conn->len += static_cast<std::size_t>(n);
+            std::size_t last = tawqa_findlast(conn->buf + old, static_cast<std::size_t>(n));
+            if (last) {
+                conn->ready = old + last;
+            }
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return true;
+        }
+
+        // EOF or reset: the unterminated tail still becomes its own line
+        conn->closed = true;
+        if (conn->len > conn->ready) {
+            conn->buf[conn->len++] = '\n';
+        }
+        conn->ready = conn->len;
+        return false;
+    }
+}
+
+static void tawqa_merge_accept(int listenfd, const tawqa_sockopts* opts, int epfd) {
+    while (true) {
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept4(listenfd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                tawqa_holler("accept failed");
+            }
+            return;
+        }
+
+        auto* conn = static_cast<tawqa_merge_conn*>(std::malloc(sizeof(tawqa_merge_conn)));
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->closed = false;
+        conn->queued = false;
+        conn->len = 0;
+        conn->ready = 0;
+        conn->next_flush = nullptr;
+        if (addr.ss_family == AF_INET) {
+            const auto* sin = reinterpret_cast<const struct sockaddr_in*>(&addr);
+            std::snprintf(conn->peer, sizeof(conn->peer), "%s:%u ", inet_ntoa(sin->sin_addr),
+                          ntohs(sin->sin_port));
+        } else {
+            std::snprintf(conn->peer, sizeof(conn->peer), "local:%d ", fd);
+        }
+        conn->peer_len = std::strlen(conn->peer);
+        std::memcpy(conn->name, conn->peer, conn->peer_len - 1);
+        conn->name[conn->peer_len - 1] = '\0';
+        conn->metrics = tawqa_metrics_open(g_merge_metrics, conn->name);
+        tawqa_sockopt_apply(fd, opts, addr.ss_family == AF_INET);
+
+        // Level-triggered: a client left unread behind a full buffer
+        // is simply reported again next round
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = conn;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+
+        errno = 0;
+        tawqa_holler("Merging %s", conn->name);
+    }
+}
+
+void tawqa_merge_run(int listenfd, int out_fd, bool prefix, const tawqa_sockopts* opts) {
+    g_merge_out = out_fd;
+    g_merge_metrics = tawqa_metrics_shard_new();
+    fcntl(listenfd, F_SETFL, fcntl(listenfd, F_GETFL) | O_NONBLOCK);
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        tawqa_bail("epoll_create1 failed");
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &g_merge_listen_tag;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &ev);
+
+    struct epoll_event events[TAWQA_MERGE_EVENTS];
+    while (true) {
+        int n = epoll_wait(epfd, events, TAWQA_MERGE_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            tawqa_bail("epoll_wait failed");
+        }
+
+        // Read every ready client, then emit all their whole lines with
+        // as few writev calls as the iovec limit allows
+        tawqa_merge_conn* flush = nullptr;
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr == &g_merge_listen_tag) {
+                tawqa_merge_accept(listenfd, opts, epfd);
+                continue;
+            }
+            auto* conn = static_cast<tawqa_merge_conn*>(events[i].data.ptr);
+            if (conn->queued) {
+                continue;
+            }
+            tawqa_merge_read(conn);
+            if (conn->ready || conn->closed) {
+                conn->queued = true;
+                conn->next_flush = flush;
+                flush = conn;
+            }
+        }
+        if (!flush) {
+            continue;
+        }
+
+        if (prefix) {
+            tawqa_merge_stamp();
+        }
+        for (tawqa_merge_conn* conn = flush; conn; conn = conn->next_flush) {
+            if (conn->ready) {
+                tawqa_merge_queue(conn, conn->ready, prefix);
+            }
+        }
+        tawqa_merge_writev();
+
+        // Keep each partial line for the next round
+        for (tawqa_merge_conn* conn = flush, *next; conn; conn = next) {
+            next = conn->next_flush;
+            if (conn->closed) {
+                errno = 0;
+                tawqa_holler("Closed %s", conn->name);
+                tawqa_metrics_close(g_merge_metrics, conn->metrics);
+                close(conn->fd);
+                std::free(conn);
+                continue;
+            }
+            std::memmove(conn->buf, conn->buf + conn->ready, conn->len - conn->ready);
+            conn->len -= conn->ready;
+            conn->ready = 0;
+            conn->queued = false;
+        }
+    }
+}
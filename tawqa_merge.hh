@@ -0,0 +1,17 @@
+#pragma once
+
+#ifndef TAWQA_MERGE_HH_INCLUDED
+#define TAWQA_MERGE_HH_INCLUDED
+
+// TAWQA Fan-in Merge Header
+// Many client streams to one output, never splitting a line
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_sockopt.hh"
+
+// Accept clients on `listenfd` forever and write their data to `out_fd`
+// in whole lines. With `prefix`, every line starts with a UTC timestamp
+// and the peer address.
+[[noreturn]] void tawqa_merge_run(int listenfd, int out_fd, bool prefix, const tawqa_sockopts* opts);
+
+#endif // TAWQA_MERGE_HH_INCLUDED
@@ -0,0 +1,453 @@
+// TAWQA Metrics Export Implementation
+// Exporter thread summing single-writer shards on each read, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_metrics.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_netio.hh"
+#include "tawqa_stats.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+enum tawqa_metrics_slot : int {
+    TAWQA_SLOT_FREE = 0,
+    TAWQA_SLOT_CLAIMED,
+    TAWQA_SLOT_LIVE,
+};
+
+// Cumulative Prometheus buckets for latency histograms, in seconds
+static const double g_le_secs[] = {0.00001, 0.0001, 0.001, 0.01, 0.1, 1, 10};
+
+static tawqa_metrics_shard g_shards[TAWQA_METRICS_SHARDS];
+static std::atomic<std::size_t> g_shard_count{0};
+static tawqa_metrics_conn g_conns[TAWQA_METRICS_CONNS];
+static std::atomic<std::size_t> g_conn_hint{0};
+
+static const char* g_dest = nullptr;   // file path, or the socket path
+static bool g_to_file = false;
+static int g_listenfd = -1;
+static tawqa_metrics_format g_format = TAWQA_METRICS_PROM;
+static std::uint64_t g_interval_ns = 0;
+static std::uint64_t g_start_ns = 0;
+static std::atomic<bool> g_stop{false};
+static std::thread g_exporter;
+
+bool tawqa_metrics_parse_format(const char* str, tawqa_metrics_format* format) {
+    if (std::strcmp(str, "prom") == 0 || std::strcmp(str, "prometheus") == 0) {
+        *format = TAWQA_METRICS_PROM;
+    } else if (std::strcmp(str, "json") == 0) {
+        *format = TAWQA_METRICS_JSON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+tawqa_metrics_shard* tawqa_metrics_shard_new() {
+    std::size_t index = g_shard_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= TAWQA_METRICS_SHARDS) {
+        tawqa_bail("Too many metrics shards");
+    }
+    return &g_shards[index];
+}
+
+tawqa_metrics_conn* tawqa_metrics_open(tawqa_metrics_shard* shard, const char* peer) {
+    tawqa_metrics_bump(&shard->accepted, 1);
+
+    // Claim a free slot; owners race only with each other, never the reader
+    std::size_t hint = g_conn_hint.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < TAWQA_METRICS_CONNS; ++i) {
+        tawqa_metrics_conn* conn = &g_conns[(hint + i) % TAWQA_METRICS_CONNS];
+        int expected = TAWQA_SLOT_FREE;
+        if (!conn->state.compare_exchange_strong(expected, TAWQA_SLOT_CLAIMED, std::memory_order_acquire)) {
+            continue;
+        }
+        conn->bytes_in.store(0, std::memory_order_relaxed);
+        conn->bytes_out.store(0, std::memory_order_relaxed);
+        conn->opened_ns = tawqa_now_ns();
+        std::snprintf(conn->peer, sizeof(conn->peer), "%s", peer);
+        conn->state.store(TAWQA_SLOT_LIVE, std::memory_order_release);
+        g_conn_hint.store((hint + i + 1) % TAWQA_METRICS_CONNS, std::memory_order_relaxed);
+        return conn;
+    }
+    return nullptr;
+}
+
+void tawqa_metrics_close(tawqa_metrics_shard* shard, tawqa_metrics_conn* conn) {
+    tawqa_metrics_bump(&shard->closed, 1);
+    if (conn) {
+        conn->state.store(TAWQA_SLOT_FREE, std::memory_order_release);
+    }
+}
+
+void tawqa_metrics_connected(tawqa_metrics_shard* shard, std::uint64_t ns) {
+    tawqa_metrics_bump(&shard->connect_ns, ns);
+    tawqa_hist_record(&shard->connect_hist, ns);
+}
+
+// Rendering
+
+struct tawqa_metrics_totals {
+    std::uint64_t accepted;
+    std::uint64_t closed;
+    std::uint64_t bytes_in;
+    std::uint64_t bytes_out;
+    std::uint64_t dropped;
+    std::uint64_t connect_ns;
+};
+
+__attribute__((format(printf, 2, 3)))
+static void tawqa_metrics_printf(std::string* out, const char* fmt, ...) {
+    char line[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = std::vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        out->append(line, std::min(static_cast<std::size_t>(n), sizeof(line) - 1));
+    }
+}
+
+static unsigned long long tawqa_ull(std::uint64_t v) {
+    return static_cast<unsigned long long>(v);
+}
+
+static double tawqa_secs(std::uint64_t ns) {
+    return static_cast<double>(ns) / 1e9;
+}
+
+static void tawqa_metrics_sum(tawqa_metrics_totals* totals, tawqa_hist_sum* connect) {
+    std::size_t count = std::min(g_shard_count.load(std::memory_order_relaxed), TAWQA_METRICS_SHARDS);
+    for (std::size_t i = 0; i < count; ++i) {
+        const tawqa_metrics_shard& shard = g_shards[i];
+        totals->accepted += shard.accepted.load(std::memory_order_relaxed);
+        totals->closed += shard.closed.load(std::memory_order_relaxed);
+        totals->bytes_in += shard.bytes_in.load(std::memory_order_relaxed);
+        totals->bytes_out += shard.bytes_out.load(std::memory_order_relaxed);
+        totals->dropped += shard.dropped.load(std::memory_order_relaxed);
+        totals->connect_ns += shard.connect_ns.load(std::memory_order_relaxed);
+        tawqa_hist_add(connect, &shard.connect_hist);
+    }
+}
+
+static void tawqa_metrics_help(std::string* out, const char* name, const char* type, const char* help) {
+    tawqa_metrics_printf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// name_bucket/_sum/_count from a histogram of ns values
+static void tawqa_metrics_prom_hist(std::string* out, const char* name, const char* labels,
+                                    const tawqa_hist_sum* hist, std::uint64_t sum_ns) {
+    const char* sep = labels[0] ? "," : "";
+    for (double le : g_le_secs) {
+        tawqa_metrics_printf(out, "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, sep, le,
+                             tawqa_ull(tawqa_hist_count_upto(hist, static_cast<std::uint64_t>(le * 1e9))));
+    }
+    tawqa_metrics_printf(out, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep, tawqa_ull(hist->total));
+    const char* open = labels[0] ? "{" : "";
+    const char* close = labels[0] ? "}" : "";
+    tawqa_metrics_printf(out, "%s_sum%s%s%s %.9f\n", name, open, labels, close, tawqa_secs(sum_ns));
+    tawqa_metrics_printf(out, "%s_count%s%s%s %llu\n", name, open, labels, close, tawqa_ull(hist->total));
+}
+
+static void tawqa_metrics_json_hist(std::string* out, const tawqa_hist_sum* hist, std::uint64_t sum_ns) {
+    tawqa_metrics_printf(out, "{\"count\":%llu,\"sum\":%.9f,\"p50\":%.9f,\"p90\":%.9f,\"p99\":%.9f,\"max\":%.9f}",
+                         tawqa_ull(hist->total), tawqa_secs(sum_ns),
+                         tawqa_secs(tawqa_hist_value_at(hist, 50)), tawqa_secs(tawqa_hist_value_at(hist, 90)),
+                         tawqa_secs(tawqa_hist_value_at(hist, 99)), tawqa_secs(tawqa_hist_value_at(hist, 100)));
+}
+
+static const char* g_relay_dirs[TAWQA_STATS_DIRS] = {"sent", "received"};
+
+static void tawqa_metrics_prom(std::string* out) {
+    static tawqa_hist_sum connect, blocked[TAWQA_STATS_DIRS];
+    tawqa_metrics_totals totals = {};
+    connect = {};
+    tawqa_metrics_sum(&totals, &connect);
+    std::uint64_t now = tawqa_now_ns();
+
+    tawqa_metrics_help(out, "tawqa_uptime_seconds", "gauge", "Seconds since tawqa started exporting");
+    tawqa_metrics_printf(out, "tawqa_uptime_seconds %.3f\n", tawqa_secs(now - g_start_ns));
+    tawqa_metrics_help(out, "tawqa_connections_accepted_total", "counter", "Connections accepted");
+    tawqa_metrics_printf(out, "tawqa_connections_accepted_total %llu\n", tawqa_ull(totals.accepted));
+    tawqa_metrics_help(out, "tawqa_connections_closed_total", "counter", "Connections closed");
+    tawqa_metrics_printf(out, "tawqa_connections_closed_total %llu\n", tawqa_ull(totals.closed));
+    tawqa_metrics_help(out, "tawqa_connections_open", "gauge", "Connections open now");
+    tawqa_metrics_printf(out, "tawqa_connections_open %llu\n", tawqa_ull(totals.accepted > totals.closed ? totals.accepted - totals.closed : 0));
+    tawqa_metrics_help(out, "tawqa_bytes_total", "counter", "Bytes read from (in) and written to (out) clients");
+    tawqa_metrics_printf(out, "tawqa_bytes_total{direction=\"in\"} %llu\n", tawqa_ull(totals.bytes_in));
+    tawqa_metrics_printf(out, "tawqa_bytes_total{direction=\"out\"} %llu\n", tawqa_ull(totals.bytes_out));
+    tawqa_metrics_help(out, "tawqa_dropped_bytes_total", "counter", "Bytes skipped for slow broadcast clients");
+    tawqa_metrics_printf(out, "tawqa_dropped_bytes_total %llu\n", tawqa_ull(totals.dropped));
+    tawqa_metrics_help(out, "tawqa_upstream_connect_seconds", "histogram", "Time to connect to the --forward target");
+    tawqa_metrics_prom_hist(out, "tawqa_upstream_connect_seconds", "", &connect, totals.connect_ns);
+
+    tawqa_metrics_help(out, "tawqa_connection_bytes_total", "counter", "Bytes per open connection");
+    for (std::size_t i = 0; i < TAWQA_METRICS_CONNS; ++i) {
+        const tawqa_metrics_conn& conn = g_conns[i];
+        if (conn.state.load(std::memory_order_acquire) != TAWQA_SLOT_LIVE) {
+            continue;
+        }
+        tawqa_metrics_printf(out, "tawqa_connection_bytes_total{conn=\"%zu\",peer=\"%s\",direction=\"in\"} %llu\n", i,
+                             conn.peer, tawqa_ull(conn.bytes_in.load(std::memory_order_relaxed)));
+        tawqa_metrics_printf(out, "tawqa_connection_bytes_total{conn=\"%zu\",peer=\"%s\",direction=\"out\"} %llu\n", i,
+                             conn.peer, tawqa_ull(conn.bytes_out.load(std::memory_order_relaxed)));
+    }
+    tawqa_metrics_help(out, "tawqa_connection_age_seconds", "gauge", "Seconds each open connection has been up");
+    for (std::size_t i = 0; i < TAWQA_METRICS_CONNS; ++i) {
+        const tawqa_metrics_conn& conn = g_conns[i];
+        if (conn.state.load(std::memory_order_acquire) != TAWQA_SLOT_LIVE) {
+            continue;
+        }
+        tawqa_metrics_printf(out, "tawqa_connection_age_seconds{conn=\"%zu\",peer=\"%s\"} %.3f\n", i, conn.peer,
+                             tawqa_secs(now - conn.opened_ns));
+    }
+
+    // The plain relay keeps its own counters in tawqa_stats
+    tawqa_stats_counts counts[TAWQA_STATS_DIRS];
+    for (int dir = TAWQA_STATS_SENT; dir < TAWQA_STATS_DIRS; ++dir) {
+        blocked[dir] = {};
+        if (!tawqa_stats_get(static_cast<tawqa_stats_dir>(dir), &counts[dir], &blocked[dir])) {
+            return;
+        }
+    }
+    tawqa_metrics_help(out, "tawqa_relay_bytes_total", "counter", "Bytes relayed stdin -> network (sent) and back");
+    for (int dir = TAWQA_STATS_SENT; dir < TAWQA_STATS_DIRS; ++dir) {
+        tawqa_metrics_printf(out, "tawqa_relay_bytes_total{direction=\"%s\"} %llu\n", g_relay_dirs[dir],
+                             tawqa_ull(counts[dir].bytes));
+    }
+    tawqa_metrics_help(out, "tawqa_relay_syscalls_total", "counter", "Relay reads and writes per direction");
+    for (int dir = TAWQA_STATS_SENT; dir < TAWQA_STATS_DIRS; ++dir) {
+        tawqa_metrics_printf(out, "tawqa_relay_syscalls_total{direction=\"%s\",call=\"read\"} %llu\n",
+                             g_relay_dirs[dir], tawqa_ull(counts[dir].reads));
+        tawqa_metrics_printf(out, "tawqa_relay_syscalls_total{direction=\"%s\",call=\"write\"} %llu\n",
+                             g_relay_dirs[dir], tawqa_ull(counts[dir].writes));
+    }
+    tawqa_metrics_help(out, "tawqa_relay_write_seconds", "histogram", "Time each relay write blocked");
+    for (int dir = TAWQA_STATS_SENT; dir < TAWQA_STATS_DIRS; ++dir) {
+        char labels[32];
+        std::snprintf(labels, sizeof(labels), "direction=\"%s\"", g_relay_dirs[dir]);
+        tawqa_metrics_prom_hist(out, "tawqa_relay_write_seconds", labels, &blocked[dir], counts[dir].blocked_ns);
+    }
+}
+
+static void tawqa_metrics_json(std::string* out) {
+    static tawqa_hist_sum connect, blocked;
+    tawqa_metrics_totals totals = {};
+    connect = {};
+    tawqa_metrics_sum(&totals, &connect);
+    std::uint64_t now = tawqa_now_ns();
+
+    tawqa_metrics_printf(out, "{\"uptime_seconds\":%.3f,", tawqa_secs(now - g_start_ns));
+    tawqa_metrics_printf(out, "\"connections\":{\"accepted\":%llu,\"closed\":%llu,\"open\":%llu},",
+                         tawqa_ull(totals.accepted), tawqa_ull(totals.closed),
+                         tawqa_ull(totals.accepted > totals.closed ? totals.accepted - totals.closed : 0));
+    tawqa_metrics_printf(out, "\"bytes\":{\"in\":%llu,\"out\":%llu},\"dropped_bytes\":%llu,",
+                         tawqa_ull(totals.bytes_in), tawqa_ull(totals.bytes_out), tawqa_ull(totals.dropped));
+    out->append("\"upstream_connect_seconds\":");
+    tawqa_metrics_json_hist(out, &connect, totals.connect_ns);
+
+    out->append(",\"relay\":");
+    tawqa_stats_counts counts;
+    for (int dir = TAWQA_STATS_SENT; dir < TAWQA_STATS_DIRS; ++dir) {
+        blocked = {};
+        if (!tawqa_stats_get(static_cast<tawqa_stats_dir>(dir), &counts, &blocked)) {
+            out->append("null");
+            break;
+        }
+        tawqa_metrics_printf(out, "%s\"%s\":{\"bytes\":%llu,\"reads\":%llu,\"writes\":%llu,\"write_seconds\":",
+                             dir ? "," : "{", g_relay_dirs[dir], tawqa_ull(counts.bytes), tawqa_ull(counts.reads),
+                             tawqa_ull(counts.writes));
+        tawqa_metrics_json_hist(out, &blocked, counts.blocked_ns);
+        out->append(dir == TAWQA_STATS_DIRS - 1 ? "}}" : "}");
+    }
+
+    out->append(",\"open\":[");
+    bool first = true;
+    for (std::size_t i = 0; i < TAWQA_METRICS_CONNS; ++i) {
+        const tawqa_metrics_conn& conn = g_conns[i];
+        if (conn.state.load(std::memory_order_acquire) != TAWQA_SLOT_LIVE) {
+            continue;
+        }
+        tawqa_metrics_printf(out, "%s{\"conn\":%zu,\"peer\":\"%s\",\"age_seconds\":%.3f,\"bytes_in\":%llu,"
+                             "\"bytes_out\":%llu}",
+                             first ? "" : ",", i, conn.peer, tawqa_secs(now - conn.opened_ns),
+                             tawqa_ull(conn.bytes_in.load(std::memory_order_relaxed)),
+                             tawqa_ull(conn.bytes_out.load(std::memory_order_relaxed)));
+        first = false;
+    }
+    out->append("]}\n");
+}
+
+static void tawqa_metrics_render(std::string* out) {
+    out->clear();
+    if (g_format == TAWQA_METRICS_JSON) {
+        tawqa_metrics_json(out);
+    } else {
+        tawqa_metrics_prom(out);
+    }
+}
+
+// Export
+
+// Write a temporary file and rename it over dest, so readers never see
+// half a snapshot
+static void tawqa_metrics_write_file(std::string* body) {
+    tawqa_metrics_render(body);
+    std::string tmp = std::string(g_dest) + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        tawqa_holler("Can't write metrics to %s", tmp.c_str());
+        return;
+    }
+    bool ok = tawqa_writen(fd, body->data(), body->size()) == body->size();
+    close(fd);
+    if (!ok || rename(tmp.c_str(), g_dest) < 0) {
+        tawqa_holler("Can't write metrics to %s", g_dest);
+        unlink(tmp.c_str());
+    }
+}
+
+// One scrape: an HTTP GET gets a response header, anything else just the body
+static void tawqa_metrics_serve(std::string* body) {
+    int fd = accept4(g_listenfd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct timeval tv = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char request[1024];
+    std::size_t got = 0;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    while (got < sizeof(request) - 1 && poll(&pfd, 1, 100) > 0) {
+        ssize_t n = recv(fd, request + got, sizeof(request) - 1 - got, 0);
+        if (n <= 0) {
+            break;
+        }
+        got += static_cast<std::size_t>(n);
+        request[got] = '\0';
+        if (std::strncmp(request, "GET ", got < 4 ? got : 4) != 0 || std::strstr(request, "\r\n\r\n")) {
+            break;
+        }
+    }
+    bool http = got >= 4 && std::strncmp(request, "GET ", 4) == 0;
+
+    tawqa_metrics_render(body);
+    if (http) {
+        char header[160];
+        int n = std::snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                              "Connection: close\r\n\r\n",
+                              g_format == TAWQA_METRICS_JSON ? "application/json" : "text/plain; version=0.0.4",
+                              body->size());
+        tawqa_writen(fd, header, static_cast<std::size_t>(n));
+    }
+    tawqa_writen(fd, body->data(), body->size());
+
+    // Let the client read everything before the close
+    shutdown(fd, SHUT_WR);
+    while (poll(&pfd, 1, 100) > 0 && recv(fd, request, sizeof(request), 0) > 0) {
+    }
+    close(fd);
+}
+
+static void tawqa_metrics_loop() {
+    std::string body;
+    std::uint64_t next_ns = 0;
+    while (!g_stop.load(std::memory_order_relaxed)) {
+        if (g_to_file) {
+            std::uint64_t now = tawqa_now_ns();
+            if (now >= next_ns) {
+                tawqa_metrics_write_file(&body);
+                next_ns = now + g_interval_ns;
+            }
+            poll(nullptr, 0, 200);
+            continue;
+        }
+        struct pollfd pfd = {g_listenfd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) > 0) {
+            tawqa_metrics_serve(&body);
+        }
+    }
+}
+
+static int tawqa_metrics_listen(const char* path) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::size_t len = std::strlen(path);
+    if (len >= sizeof(addr.sun_path)) {
+        tawqa_bail("Unix socket path too long: %s", path);
+    }
+    std::memcpy(addr.sun_path, path, len);
+    if (path[0] == '@') {
+        addr.sun_path[0] = '\0';
+    }
+    socklen_t addr_len = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + len);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        tawqa_bail("Can't get socket");
+    }
+    struct stat st;
+    if (path[0] != '@' && lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), addr_len) < 0 || listen(fd, 16) < 0) {
+        tawqa_bail("Can't bind to %s", path);
+    }
+    return fd;
+}
+
+void tawqa_metrics_start(const char* dest, tawqa_metrics_format format, unsigned interval) {
+    g_format = format;
+    g_interval_ns = (interval ? interval : 1) * 1000000000ULL;
+    g_start_ns = tawqa_now_ns();
+    if (std::strncmp(dest, "unix:", 5) == 0) {
+        g_dest = dest + 5;
+        g_listenfd = tawqa_metrics_listen(g_dest);
+    } else {
+        g_dest = dest;
+        g_to_file = true;
+    }
+    sigset_t saved;
+    tawqa_signals_block(&saved);
+    g_exporter = std::thread(tawqa_metrics_loop);
+    tawqa_signals_restore(&saved);
+
+    // Proxy and fan-in modes only end by Ctrl-C, through exit(): stop the
+    // exporter there and leave the final snapshot behind
+    std::atexit(tawqa_metrics_finish);
+}
+
+void tawqa_metrics_finish() {
+    if (!g_exporter.joinable()) {
+        return;
+    }
+    g_stop.store(true, std::memory_order_relaxed);
+    if (g_exporter.get_id() == std::this_thread::get_id()) {
+        g_exporter.detach();
+        return;
+    }
+    g_exporter.join();
+    if (g_to_file) {
+        std::string body;
+        tawqa_metrics_write_file(&body);
+    } else {
+        close(g_listenfd);
+        if (g_dest[0] != '@') {
+            unlink(g_dest);
+        }
+    }
+}
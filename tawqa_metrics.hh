@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef TAWQA_METRICS_HH_INCLUDED
+#define TAWQA_METRICS_HH_INCLUDED
+
+// TAWQA Metrics Export Header
+// Per-thread and per-connection counters served as Prometheus text or JSON
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_hist.hh"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum tawqa_metrics_format {
+    TAWQA_METRICS_PROM,
+    TAWQA_METRICS_JSON,
+};
+
+// Connections tracked one by one; later ones still count in the totals
+constexpr std::size_t TAWQA_METRICS_CONNS = 1024;
+constexpr std::size_t TAWQA_METRICS_SHARDS = 64;
+
+// One event loop thread's totals. Only the owner writes, the exporter
+// sums every shard on read, so the hot path never locks.
+struct alignas(64) tawqa_metrics_shard {
+    std::atomic<std::uint64_t> accepted;
+    std::atomic<std::uint64_t> closed;
+    std::atomic<std::uint64_t> bytes_in;    // read from clients
+    std::atomic<std::uint64_t> bytes_out;   // written to clients
+    std::atomic<std::uint64_t> dropped;     // discarded for slow clients
+    std::atomic<std::uint64_t> connect_ns;  // sum over connect_hist
+    tawqa_hist connect_hist;                // upstream connect latency
+};
+
+// One live connection, same single-writer rule as its shard
+struct alignas(64) tawqa_metrics_conn {
+    std::atomic<int> state;                 // free, claimed, live
+    std::atomic<std::uint64_t> bytes_in;
+    std::atomic<std::uint64_t> bytes_out;
+    std::uint64_t opened_ns;
+    char peer[48];
+};
+
+bool tawqa_metrics_parse_format(const char* str, tawqa_metrics_format* format);
+
+// Serve on dest, "unix:path" (@name: abstract) answering each connection,
+// plain or HTTP GET, with a snapshot; any other dest is a file rewritten
+// every interval seconds. Starts the exporter thread.
+void tawqa_metrics_start(const char* dest, tawqa_metrics_format format, unsigned interval);
+
+// Stop the exporter; a file gets its final snapshot. Also runs from
+// exit(), a second call does nothing.
+void tawqa_metrics_finish();
+
+// A shard for the calling thread, kept until exit
+tawqa_metrics_shard* tawqa_metrics_shard_new();
+
+// Count an accepted connection and track it by peer; nullptr once the
+// table is full, which the calls below accept
+tawqa_metrics_conn* tawqa_metrics_open(tawqa_metrics_shard* shard, const char* peer);
+void tawqa_metrics_close(tawqa_metrics_shard* shard, tawqa_metrics_conn* conn);
+
+// Single writer: a plain load and store, no locked add
+inline void tawqa_metrics_bump(std::atomic<std::uint64_t>* counter, std::uint64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void tawqa_metrics_in(tawqa_metrics_shard* shard, tawqa_metrics_conn* conn, std::uint64_t n) {
+    tawqa_metrics_bump(&shard->bytes_in, n);
+    if (conn) {
+        tawqa_metrics_bump(&conn->bytes_in, n);
+    }
+}
+
+inline void tawqa_metrics_out(tawqa_metrics_shard* shard, tawqa_metrics_conn* conn, std::uint64_t n) {
+    tawqa_metrics_bump(&shard->bytes_out, n);
+    if (conn) {
+        tawqa_metrics_bump(&conn->bytes_out, n);
+    }
+}
+
+void tawqa_metrics_connected(tawqa_metrics_shard* shard, std::uint64_t ns);
+
+#endif // TAWQA_METRICS_HH_INCLUDED
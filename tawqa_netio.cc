@@ -0,0 +1,111 @@
+// TAWQA Network I/O Helpers Implementation
+// Modern C++23 without OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_netio.hh"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+std::size_t tawqa_readn(int fd, void* buf, std::size_t len) {
+    auto* p = static_cast<char*>(buf);
+    std::size_t done = 0;
+
+    while (done < len) {
+        ssize_t n = read(fd, p + done, len - done);
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return done;
+}
+
+std::size_t tawqa_writen(int fd, const void* buf, std::size_t len) {
+    const auto* p = static_cast<const char*>(buf);
+    std::size_t done = 0;
+
+    while (done < len) {
+        ssize_t n = write(fd, p + done, len - done);
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return done;
+}
+
+bool tawqa_splice_open(tawqa_splice_dir* dir, int src, int dst, int pipe_size) {
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        return false;
+    }
+    dir->src = src;
+    dir->dst = dst;
+    dir->pipe_rd = fds[0];
+    dir->pipe_wr = fds[1];
+#ifdef F_SETPIPE_SZ
+    fcntl(fds[1], F_SETPIPE_SZ, pipe_size);
+#endif
+    int size = 65536;
+#ifdef F_GETPIPE_SZ
+    size = fcntl(fds[1], F_GETPIPE_SZ);
+#endif
+    dir->capacity = static_cast<std::size_t>(size > 0 ? size : 65536);
+    dir->pending = 0;
+    dir->moved = 0;
+    dir->calls = 0;
+    dir->eof = false;
+    dir->shut = false;
+    return true;
+}
+
+bool tawqa_splice_pump(tawqa_splice_dir* dir) {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+
+        if (!dir->eof && dir->pending < dir->capacity) {
+            ssize_t n = splice(dir->src, nullptr, dir->pipe_wr, nullptr, dir->capacity - dir->pending,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            dir->calls += 1;
+            if (n > 0) {
+                dir->pending += static_cast<std::size_t>(n);
+                progress = true;
+            } else if (n == 0) {
+                dir->eof = true;
+            } else if (errno != EAGAIN && errno != EINTR) {
+                return false;
+            }
+        }
+
+        if (dir->pending) {
+            ssize_t n = splice(dir->pipe_rd, nullptr, dir->dst, nullptr, dir->pending,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            dir->calls += 1;
+            if (n > 0) {
+                dir->pending -= static_cast<std::size_t>(n);
+                dir->moved += static_cast<std::uint64_t>(n);
+                progress = true;
+            } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+    // Pass the half-close on once everything before it went out
+    if (dir->eof && !dir->pending && !dir->shut) {
+        shutdown(dir->dst, SHUT_WR);
+        dir->shut = true;
+    }
+    return true;
+}
+
+void tawqa_splice_close(tawqa_splice_dir* dir) {
+    if (dir->pipe_rd >= 0) {
+        close(dir->pipe_rd);
+        close(dir->pipe_wr);
+        dir->pipe_rd = dir->pipe_wr = -1;
+    }
+}
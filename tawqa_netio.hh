@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef TAWQA_NETIO_HH_INCLUDED
+#define TAWQA_NETIO_HH_INCLUDED
+
+// TAWQA Network I/O Helpers Header
+// Full-length reads/writes, splice relaying and big-endian wire encoding
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstdint>
+#include <cstddef>
+#include <sys/types.h>
+
+// Loop until `len` bytes moved; returns bytes done, short on EOF, error or
+// EINTR. SIGUSR1 restarts calls, so EINTR means SIGINT/SIGTERM arrived and
+// the caller should let its loop check for the interrupt.
+std::size_t tawqa_readn(int fd, void* buf, std::size_t len);
+std::size_t tawqa_writen(int fd, const void* buf, std::size_t len);
+
+// One direction of a spliced relay: src -> pipe -> dst
+struct tawqa_splice_dir {
+    int src;
+    int dst;
+    int pipe_rd;
+    int pipe_wr;
+    std::size_t pending;   // bytes sitting in the pipe
+    std::size_t capacity;
+    std::uint64_t moved;
+    std::uint64_t calls;   // splice() calls so far
+    bool eof;              // src has no more data
+    bool shut;             // dst write side closed after draining
+};
+
+// Set up the pipe, asking for `pipe_size` bytes; false if out of fds
+bool tawqa_splice_open(tawqa_splice_dir* dir, int src, int dst, int pipe_size);
+
+// Move as much as src and dst allow without blocking on the pipe, then
+// pass EOF on as a half-close once the pipe is empty. False on a hard
+// error. The relay step of --forward, also driven by the benchmarks.
+bool tawqa_splice_pump(tawqa_splice_dir* dir);
+
+// Release the pipe; src and dst stay open
+void tawqa_splice_close(tawqa_splice_dir* dir);
+
+// Big-endian wire encoding for frame headers
+inline void tawqa_put_be32(unsigned char* p, std::uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+inline std::uint32_t tawqa_get_be32(const unsigned char* p) {
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+           (static_cast<std::uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline void tawqa_put_be64(unsigned char* p, std::uint64_t v) {
+    tawqa_put_be32(p, static_cast<std::uint32_t>(v >> 32));
+    tawqa_put_be32(p + 4, static_cast<std::uint32_t>(v));
+}
+
+inline std::uint64_t tawqa_get_be64(const unsigned char* p) {
+    return (static_cast<std::uint64_t>(tawqa_get_be32(p)) << 32) | tawqa_get_be32(p + 4);
+}
+
+#endif // TAWQA_NETIO_HH_INCLUDED
@@ -0,0 +1,148 @@
+// TAWQA Rate Limiting Implementation
+// Token bucket refilled from the monotonic clock, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_rate.hh"
+#include "tawqa_generic.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <sys/socket.h>
+
+constexpr std::uint64_t TAWQA_NS_PER_SEC = 1000000000ULL;
+
+std::uint64_t tawqa_parse_rate(const char* str) {
+    if (!str) {
+        return 0;
+    }
+
+    char* end = nullptr;
+    double value = std::strtod(str, &end);
+    if (end == str || value <= 0) {
+        return 0;
+    }
+
+    switch (*end) {
+        case 'k': case 'K': value *= 1e3; ++end; break;
+        case 'm': case 'M': value *= 1e6; ++end; break;
+        case 'g': case 'G': value *= 1e9; ++end; break;
+        default: break;
+    }
+
+    if (*end == 'b') {
+        value /= 8;
+        ++end;
+    } else if (*end == 'B') {
+        ++end;
+    }
+
+    if (*end != '\0' || value < 1) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(value);
+}
+
+std::uint64_t tawqa_parse_size(const char* str) {
+    if (!str) {
+        return 0;
+    }
+
+    char* end = nullptr;
+    double value = std::strtod(str, &end);
+    if (end == str || value <= 0) {
+        return 0;
+    }
+
+    switch (*end) {
+        case 'k': case 'K': value *= 1024.0; ++end; break;
+        case 'm': case 'M': value *= 1024.0 * 1024; ++end; break;
+        case 'g': case 'G': value *= 1024.0 * 1024 * 1024; ++end; break;
+        default: break;
+    }
+    if (*end == 'B') {
+        ++end;
+    }
+
+    if (*end != '\0' || value < 1) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(value);
+}
+
+void tawqa_bucket_init(tawqa_bucket* bucket, std::uint64_t rate, std::size_t chunk) {
+    bucket->rate = rate;
+    // 10ms worth of data keeps syscalls large at high rates, while a few
+    // chunks of depth keep low rates from stalling on a single read; never
+    // more than a second's worth, or a slow cap goes out in one gulp
+    bucket->burst = std::min<std::uint64_t>(rate, std::max<std::uint64_t>(rate / 100, 4 * chunk));
+    // Slow rates trickle in 10ms slices instead of waiting for a whole chunk
+    bucket->quantum = std::min<std::uint64_t>(chunk, std::max<std::uint64_t>(rate / 100, 1));
+    // Start with one slice so the first read goes out without a wait
+    bucket->tokens = bucket->quantum;
+    bucket->frac = 0;
+    bucket->last_ns = tawqa_now_ns();
+}
+
+std::size_t tawqa_bucket_grant(tawqa_bucket* bucket, std::size_t want, std::uint64_t now_ns) {
+    if (bucket->rate == 0) {
+        return want;
+    }
+
+    std::uint64_t elapsed = now_ns - bucket->last_ns;
+    bucket->last_ns = now_ns;
+
+    // The burst is at most a second's worth, so a longer idle spell can't
+    // bank more than one second of refill
+    elapsed = std::min(elapsed, TAWQA_NS_PER_SEC);
+
+    // Split the rate so elapsed * rate can't overflow for elapsed <= 1s
+    std::uint64_t whole = elapsed * (bucket->rate / TAWQA_NS_PER_SEC);
+    std::uint64_t part = elapsed * (bucket->rate % TAWQA_NS_PER_SEC) + bucket->frac;
+    bucket->tokens += whole + part / TAWQA_NS_PER_SEC;
+    bucket->frac = part % TAWQA_NS_PER_SEC;
+    if (bucket->tokens >= bucket->burst) {
+        bucket->tokens = bucket->burst;
+        bucket->frac = 0;
+    }
+
+    if (bucket->tokens < bucket->quantum && bucket->tokens < want) {
+        return 0;
+    }
+    return static_cast<std::size_t>(std::min<std::uint64_t>(want, bucket->tokens));
+}
+
+void tawqa_bucket_consume(tawqa_bucket* bucket, std::size_t used) {
+    if (bucket->rate == 0) {
+        return;
+    }
+    bucket->tokens = (used >= bucket->tokens) ? 0 : bucket->tokens - used;
+}
+
+std::uint64_t tawqa_bucket_delay_ns(const tawqa_bucket* bucket) {
+    if (bucket->rate == 0 || bucket->tokens >= bucket->quantum) {
+        return 0;
+    }
+
+    // The quantum is at most one chunk, so this product stays small
+    std::uint64_t missing = (bucket->quantum - bucket->tokens) * TAWQA_NS_PER_SEC;
+    if (missing <= bucket->frac) {
+        return 1;
+    }
+    missing -= bucket->frac;
+    return (missing + bucket->rate - 1) / bucket->rate;
+}
+
+bool tawqa_rate_set_pacing(int fd, std::uint64_t rate) {
+#ifdef SO_MAX_PACING_RATE
+    // Newer kernels take a 64-bit rate, older ones only 32 bits
+    if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) == 0) {
+        return true;
+    }
+    std::uint32_t rate32 = static_cast<std::uint32_t>(
+        std::min<std::uint64_t>(rate, UINT32_MAX - 1));
+    return setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate32, sizeof(rate32)) == 0;
+#else
+    (void)fd;
+    (void)rate;
+    return false;
+#endif
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef TAWQA_RATE_HH_INCLUDED
+#define TAWQA_RATE_HH_INCLUDED
+
+// TAWQA Rate Limiting Header
+// Token bucket used to cap per-direction throughput
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstdint>
+#include <cstddef>
+
+// Token bucket state (C-style, no OOP). A zero rate means unlimited.
+struct tawqa_bucket {
+    std::uint64_t rate;      // bytes per second
+    std::uint64_t burst;     // bucket depth in bytes
+    std::uint64_t quantum;   // smallest grant worth a syscall
+    std::uint64_t tokens;    // bytes that may be moved right now
+    std::uint64_t frac;      // sub-byte refill remainder, in byte*ns units
+    std::uint64_t last_ns;   // time of the last refill
+};
+
+// Parse "10G", "500Mb", "64k": K/M/G are powers of 1000, a trailing
+// lowercase 'b' means bits. Returns bytes per second, 0 on bad input.
+std::uint64_t tawqa_parse_rate(const char* str);
+
+// Parse "4M", "64K", "1G", "512B": K/M/G are powers of 1024, as sizes of
+// buffers and files are. Returns bytes, 0 on bad input.
+std::uint64_t tawqa_parse_size(const char* str);
+
+void tawqa_bucket_init(tawqa_bucket* bucket, std::uint64_t rate, std::size_t chunk);
+
+// Refill from the clock and return how many of `want` bytes may go now;
+// returns 0 while fewer than a quantum of tokens are banked
+std::size_t tawqa_bucket_grant(tawqa_bucket* bucket, std::size_t want, std::uint64_t now_ns);
+
+void tawqa_bucket_consume(tawqa_bucket* bucket, std::size_t used);
+
+// Nanoseconds until the next quantum is available (0 if already)
+std::uint64_t tawqa_bucket_delay_ns(const tawqa_bucket* bucket);
+
+// Ask the kernel to pace the socket at `rate` bytes per second
+bool tawqa_rate_set_pacing(int fd, std::uint64_t rate);
+
+#endif // TAWQA_RATE_HH_INCLUDED
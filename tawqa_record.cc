@@ -0,0 +1,259 @@
+// TAWQA Session Record Implementation
+// Buffered capture in the relay thread, mmap'd replay feeder, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_record.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_netio.hh"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static_assert(sizeof(tawqa_rec_header) == 16 && sizeof(tawqa_rec_chunk) == 16 &&
+                  sizeof(tawqa_rec_footer) == 24,
+              "record layout is a file format");
+
+constexpr std::size_t TAWQA_REC_BUFSIZ = 1024 * 1024;
+constexpr char TAWQA_REC_MAGIC[8] = {'T', 'W', 'Q', 'A', 'R', 'E', 'C', '1'};
+constexpr char TAWQA_REC_IDX_MAGIC[8] = {'T', 'W', 'Q', 'A', 'I', 'D', 'X', '1'};
+
+static int g_rec_fd = -1;
+static bool g_rec_listener = false;
+static std::uint64_t g_rec_t0 = 0;
+static std::uint64_t g_rec_offset = 0;        // file offset of g_rec_buf[0]
+static std::size_t g_rec_used = 0;
+static std::vector<std::uint64_t> g_rec_index;
+static std::array<char, TAWQA_REC_BUFSIZ> g_rec_buf;
+
+// Give up on the file first so the exit hook doesn't write to it again
+static void tawqa_record_fail() {
+    close(g_rec_fd);
+    g_rec_fd = -1;
+    tawqa_bail("Write to record file failed");
+}
+
+static void tawqa_record_flush() {
+    if (g_rec_used && tawqa_writen(g_rec_fd, g_rec_buf.data(), g_rec_used) != g_rec_used) {
+        tawqa_record_fail();
+    }
+    g_rec_offset += g_rec_used;
+    g_rec_used = 0;
+}
+
+static void tawqa_record_append(const void* data, std::size_t len) {
+    if (g_rec_used + len > g_rec_buf.size()) {
+        tawqa_record_flush();
+    }
+    // Oversized payloads skip the buffer
+    if (len > g_rec_buf.size()) {
+        if (tawqa_writen(g_rec_fd, data, len) != len) {
+            tawqa_record_fail();
+        }
+        g_rec_offset += len;
+        return;
+    }
+    std::memcpy(g_rec_buf.data() + g_rec_used, data, len);
+    g_rec_used += len;
+}
+
+void tawqa_record_start(const char* path, bool listener) {
+    g_rec_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (g_rec_fd < 0) {
+        tawqa_bail("Can't open record file %s", path);
+    }
+    g_rec_listener = listener;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    tawqa_rec_header hdr;
+    std::memcpy(hdr.magic, TAWQA_REC_MAGIC, sizeof(hdr.magic));
+    hdr.start_unix_ns = static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    tawqa_record_append(&hdr, sizeof(hdr));
+
+    // Ctrl-C leaves through exit(): write the tail and the index there too
+    std::atexit(tawqa_record_finish);
+}
+
+void tawqa_record_chunk(bool outbound, const char* buf, std::size_t len) {
+    std::uint64_t now = tawqa_now_ns();
+    if (g_rec_index.empty()) {
+        g_rec_t0 = now;
+    }
+    g_rec_index.push_back(g_rec_offset + g_rec_used);
+
+    tawqa_rec_chunk chunk = {};
+    chunk.t_ns = now - g_rec_t0;
+    chunk.len = static_cast<std::uint32_t>(len);
+    chunk.origin = outbound != g_rec_listener ? TAWQA_REC_CLIENT : TAWQA_REC_SERVER;
+    tawqa_record_append(&chunk, sizeof(chunk));
+    tawqa_record_append(buf, len);
+
+    static const char zeros[8] = {};
+    tawqa_record_append(zeros, (8 - len % 8) % 8);
+}
+
+void tawqa_record_finish() {
+    if (g_rec_fd < 0) {
+        return;
+    }
+    tawqa_rec_footer footer;
+    footer.index_offset = g_rec_offset + g_rec_used;
+    footer.count = g_rec_index.size();
+    std::memcpy(footer.magic, TAWQA_REC_IDX_MAGIC, sizeof(footer.magic));
+
+    tawqa_record_append(g_rec_index.data(), g_rec_index.size() * sizeof(std::uint64_t));
+    tawqa_record_append(&footer, sizeof(footer));
+    tawqa_record_flush();
+    close(g_rec_fd);
+    g_rec_fd = -1;
+
+    static char count_str[24];
+    std::snprintf(count_str, sizeof(count_str), "%llu", static_cast<unsigned long long>(footer.count));
+    errno = 0;
+    tawqa_holler("Recorded %s chunks", count_str);
+}
+
+// Replay state: the whole file stays mapped until the feeder is done
+static const char* g_map = nullptr;
+static std::size_t g_map_len = 0;
+static const std::uint64_t* g_index = nullptr;
+static std::uint64_t g_index_count = 0;
+static std::uint64_t g_chunks_end = 0;        // where the chunk area stops
+static std::vector<std::uint64_t> g_rebuilt_index;
+static std::thread g_replay_thread;
+static std::atomic<bool> g_replay_done{false};
+
+// A capture killed before its footer: walk the chunk headers while they
+// stay in bounds and in time order, dropping a torn last chunk
+static void tawqa_replay_rebuild_index() {
+    std::uint64_t off = sizeof(tawqa_rec_header);
+    std::uint64_t last_t = 0;
+    while (off + sizeof(tawqa_rec_chunk) <= g_map_len) {
+        const auto* chunk = reinterpret_cast<const tawqa_rec_chunk*>(g_map + off);
+        std::uint64_t next = off + sizeof(tawqa_rec_chunk) + (chunk->len + 7ULL) / 8 * 8;
+        if (chunk->origin > TAWQA_REC_SERVER || chunk->t_ns < last_t ||
+            off + sizeof(tawqa_rec_chunk) + chunk->len > g_map_len) {
+            break;
+        }
+        g_rebuilt_index.push_back(off);
+        last_t = chunk->t_ns;
+        off = std::min<std::uint64_t>(next, g_map_len);
+    }
+    g_index = g_rebuilt_index.data();
+    g_index_count = g_rebuilt_index.size();
+    g_chunks_end = g_map_len;
+}
+
+static void tawqa_replay_loop(int pipe_fd, double speed) {
+    std::uint64_t base = tawqa_now_ns();
+
+    for (std::uint64_t i = 0; i < g_index_count; ++i) {
+        if (g_index[i] + sizeof(tawqa_rec_chunk) > g_chunks_end) {
+            break;
+        }
+        const auto* chunk = reinterpret_cast<const tawqa_rec_chunk*>(g_map + g_index[i]);
+        if (g_index[i] + sizeof(tawqa_rec_chunk) + chunk->len > g_chunks_end) {
+            break;
+        }
+        if (chunk->origin != TAWQA_REC_CLIENT) {
+            continue;
+        }
+        if (speed > 0) {
+            std::uint64_t due = base + static_cast<std::uint64_t>(static_cast<double>(chunk->t_ns) / speed);
+            struct timespec ts = {static_cast<time_t>(due / 1000000000ULL),
+                                  static_cast<long>(due % 1000000000ULL)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+            }
+        }
+        const char* payload = reinterpret_cast<const char*>(chunk + 1);
+        if (tawqa_writen(pipe_fd, payload, chunk->len) != chunk->len) {
+            break; // relay is gone
+        }
+    }
+    close(pipe_fd);
+    g_replay_done = true;
+}
+
+void tawqa_replay_open(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        tawqa_bail("Can't open record file %s", path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<std::size_t>(st.st_size) < sizeof(tawqa_rec_header)) {
+        tawqa_bail("%s is not a tawqa recording", path);
+    }
+    g_map_len = static_cast<std::size_t>(st.st_size);
+    void* map = mmap(nullptr, g_map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        tawqa_bail("Can't map %s", path);
+    }
+    g_map = static_cast<const char*>(map);
+    madvise(map, g_map_len, MADV_SEQUENTIAL);
+
+    // Only the ends are checked; the index makes the chunks addressable
+    if (std::memcmp(g_map, TAWQA_REC_MAGIC, sizeof(TAWQA_REC_MAGIC)) != 0) {
+        tawqa_bail("%s is not a tawqa recording", path);
+    }
+    const tawqa_rec_footer* footer = nullptr;
+    if (g_map_len >= sizeof(tawqa_rec_header) + sizeof(tawqa_rec_footer)) {
+        footer = reinterpret_cast<const tawqa_rec_footer*>(g_map + g_map_len - sizeof(tawqa_rec_footer));
+    }
+    if (footer && std::memcmp(footer->magic, TAWQA_REC_IDX_MAGIC, sizeof(TAWQA_REC_IDX_MAGIC)) == 0 &&
+        footer->index_offset + footer->count * sizeof(std::uint64_t) + sizeof(tawqa_rec_footer) == g_map_len) {
+        g_index = reinterpret_cast<const std::uint64_t*>(g_map + footer->index_offset);
+        g_index_count = footer->count;
+        g_chunks_end = footer->index_offset;
+    } else {
+        tawqa_replay_rebuild_index();
+        static char count_str[24];
+        std::snprintf(count_str, sizeof(count_str), "%llu", static_cast<unsigned long long>(g_index_count));
+        errno = 0;
+        tawqa_holler("%s has no index, found %s chunks", path, count_str);
+    }
+}
+
+// Detached at exit: a feeder asleep until its next chunk can't be joined
+static void tawqa_replay_exit() {
+    if (g_replay_thread.joinable()) {
+        g_replay_thread.detach();
+    }
+}
+
+int tawqa_replay_start(double speed) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        tawqa_bail("Can't create replay pipe");
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    sigset_t saved;
+    tawqa_signals_block(&saved);
+    g_replay_thread = std::thread(tawqa_replay_loop, fds[1], speed);
+    tawqa_signals_restore(&saved);
+    std::atexit(tawqa_replay_exit);
+    return fds[0];
+}
+
+void tawqa_replay_finish(int relay_in) {
+    close(relay_in);
+    // The feeder may be asleep until a far-off chunk is due
+    if (g_replay_done) {
+        g_replay_thread.join();
+        munmap(const_cast<char*>(g_map), g_map_len);
+    } else {
+        g_replay_thread.detach();
+    }
+}
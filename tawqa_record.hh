@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef TAWQA_RECORD_HH_INCLUDED
+#define TAWQA_RECORD_HH_INCLUDED
+
+// TAWQA Session Record Header
+// Timestamped capture of both directions and timed client replay
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstddef>
+#include <cstdint>
+
+// File layout, host byte order:
+//   tawqa_rec_header
+//   { tawqa_rec_chunk, payload padded to 8 bytes } ...
+//   uint64 file offset of every chunk
+//   tawqa_rec_footer
+// Chunk headers stay 8-byte aligned so replay reads them straight from
+// the mapping.
+struct tawqa_rec_header {
+    char magic[8];             // "TWQAREC1"
+    std::uint64_t start_unix_ns;
+};
+
+struct tawqa_rec_chunk {
+    std::uint64_t t_ns;        // since the first chunk
+    std::uint32_t len;
+    std::uint8_t origin;       // TAWQA_REC_CLIENT or TAWQA_REC_SERVER
+    std::uint8_t pad[3];
+};
+
+struct tawqa_rec_footer {
+    std::uint64_t index_offset;
+    std::uint64_t count;
+    char magic[8];             // "TWQAIDX1"
+};
+
+constexpr std::uint8_t TAWQA_REC_CLIENT = 0;
+constexpr std::uint8_t TAWQA_REC_SERVER = 1;
+
+// Capture to `path`; `listener` decides which side sent what
+void tawqa_record_start(const char* path, bool listener);
+
+// One chunk as it crossed the wire, `outbound` if we sent it
+void tawqa_record_chunk(bool outbound, const char* buf, std::size_t len);
+
+// Flush and append the index. Also runs from exit(), a second call does
+// nothing.
+void tawqa_record_finish();
+
+// Map and check `path` before anything connects. A recording cut off
+// before its index is walked chunk by chunk instead.
+void tawqa_replay_open(const char* path);
+
+// Feed the client chunks through a pipe at the recorded pace divided by
+// `speed` (0: as fast as possible). Returns the fd the relay reads in
+// place of stdin.
+int tawqa_replay_start(double speed);
+
+// Close the relay end and stop the feeder
+void tawqa_replay_finish(int relay_in);
+
+#endif // TAWQA_RECORD_HH_INCLUDED
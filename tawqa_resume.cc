@@ -0,0 +1,170 @@
+// TAWQA Resumable Transfer Implementation
+// Checkpoint file with batched fsync, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_resume.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_netio.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Checkpoint and offer share one 12-byte record: ['TWQR'][u64 offset]
+constexpr unsigned char TAWQA_RESUME_MAGIC[4] = {'T', 'W', 'Q', 'R'};
+constexpr std::size_t TAWQA_RESUME_RECORD = 12;
+constexpr std::uint64_t TAWQA_RESUME_SYNC_BYTES = 64ULL * 1024 * 1024;
+constexpr std::uint64_t TAWQA_RESUME_SYNC_NS = 1000000000ULL;
+
+// Receiver progress
+static int g_ckpt_fd = -1;
+static int g_out_fd = -1;
+static std::uint64_t g_written = 0;     // offset of the end of output
+static std::uint64_t g_committed = 0;   // offset known to be on disk
+static std::uint64_t g_last_sync_ns = 0;
+
+static void tawqa_resume_record(unsigned char* rec, std::uint64_t offset) {
+    std::memcpy(rec, TAWQA_RESUME_MAGIC, sizeof(TAWQA_RESUME_MAGIC));
+    tawqa_put_be64(rec + 4, offset);
+}
+
+static bool tawqa_resume_parse(const unsigned char* rec, std::uint64_t* offset) {
+    if (std::memcmp(rec, TAWQA_RESUME_MAGIC, sizeof(TAWQA_RESUME_MAGIC)) != 0) {
+        return false;
+    }
+    *offset = tawqa_get_be64(rec + 4);
+    return true;
+}
+
+// Data first, then the checkpoint that claims it
+static void tawqa_resume_commit() {
+    if (g_written == g_committed) {
+        return;
+    }
+    if (fdatasync(g_out_fd) < 0) {
+        tawqa_bail("fdatasync on output failed");
+    }
+
+    unsigned char rec[TAWQA_RESUME_RECORD];
+    tawqa_resume_record(rec, g_written);
+    if (pwrite(g_ckpt_fd, rec, sizeof(rec), 0) != static_cast<ssize_t>(sizeof(rec)) ||
+        fdatasync(g_ckpt_fd) < 0) {
+        tawqa_bail("Can't write checkpoint");
+    }
+    g_committed = g_written;
+}
+
+std::uint64_t tawqa_resume_open(const char* ckpt_path, int out_fd) {
+    struct stat st;
+    if (fstat(out_fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        tawqa_bail("Resume needs stdout redirected to a regular file");
+    }
+
+    g_ckpt_fd = open(ckpt_path, O_RDWR | O_CREAT, 0644);
+    if (g_ckpt_fd < 0) {
+        tawqa_bail("Can't open checkpoint %s", ckpt_path);
+    }
+
+    std::uint64_t offset = 0;
+    unsigned char rec[TAWQA_RESUME_RECORD];
+    ssize_t n = pread(g_ckpt_fd, rec, sizeof(rec), 0);
+    if (n == static_cast<ssize_t>(sizeof(rec))) {
+        if (!tawqa_resume_parse(rec, &offset)) {
+            tawqa_bail("%s is not a tawqa checkpoint", ckpt_path);
+        }
+    } else if (n != 0) {
+        tawqa_bail("Can't read checkpoint %s", ckpt_path);
+    }
+
+    // Anything past the checkpoint was never known to be durable. An empty
+    // file is almost always "> file" having truncated it before we ran.
+    if (static_cast<std::uint64_t>(st.st_size) < offset) {
+        if (st.st_size == 0) {
+            tawqa_bail("Output is empty but %s has progress; '>' truncates it, redirect with '>>' or '1<>'",
+                       ckpt_path);
+        }
+        tawqa_bail("Output is shorter than checkpoint %s", ckpt_path);
+    }
+    if (ftruncate(out_fd, static_cast<off_t>(offset)) < 0 ||
+        lseek(out_fd, static_cast<off_t>(offset), SEEK_SET) < 0) {
+        tawqa_bail("Can't position output at the checkpoint");
+    }
+
+    g_out_fd = out_fd;
+    g_written = g_committed = offset;
+    g_last_sync_ns = tawqa_now_ns();
+    return offset;
+}
+
+void tawqa_resume_offer(int netfd, std::uint64_t offset) {
+    unsigned char rec[TAWQA_RESUME_RECORD];
+    tawqa_resume_record(rec, offset);
+    if (tawqa_writen(netfd, rec, sizeof(rec)) != sizeof(rec)) {
+        tawqa_bail("Can't send resume offset");
+    }
+}
+
+void tawqa_resume_advance(std::size_t bytes) {
+    g_written += bytes;
+    if (g_written - g_committed < TAWQA_RESUME_SYNC_BYTES) {
+        std::uint64_t now = tawqa_now_ns();
+        if (now - g_last_sync_ns < TAWQA_RESUME_SYNC_NS) {
+            return;
+        }
+        g_last_sync_ns = now;
+    } else {
+        g_last_sync_ns = tawqa_now_ns();
+    }
+    tawqa_resume_commit();
+}
+
+void tawqa_resume_close() {
+    if (g_ckpt_fd < 0) {
+        return;
+    }
+    tawqa_resume_commit();
+    close(g_ckpt_fd);
+    g_ckpt_fd = -1;
+
+    char num[24];
+    std::snprintf(num, sizeof(num), "%llu", static_cast<unsigned long long>(g_committed));
+    errno = 0;
+    tawqa_holler("Checkpoint committed at offset %s", num);
+}
+
+std::uint64_t tawqa_resume_accept(int netfd, int in_fd) {
+    unsigned char rec[TAWQA_RESUME_RECORD];
+    std::uint64_t offset = 0;
+
+    if (tawqa_readn(netfd, rec, sizeof(rec)) != sizeof(rec) ||
+        !tawqa_resume_parse(rec, &offset)) {
+        tawqa_bail("Peer did not offer a resume offset");
+    }
+    if (offset == 0) {
+        return 0;
+    }
+
+    // Pipes can't seek, so replay-and-discard up to the offset instead
+    if (lseek(in_fd, static_cast<off_t>(offset), SEEK_SET) < 0) {
+        std::vector<char> scratch(TAWQA_BUFFER_SIZE * 8);
+        std::uint64_t left = offset;
+        while (left) {
+            std::size_t chunk = std::min<std::uint64_t>(left, scratch.size());
+            std::size_t n = tawqa_readn(in_fd, scratch.data(), chunk);
+            if (n == 0) {
+                tawqa_bail("Input ends before the resume offset");
+            }
+            left -= n;
+        }
+    }
+
+    char num[24];
+    std::snprintf(num, sizeof(num), "%llu", static_cast<unsigned long long>(offset));
+    errno = 0;
+    tawqa_holler("Resuming at offset %s", num);
+    return offset;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#ifndef TAWQA_RESUME_HH_INCLUDED
+#define TAWQA_RESUME_HH_INCLUDED
+
+// TAWQA Resumable Transfer Header
+// Durable receiver checkpoints and offset negotiation
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstdint>
+#include <cstddef>
+
+// Listening side: load `ckpt_path`, cut `out_fd` (a regular file) back to
+// the last committed offset and position it there. Returns the offset.
+// The file must be opened without truncation, ">>" or "1<>" in the shell.
+std::uint64_t tawqa_resume_open(const char* ckpt_path, int out_fd);
+
+// Listening side: tell the sender where to continue from
+void tawqa_resume_offer(int netfd, std::uint64_t offset);
+
+// Listening side: account bytes written to `out_fd`; syncs the data and
+// then the checkpoint in batches so durability costs stay amortized
+void tawqa_resume_advance(std::size_t bytes);
+
+// Listening side: final sync and checkpoint
+void tawqa_resume_close();
+
+// Connecting side: read the receiver's offset and skip `in_fd` past it,
+// by seeking when possible and by discarding input otherwise
+std::uint64_t tawqa_resume_accept(int netfd, int in_fd);
+
+#endif // TAWQA_RESUME_HH_INCLUDED
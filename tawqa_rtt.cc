@@ -0,0 +1,351 @@
+// TAWQA Round-Trip Implementation
+// Level-triggered echo loop and a blocking ping-pong client, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_rtt.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_hist.hh"
+#include "tawqa_metrics.hh"
+#include "tawqa_netio.hh"
+#include "tawqa_rate.hh"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+constexpr std::size_t TAWQA_ECHO_BUF = 64 * 1024;
+constexpr int TAWQA_ECHO_EVENTS = 256;
+constexpr std::size_t TAWQA_RTT_MAX_SIZE = 16 * 1024 * 1024;
+
+// One echo client: buf[off, len) is still owed back to the peer
+struct tawqa_echo_conn {
+    int fd;
+    std::size_t off;
+    std::size_t len;
+    tawqa_metrics_conn* metrics;
+    char buf[TAWQA_ECHO_BUF];
+};
+
+static char g_echo_listen_tag;
+static tawqa_metrics_shard* g_echo_metrics = nullptr;
+
+static void tawqa_echo_watch(int epfd, tawqa_echo_conn* conn, int op) {
+    // Stop reading while a reply is pending so a client that never
+    // reads can't make us buffer without bound
+    struct epoll_event ev = {};
+    ev.events = conn->off < conn->len ? EPOLLOUT : EPOLLIN;
+    ev.data.ptr = conn;
+    epoll_ctl(epfd, op, conn->fd, &ev);
+}
+
+static void tawqa_echo_accept(int listenfd, const tawqa_sockopts* opts, int epfd) {
+    while (true) {
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept4(listenfd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                tawqa_holler("accept failed");
+            }
+            return;
+        }
+        auto* conn = static_cast<tawqa_echo_conn*>(std::malloc(sizeof(tawqa_echo_conn)));
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->off = 0;
+        conn->len = 0;
+
+        // Replies go out as soon as they're read
+        bool tcp = addr.ss_family == AF_INET;
+        tawqa_sockopt_apply(fd, opts, tcp);
+        if (tcp) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        tawqa_echo_watch(epfd, conn, EPOLL_CTL_ADD);
+
+        char peer[32] = "local";
+        if (tcp) {
+            const auto* sin = reinterpret_cast<const struct sockaddr_in*>(&addr);
+            std::snprintf(peer, sizeof(peer), "%s:%u", inet_ntoa(sin->sin_addr), ntohs(sin->sin_port));
+            errno = 0;
+            tawqa_holler("Echoing %s", peer);
+        }
+        conn->metrics = tawqa_metrics_open(g_echo_metrics, peer);
+    }
+}
+
+// False once the client is gone
+static bool tawqa_echo_serve(tawqa_echo_conn* conn) {
+    if (conn->off == conn->len) {
+        ssize_t n = recv(conn->fd, conn->buf, sizeof(conn->buf), 0);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        if (n == 0) {
+            return false;
+        }
+        conn->off = 0;
+        conn->len = static_cast<std::size_t>(n);
+        tawqa_metrics_in(g_echo_metrics, conn->metrics, conn->len);
+    }
+    while (conn->off < conn->len) {
+        ssize_t n = send(conn->fd, conn->buf + conn->off, conn->len - conn->off, MSG_NOSIGNAL);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        conn->off += static_cast<std::size_t>(n);
+        tawqa_metrics_out(g_echo_metrics, conn->metrics, static_cast<std::uint64_t>(n));
+    }
+    return true;
+}
+
+void tawqa_echo_run(int listenfd, const tawqa_sockopts* opts) {
+    g_echo_metrics = tawqa_metrics_shard_new();
+    fcntl(listenfd, F_SETFL, fcntl(listenfd, F_GETFL) | O_NONBLOCK);
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        tawqa_bail("epoll_create1 failed");
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &g_echo_listen_tag;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &ev);
+
+    struct epoll_event events[TAWQA_ECHO_EVENTS];
+    while (true) {
+        int n = epoll_wait(epfd, events, TAWQA_ECHO_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            tawqa_bail("epoll_wait failed");
+        }
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.ptr == &g_echo_listen_tag) {
+                tawqa_echo_accept(listenfd, opts, epfd);
+                continue;
+            }
+            auto* conn = static_cast<tawqa_echo_conn*>(events[i].data.ptr);
+            bool pending = conn->off < conn->len;
+            if (!tawqa_echo_serve(conn)) {
+                tawqa_metrics_close(g_echo_metrics, conn->metrics);
+                close(conn->fd);
+                std::free(conn);
+                continue;
+            }
+            if (pending != (conn->off < conn->len)) {
+                tawqa_echo_watch(epfd, conn, EPOLL_CTL_MOD);
+            }
+        }
+    }
+}
+
+static std::uint64_t tawqa_rtt_raw_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+static std::uint64_t tawqa_rtt_ts_ns(const struct timespec* ts) {
+    return static_cast<std::uint64_t>(ts->tv_sec) * 1000000000ULL + ts->tv_nsec;
+}
+
+// Software stamp from a control message block, 0 if none
+static std::uint64_t tawqa_rtt_cmsg_stamp(struct msghdr* msg) {
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(msg); c; c = CMSG_NXTHDR(msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING) {
+            const auto* stamps = reinterpret_cast<const struct scm_timestamping*>(CMSG_DATA(c));
+            return tawqa_rtt_ts_ns(&stamps->ts[0]);
+        }
+    }
+    return 0;
+}
+
+// Latest transmit stamp waiting on the error queue, 0 if none
+static std::uint64_t tawqa_rtt_tx_stamp(int fd) {
+    std::uint64_t stamp = 0;
+    while (true) {
+        char control[256];
+        struct msghdr msg = {};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+        if (std::uint64_t s = tawqa_rtt_cmsg_stamp(&msg)) {
+            stamp = s;
+        }
+    }
+    errno = 0;
+    return stamp;
+}
+
+// One read into buf[0, len), keeping its receive stamp
+static ssize_t tawqa_rtt_recv_once(int fd, char* buf, std::size_t len, int flags, std::uint64_t* rx_stamp) {
+    char control[256];
+    struct iovec iov = {buf, len};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = recvmsg(fd, &msg, flags);
+    if (n > 0) {
+        *rx_stamp = tawqa_rtt_cmsg_stamp(&msg);
+    }
+    return n;
+}
+
+// Send `len` bytes and read as many back. Small messages go out in one
+// send; once the send buffer fills, the echo is blocked on its own reply
+// and we must drain that reply while the rest goes out.
+static bool tawqa_rtt_exchange(int fd, const char* out, char* in, std::size_t len, std::uint64_t* rx_stamp) {
+    std::size_t sent = 0;
+    std::size_t done = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, out + sent, len - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<std::size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return false;
+        }
+        struct pollfd pfd = {fd, POLLIN | POLLOUT, 0};
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            return false;
+        }
+        // Transmit stamps of the earlier pieces; only the last one counts
+        if (pfd.revents & POLLERR) {
+            tawqa_rtt_tx_stamp(fd);
+        }
+        if (pfd.revents & (POLLIN | POLLHUP)) {
+            n = tawqa_rtt_recv_once(fd, in + done, len - done, MSG_DONTWAIT, rx_stamp);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                return false;
+            }
+            done += n > 0 ? static_cast<std::size_t>(n) : 0;
+        }
+    }
+    while (done < len) {
+        ssize_t n = tawqa_rtt_recv_once(fd, in + done, len - done, 0, rx_stamp);
+        if (n < 0 && errno == EINTR) {
+            tawqa_check_interrupt();
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// "64", "64,1K" and doubling ranges "64-64K", in order of appearance
+static std::vector<std::size_t> tawqa_rtt_sizes(const char* spec) {
+    std::vector<std::size_t> sizes;
+    std::vector<char> copy(spec, spec + std::strlen(spec) + 1);
+    char* save = nullptr;
+    for (char* tok = strtok_r(copy.data(), ",", &save); tok; tok = strtok_r(nullptr, ",", &save)) {
+        char* dash = std::strchr(tok, '-');
+        if (dash) {
+            *dash = '\0';
+        }
+        std::size_t lo = static_cast<std::size_t>(tawqa_parse_size(tok));
+        std::size_t hi = dash ? static_cast<std::size_t>(tawqa_parse_size(dash + 1)) : lo;
+        if (!lo || hi < lo || hi > TAWQA_RTT_MAX_SIZE) {
+            tawqa_bail("Invalid message size %s", spec);
+        }
+        for (std::size_t s = lo; s <= hi; s *= 2) {
+            sizes.push_back(s);
+        }
+    }
+    if (sizes.empty()) {
+        tawqa_bail("Invalid message size %s", spec);
+    }
+    return sizes;
+}
+
+void tawqa_rtt_run(int fd, const tawqa_rtt_opts* opts) {
+    std::vector<std::size_t> sizes = tawqa_rtt_sizes(opts->sizes);
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // Kernel stamps leave our own scheduling out of the measurement
+    int flags = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+                SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    bool stamps = setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0;
+    if (!stamps) {
+        tawqa_holler("SO_TIMESTAMPING unavailable, user-space clock only");
+    }
+
+    std::size_t largest = 0;
+    for (std::size_t s : sizes) {
+        largest = std::max(largest, s);
+    }
+    std::unique_ptr<char[]> out(new char[largest]);
+    std::unique_ptr<char[]> in(new char[largest]);
+    std::memset(out.get(), 'r', largest);
+
+    for (std::size_t size : sizes) {
+        std::unique_ptr<tawqa_hist> user(new tawqa_hist());
+        std::unique_ptr<tawqa_hist> kernel(new tawqa_hist());
+
+        for (std::size_t i = 0; i < opts->warmup + opts->count; ++i) {
+            std::uint64_t rx = 0;
+            std::uint64_t start = tawqa_rtt_raw_ns();
+            if (!tawqa_rtt_exchange(fd, out.get(), in.get(), size, &rx)) {
+                tawqa_bail("Echo peer went away");
+            }
+            std::uint64_t end = tawqa_rtt_raw_ns();
+            std::uint64_t tx = stamps ? tawqa_rtt_tx_stamp(fd) : 0;
+            if (i < opts->warmup) {
+                continue;
+            }
+            tawqa_hist_record(user.get(), end - start);
+            if (tx && rx > tx) {
+                tawqa_hist_record(kernel.get(), rx - tx);
+            }
+        }
+
+        static tawqa_hist_sum sum;
+        char pct[160];
+        std::memset(&sum, 0, sizeof(sum));
+        tawqa_hist_add(&sum, user.get());
+        tawqa_hist_format(&sum, pct, sizeof(pct));
+        std::printf("%8zu bytes %8zu rtts | user   %s\n", size, opts->count, pct);
+        if (stamps) {
+            std::memset(&sum, 0, sizeof(sum));
+            tawqa_hist_add(&sum, kernel.get());
+            tawqa_hist_format(&sum, pct, sizeof(pct));
+            std::printf("%8zu bytes %8llu rtts | kernel %s\n", size,
+                        static_cast<unsigned long long>(sum.total), pct);
+        }
+        std::fflush(stdout);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef TAWQA_RTT_HH_INCLUDED
+#define TAWQA_RTT_HH_INCLUDED
+
+// TAWQA Round-Trip Header
+// Echo server and ping-pong latency client
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_sockopt.hh"
+#include <cstddef>
+
+// --rtt settings (C-style, no OOP)
+struct tawqa_rtt_opts {
+    std::size_t count;         // timed round trips per message size
+    std::size_t warmup;        // untimed round trips before each size
+    const char* sizes;         // "64", "64,1K,64K" or a doubling range "64-64K"
+};
+
+// Accept clients on `listenfd` forever and send back whatever they send
+[[noreturn]] void tawqa_echo_run(int listenfd, const tawqa_sockopts* opts);
+
+// Ping-pong fixed-size messages on a connected `fd` against an echo
+// server and print RTT percentiles per size, from CLOCK_MONOTONIC_RAW
+// and, where the kernel offers them, SO_TIMESTAMPING software stamps
+void tawqa_rtt_run(int fd, const tawqa_rtt_opts* opts);
+
+#endif // TAWQA_RTT_HH_INCLUDED
@@ -0,0 +1,214 @@
+// TAWQA File Sink Implementation
+// Pipe -> aligned double buffer -> O_DIRECT writer thread, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_sink.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_netio.hh"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+constexpr std::size_t TAWQA_SINK_BUFSIZ = 4 * 1024 * 1024;
+constexpr std::size_t TAWQA_SINK_ALIGN = 4096;       // covers 512e and 4Kn drives
+constexpr std::uint64_t TAWQA_SINK_EXTENT = 64 * 1024 * 1024;
+constexpr int TAWQA_SINK_PIPE_SIZE = 1024 * 1024;
+constexpr std::size_t TAWQA_SINK_END = ~static_cast<std::size_t>(0);
+
+// Each buffer holds 0 (free), a fill length, or END after the last one
+static char* g_buf[2];
+static std::atomic<std::size_t> g_len[2];
+
+static int g_fd = -1;
+static int g_relay_fd = -1;
+static bool g_direct = false;
+static const char* g_path = nullptr;
+static std::uint64_t g_alloc_end = 0;
+static std::uint64_t g_written = 0;
+static std::uint64_t g_busy_ns = 0;
+static std::thread g_fill_thread;
+static std::thread g_write_thread;
+
+// Drain the relay pipe into whichever buffer the writer has released
+static void tawqa_sink_fill_loop(int pipe_fd) {
+    for (std::size_t k = 0;; ++k) {
+        std::atomic<std::size_t>& len = g_len[k & 1];
+        for (std::size_t v; (v = len.load(std::memory_order_acquire)) != 0;) {
+            len.wait(v, std::memory_order_acquire);
+        }
+        std::size_t n = tawqa_readn(pipe_fd, g_buf[k & 1], TAWQA_SINK_BUFSIZ);
+        len.store(n ? n : TAWQA_SINK_END, std::memory_order_release);
+        len.notify_one();
+        if (!n) {
+            break;
+        }
+    }
+    close(pipe_fd);
+}
+
+// Keep fallocate ahead of the write offset so the file lands in few extents
+static void tawqa_sink_reserve(std::uint64_t end) {
+    while (g_alloc_end && end > g_alloc_end) {
+        if (fallocate(g_fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(g_alloc_end),
+                      static_cast<off_t>(TAWQA_SINK_EXTENT)) < 0) {
+            g_alloc_end = 0; // filesystem can't, stop asking
+            return;
+        }
+        g_alloc_end += TAWQA_SINK_EXTENT;
+    }
+}
+
+static void tawqa_sink_write_loop() {
+    std::uint64_t prev_off = 0;
+    std::size_t prev_len = 0;
+
+    for (std::size_t k = 0;; ++k) {
+        std::atomic<std::size_t>& len = g_len[k & 1];
+        len.wait(0, std::memory_order_acquire);
+        std::size_t n = len.load(std::memory_order_acquire);
+        if (n == TAWQA_SINK_END) {
+            break;
+        }
+
+        // O_DIRECT wants whole blocks; the short tail is padded here and
+        // trimmed off by ftruncate at the end
+        std::size_t span = n;
+        if (g_direct) {
+            span = (n + TAWQA_SINK_ALIGN - 1) & ~(TAWQA_SINK_ALIGN - 1);
+            std::memset(g_buf[k & 1] + n, 0, span - n);
+        }
+        tawqa_sink_reserve(g_written + span);
+
+        std::uint64_t start = tawqa_now_ns();
+        std::size_t done = 0;
+        while (done < span) {
+            ssize_t w = pwrite(g_fd, g_buf[k & 1] + done, span - done,
+                               static_cast<off_t>(g_written + done));
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+            if (w <= 0) {
+                tawqa_bail("Write to %s failed", g_path);
+            }
+            done += static_cast<std::size_t>(w);
+        }
+
+        // Without O_DIRECT: start writeback on this block, wait for the
+        // previous one and drop it from the cache
+        if (!g_direct) {
+            sync_file_range(g_fd, static_cast<off_t>(g_written), static_cast<off_t>(n),
+                            SYNC_FILE_RANGE_WRITE);
+            if (prev_len) {
+                sync_file_range(g_fd, static_cast<off_t>(prev_off), static_cast<off_t>(prev_len),
+                                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                                    SYNC_FILE_RANGE_WAIT_AFTER);
+                posix_fadvise(g_fd, static_cast<off_t>(prev_off), static_cast<off_t>(prev_len),
+                              POSIX_FADV_DONTNEED);
+            }
+            prev_off = g_written;
+            prev_len = n;
+        }
+        g_busy_ns += tawqa_now_ns() - start;
+        g_written += n;
+
+        len.store(0, std::memory_order_release);
+        len.notify_one();
+    }
+}
+
+int tawqa_sink_start(const char* path, std::uint64_t prealloc) {
+    g_path = path;
+    g_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    g_direct = g_fd >= 0;
+    if (g_fd < 0 && errno == EINVAL) {
+        // tmpfs and some network filesystems refuse O_DIRECT
+        g_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (g_fd < 0) {
+        tawqa_bail("Can't open %s", path);
+    }
+
+    g_alloc_end = prealloc ? prealloc : TAWQA_SINK_EXTENT;
+    if (fallocate(g_fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(g_alloc_end)) < 0) {
+        if (prealloc) {
+            tawqa_holler("Can't preallocate %s", path);
+        }
+        g_alloc_end = 0;
+    }
+
+    for (char*& buf : g_buf) {
+        buf = static_cast<char*>(std::aligned_alloc(TAWQA_SINK_ALIGN, TAWQA_SINK_BUFSIZ));
+        if (!buf) {
+            tawqa_bail("Can't allocate sink buffers");
+        }
+    }
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        tawqa_bail("Can't create sink pipe");
+    }
+#ifdef F_SETPIPE_SZ
+    // The pipe absorbs network bursts while both buffers are busy
+    fcntl(fds[1], F_SETPIPE_SZ, TAWQA_SINK_PIPE_SIZE);
+#endif
+
+    // Ctrl-C must reach the relay, not a helper that can only detach
+    sigset_t saved;
+    tawqa_signals_block(&saved);
+    g_fill_thread = std::thread(tawqa_sink_fill_loop, fds[0]);
+    g_write_thread = std::thread(tawqa_sink_write_loop);
+    tawqa_signals_restore(&saved);
+    g_relay_fd = fds[1];
+
+    // Ctrl-C on a listener or mid-ingest leaves through exit(): flush what
+    // is buffered and trim the file there too
+    std::atexit(tawqa_sink_finish);
+    return g_relay_fd;
+}
+
+void tawqa_sink_finish() {
+    if (g_relay_fd < 0) {
+        return;
+    }
+    close(g_relay_fd);
+    g_relay_fd = -1;
+
+    // A helper that bailed can't be waited for, nor can its partner
+    std::thread::id self = std::this_thread::get_id();
+    if (self == g_fill_thread.get_id() || self == g_write_thread.get_id()) {
+        g_fill_thread.detach();
+        g_write_thread.detach();
+        return;
+    }
+    g_fill_thread.join();
+    g_write_thread.join();
+
+    // Drop the padding and any unused preallocation
+    if (ftruncate(g_fd, static_cast<off_t>(g_written)) < 0) {
+        tawqa_holler("Can't trim %s", g_path);
+    }
+    if (!g_direct) {
+        fdatasync(g_fd);
+        posix_fadvise(g_fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    close(g_fd);
+    for (char* buf : g_buf) {
+        std::free(buf);
+    }
+}
+
+void tawqa_sink_report() {
+    static char line[160];
+    double secs = static_cast<double>(g_busy_ns) / 1e9;
+    std::snprintf(line, sizeof(line), "%llu bytes, %s, %.1f MB/s while writing",
+                  static_cast<unsigned long long>(g_written),
+                  g_direct ? "O_DIRECT" : "page cache dropped behind",
+                  secs > 0 ? static_cast<double>(g_written) / 1e6 / secs : 0.0);
+    errno = 0;
+    tawqa_holler("Sink %s: %s", g_path, line);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#ifndef TAWQA_SINK_HH_INCLUDED
+#define TAWQA_SINK_HH_INCLUDED
+
+// TAWQA File Sink Header
+// Network -> disk ingest that stays out of the page cache
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstdint>
+
+// Open `path` (O_DIRECT when the filesystem allows it), reserve
+// `prealloc` bytes up front (0: grow in large extents) and start the
+// helper threads. Returns the fd the relay writes in place of stdout.
+int tawqa_sink_start(const char* path, std::uint64_t prealloc);
+
+// Close the relay end, flush the tail and trim the file to its length.
+// Also runs from exit(), a second call does nothing.
+void tawqa_sink_finish();
+
+// Bytes, mode and disk throughput for the verbose summary
+void tawqa_sink_report();
+
+#endif // TAWQA_SINK_HH_INCLUDED
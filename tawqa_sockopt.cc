@@ -0,0 +1,188 @@
+// TAWQA Socket Tuning Implementation
+// Presets and setsockopt plumbing, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_sockopt.hh"
+#include "tawqa_generic.hh"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+// Named presets; fields left at -1 keep the kernel default
+struct tawqa_sockopt_preset {
+    const char* name;
+    tawqa_sockopts opts;
+};
+
+// Presets never size buffers: an explicit SO_SNDBUF/SO_RCVBUF switches off
+// the kernel's autotuning and is capped by net.core.[rw]mem_max anyway
+static const tawqa_sockopt_preset g_presets[] = {
+    // Full segments; autotuning grows the window, bbr copes with deep queues
+    {"bulk", {-1, -1, 0, 1, -1, 60, 10, 6, -1, "bbr"}},
+    // Keystrokes go out at once, dead peers are noticed within a minute
+    {"interactive", {-1, -1, 1, 0, -1, 30, 10, 3, 30000, nullptr}},
+    // Keep the unsent queue short so fresh data is not stuck behind stale
+    {"lowlat", {-1, -1, 1, 0, 16 << 10, 10, 5, 3, 10000, nullptr}},
+};
+
+bool tawqa_sockopt_profile(const char* name, tawqa_sockopts* opts) {
+    for (const auto& preset : g_presets) {
+        if (std::strcmp(name, preset.name) != 0) {
+            continue;
+        }
+
+        // Nagle and cork pull in opposite directions, so an explicit one
+        // cancels the preset's choice of the other
+        if (opts->nodelay == 1 && opts->cork < 0) {
+            opts->cork = 0;
+        }
+        if (opts->cork == 1 && opts->nodelay < 0) {
+            opts->nodelay = 0;
+        }
+
+        const tawqa_sockopts& p = preset.opts;
+        int* fields[] = {&opts->sndbuf, &opts->rcvbuf, &opts->nodelay, &opts->cork,
+                         &opts->notsent_lowat, &opts->keepidle, &opts->keepintvl,
+                         &opts->keepcnt, &opts->user_timeout};
+        const int values[] = {p.sndbuf, p.rcvbuf, p.nodelay, p.cork, p.notsent_lowat,
+                              p.keepidle, p.keepintvl, p.keepcnt, p.user_timeout};
+        for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+            if (*fields[i] < 0) {
+                *fields[i] = values[i];
+            }
+        }
+        if (!opts->congestion) {
+            opts->congestion = p.congestion;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool tawqa_sockopt_parse_keepalive(const char* str, tawqa_sockopts* opts) {
+    int* fields[] = {&opts->keepidle, &opts->keepintvl, &opts->keepcnt};
+    const char* p = str;
+
+    for (int* field : fields) {
+        char* end = nullptr;
+        long value = std::strtol(p, &end, 10);
+        if (end == p || value < 1 || value > 32767) {
+            return false;
+        }
+        *field = static_cast<int>(value);
+        if (*end == '\0') {
+            return true;
+        }
+        if (*end != ',') {
+            return false;
+        }
+        p = end + 1;
+    }
+    return false;
+}
+
+static void tawqa_sockopt_set(int fd, int level, int name, int value, const char* what) {
+    if (value >= 0 && setsockopt(fd, level, name, &value, sizeof(value)) == -1) {
+        tawqa_holler("setsockopt %s failed", what);
+    }
+}
+
+// Linux reports twice the size it granted; less than asked means the
+// request hit net.core.wmem_max or rmem_max
+static void tawqa_sockopt_set_buf(int fd, int name, int value, const char* what, const char* sysctl) {
+    if (value < 0) {
+        return;
+    }
+    tawqa_sockopt_set(fd, SOL_SOCKET, name, value, what);
+#ifdef __linux__
+    int got = 0;
+    socklen_t len = sizeof(got);
+    if (getsockopt(fd, SOL_SOCKET, name, &got, &len) == 0 && got / 2 < value) {
+        char num[16];
+        std::snprintf(num, sizeof(num), "%d", got / 2);
+        errno = 0;
+        tawqa_holler("%s capped at %s bytes by %s", what, num, sysctl);
+    }
+#else
+    (void)sysctl;
+#endif
+}
+
+void tawqa_sockopt_apply(int fd, const tawqa_sockopts* opts, bool tcp) {
+    tawqa_sockopt_set_buf(fd, SO_SNDBUF, opts->sndbuf, "SO_SNDBUF", "net.core.wmem_max");
+    tawqa_sockopt_set_buf(fd, SO_RCVBUF, opts->rcvbuf, "SO_RCVBUF", "net.core.rmem_max");
+
+    if (!tcp) {
+        return;
+    }
+
+    tawqa_sockopt_set(fd, IPPROTO_TCP, TCP_NODELAY, opts->nodelay, "TCP_NODELAY");
+#ifdef TCP_CORK
+    tawqa_sockopt_set(fd, IPPROTO_TCP, TCP_CORK, opts->cork, "TCP_CORK");
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+    tawqa_sockopt_set(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, opts->notsent_lowat, "TCP_NOTSENT_LOWAT");
+#endif
+    if (opts->keepidle >= 0) {
+        tawqa_sockopt_set(fd, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+#ifdef TCP_KEEPIDLE
+        tawqa_sockopt_set(fd, IPPROTO_TCP, TCP_KEEPIDLE, opts->keepidle, "TCP_KEEPIDLE");
+#endif
+        tawqa_sockopt_set(fd, IPPROTO_TCP, TCP_KEEPINTVL, opts->keepintvl, "TCP_KEEPINTVL");
+        tawqa_sockopt_set(fd, IPPROTO_TCP, TCP_KEEPCNT, opts->keepcnt, "TCP_KEEPCNT");
+    }
+#ifdef TCP_USER_TIMEOUT
+    tawqa_sockopt_set(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, opts->user_timeout, "TCP_USER_TIMEOUT");
+#endif
+#ifdef TCP_CONGESTION
+    // Unloaded algorithms fail with ENOENT; the default stays in place
+    if (opts->congestion &&
+        setsockopt(fd, IPPROTO_TCP, TCP_CONGESTION, opts->congestion,
+                   static_cast<socklen_t>(std::strlen(opts->congestion))) == -1) {
+        tawqa_holler("TCP_CONGESTION %s unavailable", opts->congestion);
+    }
+#endif
+}
+
+bool tawqa_sockopt_fastopen_listen(int fd, int qlen) {
+#ifdef TCP_FASTOPEN
+    return setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen)) == 0;
+#else
+    (void)fd;
+    (void)qlen;
+    return false;
+#endif
+}
+
+bool tawqa_sockopt_fastopen_connect(int fd) {
+#ifdef TCP_FASTOPEN_CONNECT
+    // connect() returns at once; errors surface on the first read or write
+    int one = 1;
+    return setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &one, sizeof(one)) == 0;
+#else
+    (void)fd;
+    return false;
+#endif
+}
+
+void tawqa_sockopt_fastopen_report(int fd) {
+#if defined(TCP_INFO) && defined(TCPI_OPT_SYN_DATA)
+    struct tcp_info info = {};
+    socklen_t len = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0) {
+        return;
+    }
+    errno = 0;
+    if (info.tcpi_options & TCPI_OPT_SYN_DATA) {
+        tawqa_holler("TCP Fast Open: data carried in the SYN");
+    } else {
+        tawqa_holler("TCP Fast Open: no cookie used, full handshake");
+    }
+#else
+    (void)fd;
+#endif
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#ifndef TAWQA_SOCKOPT_HH_INCLUDED
+#define TAWQA_SOCKOPT_HH_INCLUDED
+
+// TAWQA Socket Tuning Header
+// Buffer, Nagle, cork, keepalive and congestion control knobs
+// Using TAWQA prefix to avoid naming conflicts
+
+// Requested socket options (C-style, no OOP). -1 / nullptr leave the
+// kernel default alone.
+struct tawqa_sockopts {
+    int sndbuf;          // SO_SNDBUF bytes
+    int rcvbuf;          // SO_RCVBUF bytes
+    int nodelay;         // TCP_NODELAY 0/1
+    int cork;            // TCP_CORK 0/1
+    int notsent_lowat;   // TCP_NOTSENT_LOWAT bytes
+    int keepidle;        // TCP_KEEPIDLE secs, enables SO_KEEPALIVE
+    int keepintvl;       // TCP_KEEPINTVL secs
+    int keepcnt;         // TCP_KEEPCNT probes
+    int user_timeout;    // TCP_USER_TIMEOUT ms
+    const char* congestion;  // TCP_CONGESTION algorithm name
+};
+
+constexpr tawqa_sockopts TAWQA_SOCKOPTS_UNSET = {-1, -1, -1, -1, -1, -1, -1, -1, -1, nullptr};
+
+// Fill the still-unset fields from a preset: bulk, interactive or lowlat.
+// Explicit options win regardless of their order on the command line.
+bool tawqa_sockopt_profile(const char* name, tawqa_sockopts* opts);
+
+// Parse "idle[,intvl[,cnt]]" for --keepalive
+bool tawqa_sockopt_parse_keepalive(const char* str, tawqa_sockopts* opts);
+
+// Apply before connect/listen so buffer sizes shape the window scale;
+// TCP-level options are skipped for datagram sockets
+void tawqa_sockopt_apply(int fd, const tawqa_sockopts* opts, bool tcp);
+
+// TCP Fast Open: the listener accepts data in the SYN, the connecting
+// side defers the handshake so the first write rides in the SYN
+bool tawqa_sockopt_fastopen_listen(int fd, int qlen);
+bool tawqa_sockopt_fastopen_connect(int fd);
+
+// Verbose note on whether SYN data was acknowledged on this connection
+void tawqa_sockopt_fastopen_report(int fd);
+
+#endif // TAWQA_SOCKOPT_HH_INCLUDED
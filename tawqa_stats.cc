@@ -0,0 +1,175 @@
+// TAWQA Transfer Statistics Implementation
+// Written by the relay thread only, SIGUSR1 just raises a flag, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_stats.hh"
+#include "tawqa_generic.hh"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <signal.h>
+
+struct tawqa_stats_side {
+    std::atomic<std::uint64_t> bytes;
+    std::atomic<std::uint64_t> reads;
+    std::atomic<std::uint64_t> writes;
+    std::atomic<std::uint64_t> blocked_ns;
+    tawqa_hist chunks;
+    tawqa_hist blocked;
+
+    // Per-second samples, touched only by the relay thread
+    std::uint64_t sampled;
+    std::uint64_t peak;
+    std::array<std::uint64_t, TAWQA_STATS_HISTORY> history;
+};
+
+static const char* g_side_names[TAWQA_STATS_DIRS] = {"sent", "received"};
+
+static tawqa_stats_side g_sides[TAWQA_STATS_DIRS];
+static std::atomic<std::uint64_t> g_start_ns{0};
+static std::uint64_t g_next_sample_ns = 0;
+static std::uint64_t g_samples = 0;
+static volatile std::sig_atomic_t g_snapshot_wanted = 0;
+
+// Single writer: a plain load and store, no locked add
+static void tawqa_stats_bump(std::atomic<std::uint64_t>* counter, std::uint64_t n) {
+    counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static void tawqa_stats_signal(int) {
+    g_snapshot_wanted = 1;
+}
+
+void tawqa_stats_install() {
+    // SA_RESTART keeps blocking I/O going in every mode and thread; the
+    // relay's select still wakes with EINTR and goes round to
+    // tawqa_stats_poll, the other event loops retry their waits
+    struct sigaction sa = {};
+    sa.sa_handler = tawqa_stats_signal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, nullptr);
+}
+
+void tawqa_stats_start() {
+    g_start_ns = tawqa_now_ns();
+    g_next_sample_ns = g_start_ns + 1000000000ULL;
+    g_snapshot_wanted = 0;
+}
+
+void tawqa_stats_read(tawqa_stats_dir dir) {
+    tawqa_stats_bump(&g_sides[dir].reads, 1);
+}
+
+void tawqa_stats_write(tawqa_stats_dir dir, std::size_t n, std::uint64_t blocked_ns) {
+    tawqa_stats_side* side = &g_sides[dir];
+    tawqa_stats_bump(&side->bytes, n);
+    tawqa_stats_bump(&side->writes, 1);
+    tawqa_stats_bump(&side->blocked_ns, blocked_ns);
+    tawqa_hist_record(&side->chunks, n);
+    tawqa_hist_record(&side->blocked, blocked_ns);
+}
+
+void tawqa_stats_add(tawqa_stats_dir dir, std::uint64_t n) {
+    tawqa_stats_bump(&g_sides[dir].bytes, n);
+}
+
+std::uint64_t tawqa_stats_bytes(tawqa_stats_dir dir) {
+    return g_sides[dir].bytes.load(std::memory_order_relaxed);
+}
+
+bool tawqa_stats_get(tawqa_stats_dir dir, tawqa_stats_counts* counts, tawqa_hist_sum* blocked) {
+    if (!g_start_ns.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    const tawqa_stats_side& side = g_sides[dir];
+    counts->bytes = side.bytes.load(std::memory_order_relaxed);
+    counts->reads = side.reads.load(std::memory_order_relaxed);
+    counts->writes = side.writes.load(std::memory_order_relaxed);
+    counts->blocked_ns = side.blocked_ns.load(std::memory_order_relaxed);
+    tawqa_hist_add(blocked, &side.blocked);
+    return true;
+}
+
+static void tawqa_stats_sample() {
+    for (tawqa_stats_side& side : g_sides) {
+        std::uint64_t bytes = side.bytes.load(std::memory_order_relaxed);
+        std::uint64_t delta = bytes - side.sampled;
+        side.sampled = bytes;
+        side.history[g_samples % TAWQA_STATS_HISTORY] = delta;
+        if (delta > side.peak) {
+            side.peak = delta;
+        }
+    }
+    ++g_samples;
+}
+
+std::uint64_t tawqa_stats_poll(std::uint64_t now_ns) {
+    if (!g_start_ns) {
+        return 1000000000ULL;
+    }
+    if (now_ns >= g_next_sample_ns) {
+        // A relay stalled for seconds gets one sample, not a catch-up run
+        tawqa_stats_sample();
+        g_next_sample_ns += 1000000000ULL;
+        if (g_next_sample_ns <= now_ns) {
+            g_next_sample_ns = now_ns + 1000000000ULL;
+        }
+    }
+    if (g_snapshot_wanted) {
+        g_snapshot_wanted = 0;
+        tawqa_stats_dump(false);
+    }
+    return g_next_sample_ns - now_ns;
+}
+
+void tawqa_stats_dump(bool full) {
+    std::uint64_t now = tawqa_now_ns();
+    double secs = g_start_ns ? static_cast<double>(now - g_start_ns) / 1e9 : 0;
+    std::fprintf(stderr, "[stats] %.2f s elapsed\n", secs);
+
+    // The second in progress counts towards the peak too, so a run under
+    // a second has one; a sliver after full seconds is too noisy to scale
+    std::uint64_t window = g_start_ns && now > g_next_sample_ns - 1000000000ULL
+        ? now - (g_next_sample_ns - 1000000000ULL) : 0;
+    bool use_window = window && (!g_samples || window >= 100000000ULL);
+
+    for (int dir = TAWQA_STATS_SENT; dir < TAWQA_STATS_DIRS; ++dir) {
+        const tawqa_stats_side& side = g_sides[dir];
+        std::uint64_t bytes = side.bytes.load(std::memory_order_relaxed);
+        double peak = static_cast<double>(side.peak);
+        if (use_window) {
+            peak = std::max(peak, static_cast<double>(bytes - side.sampled) * 1e9 / static_cast<double>(window));
+        }
+        std::fprintf(stderr,
+                     "[stats] %-8s %14llu bytes %10llu reads %10llu writes  blocked %.3f s"
+                     "  avg %.1f MB/s  peak %.1f MB/s\n",
+                     g_side_names[dir], static_cast<unsigned long long>(bytes),
+                     static_cast<unsigned long long>(side.reads.load(std::memory_order_relaxed)),
+                     static_cast<unsigned long long>(side.writes.load(std::memory_order_relaxed)),
+                     static_cast<double>(side.blocked_ns.load(std::memory_order_relaxed)) / 1e9,
+                     secs > 0 ? static_cast<double>(bytes) / 1e6 / secs : 0.0,
+                     peak / 1e6);
+
+        static tawqa_hist_sum sum;
+        sum = {};
+        tawqa_hist_add(&sum, &side.chunks);
+        char line[256];
+        tawqa_hist_format(&sum, line, sizeof(line), TAWQA_HIST_BYTES);
+        std::fprintf(stderr, "[stats] %-8s chunks %s\n", g_side_names[dir], line);
+
+        if (!full || !g_samples) {
+            continue;
+        }
+        std::uint64_t kept = g_samples < TAWQA_STATS_HISTORY ? g_samples : TAWQA_STATS_HISTORY;
+        std::fprintf(stderr, "[stats] %-8s MB/s, last %llu s:", g_side_names[dir],
+                     static_cast<unsigned long long>(kept));
+        for (std::uint64_t i = g_samples - kept; i < g_samples; ++i) {
+            std::fprintf(stderr, " %.1f", static_cast<double>(side.history[i % TAWQA_STATS_HISTORY]) / 1e6);
+        }
+        std::fprintf(stderr, "\n");
+    }
+    std::fflush(stderr);
+}
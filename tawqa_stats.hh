@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef TAWQA_STATS_HH_INCLUDED
+#define TAWQA_STATS_HH_INCLUDED
+
+// TAWQA Transfer Statistics Header
+// 64-bit per-direction counters, chunk histograms and a per-second history
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_hist.hh"
+#include <cstddef>
+#include <cstdint>
+
+// Directions as the Total line names them: sent is stdin -> network,
+// received is network -> stdout
+enum tawqa_stats_dir : int {
+    TAWQA_STATS_SENT = 0,
+    TAWQA_STATS_RECV,
+    TAWQA_STATS_DIRS,
+};
+
+// Seconds of throughput history kept for the exit dump
+constexpr std::size_t TAWQA_STATS_HISTORY = 60;
+
+// One direction's counters as read by another thread
+struct tawqa_stats_counts {
+    std::uint64_t bytes;
+    std::uint64_t reads;
+    std::uint64_t writes;
+    std::uint64_t blocked_ns;
+};
+
+// Have SIGUSR1 ask for a snapshot on stderr. Installed before any mode
+// runs so the signal never kills us; only the relay loop prints one.
+void tawqa_stats_install();
+
+// Start the clock, dropping snapshots asked for before the relay ran
+void tawqa_stats_start();
+
+// One read on the direction's source
+void tawqa_stats_read(tawqa_stats_dir dir);
+
+// One chunk of n bytes written on, blocking for blocked_ns
+void tawqa_stats_write(tawqa_stats_dir dir, std::size_t n, std::uint64_t blocked_ns);
+
+// Bytes moved outside the relay loop, or into a sink that is no syscall
+void tawqa_stats_add(tawqa_stats_dir dir, std::uint64_t n);
+
+// Bytes written so far; safe from a signal handler
+std::uint64_t tawqa_stats_bytes(tawqa_stats_dir dir);
+
+// Copy out one direction, blocked += its per-write blocking times.
+// False until tawqa_stats_start ran.
+bool tawqa_stats_get(tawqa_stats_dir dir, tawqa_stats_counts* counts, tawqa_hist_sum* blocked);
+
+// Called from the relay loop: takes the per-second sample and prints a
+// pending SIGUSR1 snapshot. Returns ns until the next sample is due.
+std::uint64_t tawqa_stats_poll(std::uint64_t now_ns);
+
+// Counters, chunk sizes and rates to stderr; full adds the history
+void tawqa_stats_dump(bool full);
+
+#endif // TAWQA_STATS_HH_INCLUDED
@@ -0,0 +1,354 @@
+// TAWQA Striped Transfer Implementation
+// Sequence-numbered blocks over parallel connections, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_stripe.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_netio.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+// Wire format: every connection opens with a 16-byte hello
+// ['TWQS'][u8 version][u8 0][u16 streams][u64 session], then carries
+// blocks of [u64 seq][u32 len][payload]. A zero-length block is the end
+// marker and its seq is the total number of blocks in the transfer.
+constexpr unsigned char TAWQA_STRIPE_MAGIC[4] = {'T', 'W', 'Q', 'S'};
+constexpr std::uint8_t TAWQA_STRIPE_VERSION = 1;
+constexpr std::size_t TAWQA_STRIPE_HELLO = 16;
+constexpr std::size_t TAWQA_STRIPE_HDR = 12;
+constexpr std::size_t TAWQA_STRIPE_BLOCK = 256 * 1024;
+constexpr std::size_t TAWQA_STRIPE_MAX_BLOCK = 4 * 1024 * 1024;
+constexpr std::size_t TAWQA_STRIPE_WINDOW_PER_STREAM = 4;
+
+// Sender-side connection state
+struct tawqa_stripe_out {
+    int fd;
+    std::vector<char> block;  // header + payload
+    std::size_t off;          // bytes of block already sent
+    std::size_t len;          // bytes of block queued, 0 when idle
+    bool ended;               // end marker queued
+};
+
+// Receiver-side connection state
+struct tawqa_stripe_in {
+    int fd;
+    unsigned char hdr[TAWQA_STRIPE_HDR];
+    std::size_t hdr_got;
+    bool have_hdr;
+    std::uint64_t seq;
+    std::uint32_t len;
+    std::size_t got;
+    bool ended;
+};
+
+// Reorder buffer slot, indexed by seq modulo the window
+struct tawqa_stripe_slot {
+    std::vector<char> data;
+    std::uint32_t len;
+    bool ready;
+};
+
+static void tawqa_stripe_nonblock(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        tawqa_bail("Can't make stripe socket non-blocking");
+    }
+}
+
+static void tawqa_stripe_queue(tawqa_stripe_out* conn, std::uint64_t seq, std::size_t len) {
+    auto* hdr = reinterpret_cast<unsigned char*>(conn->block.data());
+    tawqa_put_be64(hdr, seq);
+    tawqa_put_be32(hdr + 8, static_cast<std::uint32_t>(len));
+    conn->off = 0;
+    conn->len = TAWQA_STRIPE_HDR + len;
+}
+
+std::uint64_t tawqa_stripe_send(const int* fds, std::size_t count, int in_fd) {
+    std::vector<tawqa_stripe_out> conns(count);
+    std::vector<struct pollfd> pfds(count + 1);
+    unsigned char hello[TAWQA_STRIPE_HELLO];
+    std::uint64_t session = tawqa_now_ns() ^ (static_cast<std::uint64_t>(getpid()) << 32);
+
+    std::memcpy(hello, TAWQA_STRIPE_MAGIC, sizeof(TAWQA_STRIPE_MAGIC));
+    hello[4] = TAWQA_STRIPE_VERSION;
+    hello[5] = 0;
+    hello[6] = static_cast<unsigned char>(count >> 8);
+    hello[7] = static_cast<unsigned char>(count);
+    tawqa_put_be64(hello + 8, session);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        conns[i].fd = fds[i];
+        conns[i].block.resize(TAWQA_STRIPE_HDR + TAWQA_STRIPE_BLOCK);
+        conns[i].off = conns[i].len = 0;
+        conns[i].ended = false;
+        if (tawqa_writen(fds[i], hello, sizeof(hello)) != sizeof(hello)) {
+            tawqa_bail("Stripe handshake failed");
+        }
+        tawqa_stripe_nonblock(fds[i]);
+    }
+
+    std::uint64_t seq = 0;
+    std::uint64_t total = 0;
+    bool eof = false;
+
+    while (true) {
+        // Once input is exhausted every connection carries the end marker
+        std::size_t live = 0;
+        bool idle = false;
+        for (auto& conn : conns) {
+            if (eof && !conn.len && !conn.ended) {
+                tawqa_stripe_queue(&conn, seq, 0);
+                conn.ended = true;
+            }
+            if (conn.len) {
+                pfds[live].fd = conn.fd;
+                pfds[live].events = POLLOUT;
+                pfds[live].revents = 0;
+                ++live;
+            } else {
+                idle = true;
+            }
+        }
+
+        // Input is only read when it is ready, so a slow source never
+        // holds up blocks already queued on the other connections
+        std::size_t in_slot = live;
+        if (!eof && idle) {
+            pfds[live].fd = in_fd;
+            pfds[live].events = POLLIN;
+            pfds[live].revents = 0;
+            ++live;
+        }
+        if (live == 0) {
+            break;
+        }
+
+        if (poll(pfds.data(), live, -1) < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            tawqa_bail("poll failed");
+        }
+
+        // Hand the next block of input to an idle connection
+        if (in_slot < live && pfds[in_slot].revents) {
+            auto conn = std::find_if(conns.begin(), conns.end(),
+                                     [](const tawqa_stripe_out& c) { return c.len == 0; });
+            ssize_t n = read(in_fd, conn->block.data() + TAWQA_STRIPE_HDR, TAWQA_STRIPE_BLOCK);
+            if (n < 0 && errno != EINTR && errno != EAGAIN) {
+                eof = true;
+            } else if (n == 0) {
+                eof = true;
+            } else if (n > 0) {
+                tawqa_stripe_queue(&*conn, seq++, static_cast<std::size_t>(n));
+                total += static_cast<std::uint64_t>(n);
+            }
+        }
+
+        for (auto& conn : conns) {
+            if (!conn.len) {
+                continue;
+            }
+            ssize_t n = send(conn.fd, conn.block.data() + conn.off, conn.len - conn.off,
+                             MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    continue;
+                }
+                tawqa_bail("Stripe send failed");
+            }
+            conn.off += static_cast<std::size_t>(n);
+            if (conn.off == conn.len) {
+                conn.len = 0;
+            }
+        }
+    }
+
+    for (auto& conn : conns) {
+        shutdown(conn.fd, SHUT_WR);
+    }
+
+    if (count) {
+        char line[96];
+        std::snprintf(line, sizeof(line), "Striped %llu bytes in %llu blocks over %zu streams",
+                      static_cast<unsigned long long>(total),
+                      static_cast<unsigned long long>(seq), count);
+        errno = 0;
+        tawqa_holler("%s", line);
+    }
+    return total;
+}
+
+static void tawqa_stripe_hello(int fd, std::size_t count, std::uint64_t* session) {
+    unsigned char hello[TAWQA_STRIPE_HELLO];
+
+    if (tawqa_readn(fd, hello, sizeof(hello)) != sizeof(hello) ||
+        std::memcmp(hello, TAWQA_STRIPE_MAGIC, sizeof(TAWQA_STRIPE_MAGIC)) != 0 ||
+        hello[4] != TAWQA_STRIPE_VERSION) {
+        tawqa_bail("Peer is not sending a striped stream");
+    }
+
+    std::size_t streams = (static_cast<std::size_t>(hello[6]) << 8) | hello[7];
+    if (streams != count) {
+        char num[16];
+        std::snprintf(num, sizeof(num), "%zu", streams);
+        tawqa_bail("Peer uses %s streams, pass the same --streams", num);
+    }
+
+    std::uint64_t id = tawqa_get_be64(hello + 8);
+    if (*session == 0) {
+        *session = id;
+    } else if (*session != id) {
+        tawqa_bail("Connections from different striped transfers");
+    }
+}
+
+std::uint64_t tawqa_stripe_recv(const int* fds, std::size_t count, int out_fd) {
+    std::vector<tawqa_stripe_in> conns(count);
+    std::vector<struct pollfd> pfds(count);
+    std::vector<tawqa_stripe_in*> polled(count);
+    std::uint64_t session = 0;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        tawqa_stripe_hello(fds[i], count, &session);
+        conns[i] = tawqa_stripe_in{};
+        conns[i].fd = fds[i];
+        tawqa_stripe_nonblock(fds[i]);
+    }
+
+    // Blocks more than `window` ahead of the next one due are left in the
+    // socket, so TCP flow control throttles whichever stream runs ahead
+    const std::uint64_t window = std::max<std::size_t>(count * TAWQA_STRIPE_WINDOW_PER_STREAM, 8);
+    std::vector<tawqa_stripe_slot> slots(window);
+    std::uint64_t next_seq = 0;
+    std::uint64_t end_seq = UINT64_MAX;
+    std::uint64_t total = 0;
+    std::size_t ended = 0;
+    std::size_t buffered = 0;
+    std::size_t peak = 0;
+
+    while (ended < count || next_seq < end_seq) {
+        std::size_t live = 0;
+        for (auto& conn : conns) {
+            if (conn.ended || (conn.have_hdr && conn.seq >= next_seq + window)) {
+                continue;
+            }
+            pfds[live].fd = conn.fd;
+            pfds[live].events = POLLIN;
+            pfds[live].revents = 0;
+            polled[live++] = &conn;
+        }
+        if (live == 0) {
+            tawqa_bail("Striped stream ended with blocks missing");
+        }
+
+        if (poll(pfds.data(), live, -1) < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            tawqa_bail("poll failed");
+        }
+
+        for (std::size_t i = 0; i < live; ++i) {
+            tawqa_stripe_in* conn = polled[i];
+            if (!pfds[i].revents) {
+                continue;
+            }
+
+            ssize_t n;
+            if (!conn->have_hdr) {
+                n = recv(conn->fd, conn->hdr + conn->hdr_got, TAWQA_STRIPE_HDR - conn->hdr_got, 0);
+            } else {
+                tawqa_stripe_slot& slot = slots[conn->seq % window];
+                n = recv(conn->fd, slot.data.data() + conn->got, conn->len - conn->got, 0);
+            }
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                    continue;
+                }
+                tawqa_bail("Stripe recv failed");
+            }
+            if (n == 0) {
+                tawqa_bail("Striped connection closed before its end marker");
+            }
+
+            if (!conn->have_hdr) {
+                conn->hdr_got += static_cast<std::size_t>(n);
+                if (conn->hdr_got < TAWQA_STRIPE_HDR) {
+                    continue;
+                }
+                conn->hdr_got = 0;
+                conn->seq = tawqa_get_be64(conn->hdr);
+                conn->len = tawqa_get_be32(conn->hdr + 8);
+
+                if (conn->len == 0) {
+                    if (end_seq != UINT64_MAX && end_seq != conn->seq) {
+                        tawqa_bail("Striped end markers disagree");
+                    }
+                    end_seq = conn->seq;
+                    conn->ended = true;
+                    ++ended;
+                    continue;
+                }
+                if (conn->len > TAWQA_STRIPE_MAX_BLOCK || conn->seq < next_seq) {
+                    tawqa_bail("Corrupt striped block header");
+                }
+                // The window check above guarantees this slot is free
+                conn->have_hdr = true;
+                conn->got = 0;
+                if (conn->seq < next_seq + window) {
+                    slots[conn->seq % window].data.resize(conn->len);
+                }
+                continue;
+            }
+
+            conn->got += static_cast<std::size_t>(n);
+            if (conn->got < conn->len) {
+                continue;
+            }
+
+            tawqa_stripe_slot& slot = slots[conn->seq % window];
+            slot.len = conn->len;
+            slot.ready = true;
+            conn->have_hdr = false;
+            peak = std::max(peak, ++buffered);
+
+            // Flush every block that is now contiguous
+            while (slots[next_seq % window].ready) {
+                tawqa_stripe_slot& head = slots[next_seq % window];
+                if (tawqa_writen(out_fd, head.data.data(), head.len) != head.len) {
+                    tawqa_bail("Write failed");
+                }
+                total += head.len;
+                head.ready = false;
+                --buffered;
+                ++next_seq;
+            }
+        }
+
+        // A parked connection may have come back inside the window
+        for (auto& conn : conns) {
+            if (conn.have_hdr && conn.got == 0 && conn.seq < next_seq + window) {
+                slots[conn.seq % window].data.resize(conn.len);
+            }
+        }
+    }
+
+    char line[112];
+    std::snprintf(line, sizeof(line),
+                  "Reassembled %llu bytes in %llu blocks from %zu streams, peak reorder %zu",
+                  static_cast<unsigned long long>(total),
+                  static_cast<unsigned long long>(next_seq), count, peak);
+    errno = 0;
+    tawqa_holler("%s", line);
+    return total;
+}
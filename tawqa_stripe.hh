@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef TAWQA_STRIPE_HH_INCLUDED
+#define TAWQA_STRIPE_HH_INCLUDED
+
+// TAWQA Striped Transfer Header
+// One stream split across N parallel TCP connections
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstdint>
+#include <cstddef>
+
+constexpr std::size_t TAWQA_STRIPE_MAX_STREAMS = 64;
+
+// Connecting side: split `in_fd` into sequence-numbered blocks and spread
+// them over the connected sockets. Returns payload bytes sent.
+std::uint64_t tawqa_stripe_send(const int* fds, std::size_t count, int in_fd);
+
+// Listening side: reassemble blocks in order onto `out_fd` through a
+// bounded reorder window. Returns payload bytes written.
+std::uint64_t tawqa_stripe_recv(const int* fds, std::size_t count, int out_fd);
+
+#endif // TAWQA_STRIPE_HH_INCLUDED
@@ -0,0 +1,254 @@
+// TAWQA TLS Transport Implementation
+// OpenSSL 3 session with SSL_OP_ENABLE_KTLS, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_tls.hh"
+#include "tawqa_generic.hh"
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#ifdef TAWQA_HAVE_OPENSSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif
+
+#ifdef TAWQA_HAVE_OPENSSL
+
+static SSL_CTX* g_tls_ctx = nullptr;
+static SSL* g_tls = nullptr;
+static int g_tls_fd = -1;
+static bool g_ktls_tx = false;
+static bool g_ktls_rx = false;
+
+// Report the first queued OpenSSL error and exit
+static void tawqa_tls_bail(const char* what) {
+    static char reason[256];
+    ERR_error_string_n(ERR_get_error(), reason, sizeof(reason));
+    errno = 0;
+    tawqa_bail("%s: %s", what, reason);
+}
+
+bool tawqa_tls_supported() {
+    return true;
+}
+
+// After a call returned `rc`, wait for whatever the session is stuck on.
+// The socket is non-blocking once the handshake is done, so a record can
+// be half sent or half received; false for a real error.
+static bool tawqa_tls_wait(int rc) {
+    struct pollfd pfd = {g_tls_fd, 0, 0};
+    switch (SSL_get_error(g_tls, rc)) {
+        case SSL_ERROR_WANT_READ:
+            pfd.events = POLLIN;
+            break;
+        case SSL_ERROR_WANT_WRITE:
+            pfd.events = POLLOUT;
+            break;
+        default:
+            return false;
+    }
+    while (poll(&pfd, 1, -1) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+        tawqa_check_interrupt();
+    }
+    return true;
+}
+
+void tawqa_tls_start(int fd, bool server, const tawqa_tls_opts* opts) {
+    g_tls_ctx = SSL_CTX_new(server ? TLS_server_method() : TLS_client_method());
+    if (!g_tls_ctx) {
+        tawqa_tls_bail("Can't create TLS context");
+    }
+    SSL_CTX_set_min_proto_version(g_tls_ctx, TLS1_2_VERSION);
+
+    // OpenSSL hands the record layer to the kernel once keys are known;
+    // GCM ciphers are the ones kTLS implements
+    SSL_CTX_set_options(g_tls_ctx, SSL_OP_ENABLE_KTLS);
+    SSL_CTX_set_cipher_list(g_tls_ctx, "ECDHE+AESGCM:ECDHE+CHACHA20");
+
+    // Handshake records must not block a relay that select()ed readable
+    SSL_CTX_clear_mode(g_tls_ctx, SSL_MODE_AUTO_RETRY);
+
+    if (opts->cert && SSL_CTX_use_certificate_chain_file(g_tls_ctx, opts->cert) != 1) {
+        tawqa_tls_bail("Can't load TLS certificate");
+    }
+    if ((opts->key || opts->cert) &&
+        SSL_CTX_use_PrivateKey_file(g_tls_ctx, opts->key ? opts->key : opts->cert, SSL_FILETYPE_PEM) != 1) {
+        tawqa_tls_bail("Can't load TLS key");
+    }
+    if (opts->ca) {
+        if (SSL_CTX_load_verify_locations(g_tls_ctx, opts->ca, nullptr) != 1) {
+            tawqa_tls_bail("Can't load TLS CA");
+        }
+        // A listener with a CA asks clients for certificates as well
+        SSL_CTX_set_verify(g_tls_ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, nullptr);
+    } else if (!server) {
+        // Without --tls-ca the server must chain to the system trust store
+        if (SSL_CTX_set_default_verify_paths(g_tls_ctx) != 1) {
+            tawqa_tls_bail("Can't load the system CA store");
+        }
+        SSL_CTX_set_verify(g_tls_ctx, SSL_VERIFY_PEER, nullptr);
+    }
+
+    g_tls = SSL_new(g_tls_ctx);
+    if (!g_tls || SSL_set_fd(g_tls, fd) != 1) {
+        tawqa_tls_bail("Can't create TLS session");
+    }
+    // The certificate must name what we dialed: an address is matched
+    // against IP SANs and gets no SNI, a name against DNS SANs. -U has no
+    // name to check, only the chain is verified there.
+    if (!server && opts->host) {
+        unsigned char addr[16];
+        if (inet_pton(AF_INET, opts->host, addr) == 1 || inet_pton(AF_INET6, opts->host, addr) == 1) {
+            X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(g_tls), opts->host);
+        } else {
+            SSL_set_tlsext_host_name(g_tls, opts->host);
+            SSL_set1_host(g_tls, opts->host);
+        }
+    }
+
+    // A dead peer surfaces as EPIPE rather than killing us
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int rc = server ? SSL_accept(g_tls) : SSL_connect(g_tls);
+    if (rc != 1) {
+        tawqa_tls_bail("TLS handshake failed");
+    }
+
+    // The relay select()s before reading, but a readable socket may hold
+    // only part of a record; blocking on the rest would stall sending too
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        tawqa_bail("Can't make TLS socket non-blocking");
+    }
+    g_tls_fd = fd;
+
+    g_ktls_tx = BIO_get_ktls_send(SSL_get_wbio(g_tls));
+    g_ktls_rx = BIO_get_ktls_recv(SSL_get_rbio(g_tls));
+    errno = 0;
+    tawqa_holler("TLS %s %s, kernel TLS tx %s", SSL_get_version(g_tls),
+                 SSL_get_cipher_name(g_tls), g_ktls_tx ? "on" : "off");
+    if (!g_ktls_rx) {
+        tawqa_holler("Kernel TLS rx off, decrypting in userspace");
+    }
+}
+
+bool tawqa_tls_ktls_tx() {
+    return g_ktls_tx;
+}
+
+ssize_t tawqa_tls_send(const char* buf, std::size_t len) {
+    std::size_t written = 0;
+    while (true) {
+        int rc = SSL_write_ex(g_tls, buf, len, &written);
+        if (rc == 1) {
+            return static_cast<ssize_t>(written);
+        }
+        // A retried write must pass the same buffer, which it does here
+        if (!tawqa_tls_wait(rc)) {
+            return -1;
+        }
+    }
+}
+
+ssize_t tawqa_tls_recv(char* buf, std::size_t len) {
+    std::size_t got = 0;
+    if (SSL_read_ex(g_tls, buf, len, &got) == 1) {
+        return static_cast<ssize_t>(got);
+    }
+
+    switch (SSL_get_error(g_tls, 0)) {
+        case SSL_ERROR_ZERO_RETURN:
+            return 0; // close_notify
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN; // partial record, or a reply it couldn't flush yet
+            return -1;
+        default:
+            return -1;
+    }
+}
+
+ssize_t tawqa_tls_sendfile(int in_fd, std::size_t len) {
+    // SSL_sendfile takes an explicit offset and leaves the file position
+    off_t offset = lseek(in_fd, 0, SEEK_CUR);
+    if (offset < 0) {
+        return -1;
+    }
+    ossl_ssize_t sent;
+    do {
+        sent = SSL_sendfile(g_tls, in_fd, offset, len, 0);
+    } while (sent < 0 && tawqa_tls_wait(static_cast<int>(sent)));
+    if (sent > 0) {
+        lseek(in_fd, offset + sent, SEEK_SET);
+    }
+    return sent;
+}
+
+bool tawqa_tls_pending() {
+    return g_tls && SSL_pending(g_tls) > 0;
+}
+
+void tawqa_tls_shutdown_wr() {
+    // Only a full socket buffer is worth waiting out, the peer's own
+    // close_notify is read by the relay
+    int rc;
+    while ((rc = SSL_shutdown(g_tls)) < 0 && SSL_get_error(g_tls, rc) == SSL_ERROR_WANT_WRITE &&
+           tawqa_tls_wait(rc)) {
+    }
+}
+
+void tawqa_tls_finish() {
+    SSL_free(g_tls);
+    SSL_CTX_free(g_tls_ctx);
+    g_tls = nullptr;
+    g_tls_ctx = nullptr;
+    g_tls_fd = -1;
+}
+
+#else
+
+bool tawqa_tls_supported() {
+    return false;
+}
+
+void tawqa_tls_start(int, bool, const tawqa_tls_opts*) {
+    tawqa_bail("Built without TLS support");
+}
+
+bool tawqa_tls_ktls_tx() {
+    return false;
+}
+
+ssize_t tawqa_tls_send(const char*, std::size_t) {
+    errno = ENOTSUP;
+    return -1;
+}
+
+ssize_t tawqa_tls_recv(char*, std::size_t) {
+    errno = ENOTSUP;
+    return -1;
+}
+
+ssize_t tawqa_tls_sendfile(int, std::size_t) {
+    errno = ENOTSUP;
+    return -1;
+}
+
+bool tawqa_tls_pending() {
+    return false;
+}
+
+void tawqa_tls_shutdown_wr() {
+}
+
+void tawqa_tls_finish() {
+}
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+#ifndef TAWQA_TLS_HH_INCLUDED
+#define TAWQA_TLS_HH_INCLUDED
+
+// TAWQA TLS Transport Header
+// OpenSSL handshake with records offloaded to kernel TLS when possible
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstddef>
+#include <sys/types.h>
+
+// --tls settings (C-style, no OOP)
+struct tawqa_tls_opts {
+    bool enabled;
+    const char* cert;   // PEM certificate chain, required when listening
+    const char* key;    // PEM private key
+    const char* ca;     // verify the peer against this CA bundle, not the system's
+    const char* host;   // expected server name when connecting
+};
+
+// False when built without OpenSSL (make OPENSSL=1)
+bool tawqa_tls_supported();
+
+// Handshake on a connected socket; bails on failure. Afterwards the
+// session keys are pushed into the kernel (TLS_TX/TLS_RX) when it can.
+void tawqa_tls_start(int fd, bool server, const tawqa_tls_opts* opts);
+
+// Whether the kernel encrypts sends, so sendfile stays usable
+bool tawqa_tls_ktls_tx();
+
+// Plaintext I/O over the session. recv returns -1 with errno EAGAIN
+// when only handshake records (session tickets, key updates) arrived.
+ssize_t tawqa_tls_send(const char* buf, std::size_t len);
+ssize_t tawqa_tls_recv(char* buf, std::size_t len);
+ssize_t tawqa_tls_sendfile(int in_fd, std::size_t len);
+
+// Decrypted bytes buffered in userspace that select() can't see
+bool tawqa_tls_pending();
+
+// Send close_notify ahead of the TCP half-close
+void tawqa_tls_shutdown_wr();
+
+void tawqa_tls_finish();
+
+#endif // TAWQA_TLS_HH_INCLUDED
@@ -0,0 +1,195 @@
+// TAWQA Inline Verification Implementation
+// Both peers hash what they send and receive, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_verify.hh"
+#include "tawqa_generic.hh"
+#include "tawqa_netio.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// Wire format: every frame starts with a big-endian u32. Without the top
+// bit it is the length of the data that follows; with it, the low byte
+// names a control frame carrying [u8 algo][u8 ok][6 pad][u64 digest].
+// END carries the sender's digest of everything it sent; ACK answers it
+// with the receiver's verdict and the digest it computed.
+constexpr std::uint32_t TAWQA_VERIFY_CONTROL = 0x80000000u;
+constexpr std::uint8_t TAWQA_VERIFY_END = 1;
+constexpr std::uint8_t TAWQA_VERIFY_ACK = 2;
+constexpr std::size_t TAWQA_VERIFY_HDR = 4;
+constexpr std::size_t TAWQA_VERIFY_CTL = 16;
+
+static tawqa_hash_algo g_algo = TAWQA_HASH_NONE;
+static tawqa_hash_state g_tx;
+static tawqa_hash_state g_rx;
+
+// Transmit progress
+static bool g_end_sent = false;
+static bool g_ack_sent = false;
+
+// Receive parser
+static unsigned char g_hdr[TAWQA_VERIFY_HDR];
+static std::size_t g_hdr_got = 0;
+static std::uint32_t g_data_left = 0;
+static std::uint8_t g_ctl_type = 0;
+static unsigned char g_ctl[TAWQA_VERIFY_CTL];
+static std::size_t g_ctl_got = 0;
+
+// Outcome
+static bool g_peer_end = false;
+static bool g_rx_ok = false;
+static bool g_peer_ack = false;
+static bool g_tx_ok = false;
+
+void tawqa_verify_init(tawqa_hash_algo algo) {
+    g_algo = algo;
+    tawqa_hash_init(&g_tx, algo);
+    tawqa_hash_init(&g_rx, algo);
+}
+
+static bool tawqa_verify_sendv(int netfd, struct iovec* iov, int iovcnt) {
+    while (iovcnt) {
+        ssize_t n = writev(netfd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            return false;
+        }
+        auto done = static_cast<std::size_t>(n);
+        while (iovcnt && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+            iov->iov_len -= done;
+        }
+    }
+    return true;
+}
+
+static void tawqa_verify_control(int netfd, std::uint8_t type, bool ok, std::uint64_t digest) {
+    unsigned char frame[TAWQA_VERIFY_HDR + TAWQA_VERIFY_CTL] = {};
+    tawqa_put_be32(frame, TAWQA_VERIFY_CONTROL | type);
+    frame[TAWQA_VERIFY_HDR] = g_algo;
+    frame[TAWQA_VERIFY_HDR + 1] = ok ? 1 : 0;
+    tawqa_put_be64(frame + TAWQA_VERIFY_HDR + 8, digest);
+    if (tawqa_writen(netfd, frame, sizeof(frame)) != sizeof(frame)) {
+        tawqa_holler("Can't send verification frame");
+    }
+}
+
+bool tawqa_verify_send(int netfd, const char* buf, std::size_t len) {
+    unsigned char hdr[TAWQA_VERIFY_HDR];
+    tawqa_put_be32(hdr, static_cast<std::uint32_t>(len));
+    tawqa_hash_update(&g_tx, buf, len);
+
+    struct iovec iov[2];
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = const_cast<char*>(buf);
+    iov[1].iov_len = len;
+    return tawqa_verify_sendv(netfd, iov, 2);
+}
+
+static void tawqa_verify_handle(int netfd) {
+    auto algo = static_cast<tawqa_hash_algo>(g_ctl[0]);
+    std::uint64_t digest = tawqa_get_be64(g_ctl + 8);
+
+    if (g_ctl_type == TAWQA_VERIFY_END) {
+        // Everything the peer sent has now been hashed on our side
+        g_peer_end = true;
+        g_rx_ok = (algo == g_algo) && digest == tawqa_hash_digest(&g_rx);
+        tawqa_verify_control(netfd, TAWQA_VERIFY_ACK, g_rx_ok, tawqa_hash_digest(&g_rx));
+        g_ack_sent = true;
+    } else if (g_ctl_type == TAWQA_VERIFY_ACK) {
+        g_peer_ack = true;
+        g_tx_ok = g_ctl[1] != 0 && digest == tawqa_hash_digest(&g_tx);
+    } else {
+        tawqa_bail("Unknown verification frame");
+    }
+}
+
+std::size_t tawqa_verify_recv(int netfd, char* buf, std::size_t len) {
+    std::size_t in = 0;
+    std::size_t out = 0;
+
+    while (in < len) {
+        if (g_data_left) {
+            // Slide payload down over the headers already consumed
+            std::size_t n = std::min<std::size_t>(g_data_left, len - in);
+            if (out != in) {
+                std::memmove(buf + out, buf + in, n);
+            }
+            tawqa_hash_update(&g_rx, buf + out, n);
+            out += n;
+            in += n;
+            g_data_left -= static_cast<std::uint32_t>(n);
+        } else if (g_ctl_type) {
+            std::size_t n = std::min(TAWQA_VERIFY_CTL - g_ctl_got, len - in);
+            std::memcpy(g_ctl + g_ctl_got, buf + in, n);
+            g_ctl_got += n;
+            in += n;
+            if (g_ctl_got == TAWQA_VERIFY_CTL) {
+                tawqa_verify_handle(netfd);
+                g_ctl_type = 0;
+                g_ctl_got = 0;
+            }
+        } else {
+            std::size_t n = std::min(TAWQA_VERIFY_HDR - g_hdr_got, len - in);
+            std::memcpy(g_hdr + g_hdr_got, buf + in, n);
+            g_hdr_got += n;
+            in += n;
+            if (g_hdr_got == TAWQA_VERIFY_HDR) {
+                std::uint32_t word = tawqa_get_be32(g_hdr);
+                g_hdr_got = 0;
+                if (word & TAWQA_VERIFY_CONTROL) {
+                    g_ctl_type = static_cast<std::uint8_t>(word);
+                } else {
+                    g_data_left = word;
+                }
+            }
+        }
+    }
+
+    return out;
+}
+
+void tawqa_verify_end(int netfd) {
+    tawqa_verify_control(netfd, TAWQA_VERIFY_END, true, tawqa_hash_digest(&g_tx));
+    g_end_sent = true;
+}
+
+bool tawqa_verify_tx_done() {
+    return g_end_sent && g_ack_sent;
+}
+
+bool tawqa_verify_report() {
+    char line[160];
+    const char* name = tawqa_hash_name(g_algo);
+
+    std::snprintf(line, sizeof(line), "Verify %s: sent %llu bytes %016llx, %s",
+                  name, static_cast<unsigned long long>(g_tx.total),
+                  static_cast<unsigned long long>(tawqa_hash_digest(&g_tx)),
+                  !g_peer_ack ? "no confirmation from peer"
+                              : g_tx_ok ? "peer confirmed" : "PEER REPORTS MISMATCH");
+    errno = 0;
+    tawqa_holler("%s", line);
+
+    std::snprintf(line, sizeof(line), "Verify %s: received %llu bytes %016llx, %s",
+                  name, static_cast<unsigned long long>(g_rx.total),
+                  static_cast<unsigned long long>(tawqa_hash_digest(&g_rx)),
+                  !g_peer_end ? "stream ended without digest"
+                              : g_rx_ok ? "matches peer" : "MISMATCH");
+    errno = 0;
+    tawqa_holler("%s", line);
+
+    return g_peer_ack && g_tx_ok && g_peer_end && g_rx_ok;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#ifndef TAWQA_VERIFY_HH_INCLUDED
+#define TAWQA_VERIFY_HH_INCLUDED
+
+// TAWQA Inline Verification Header
+// Framed relay stream with end-of-stream digest exchange
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_hash.hh"
+#include <cstddef>
+
+void tawqa_verify_init(tawqa_hash_algo algo);
+
+// Hash and send one chunk as a data frame; false if the socket failed
+bool tawqa_verify_send(int netfd, const char* buf, std::size_t len);
+
+// Strip framing from received bytes in place, hash the payload and act on
+// control frames. Returns how many payload bytes now start at `buf`.
+std::size_t tawqa_verify_recv(int netfd, char* buf, std::size_t len);
+
+// Input is exhausted: send our digest to the peer
+void tawqa_verify_end(int netfd);
+
+// Our digest and our verdict on the peer's data have both been sent,
+// so the write side may be shut down
+bool tawqa_verify_tx_done();
+
+// Print digests; true only if both directions were confirmed intact
+bool tawqa_verify_report();
+
+#endif // TAWQA_VERIFY_HH_INCLUDED
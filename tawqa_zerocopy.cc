@@ -0,0 +1,225 @@
+// TAWQA Zerocopy Send Implementation
+// Completion tracking through the socket error queue, no OOP
+// Using TAWQA prefix to avoid naming conflicts
+
+#include "tawqa_zerocopy.hh"
+#include "tawqa_generic.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <sys/socket.h>
+#ifdef TAWQA_HAVE_ZEROCOPY
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <poll.h>
+#endif
+
+constexpr std::size_t TAWQA_ZC_BUFFERS = 16;
+
+alignas(4096) static char g_zc_mem[TAWQA_ZC_BUFFERS][TAWQA_ZC_BUFSIZ];
+
+#ifdef TAWQA_HAVE_ZEROCOPY
+
+// Each buffer remembers the notification ids of the sends that pinned it;
+// ids count successful MSG_ZEROCOPY calls on the socket, starting at 0
+struct tawqa_zc_slot {
+    std::uint32_t first_id;
+    std::uint32_t last_id;
+    std::uint32_t outstanding;
+};
+
+static tawqa_zc_slot g_zc_slots[TAWQA_ZC_BUFFERS];
+static std::size_t g_zc_next = 0;
+static std::uint32_t g_zc_id = 0;
+static std::uint64_t g_zc_sends = 0;
+static std::uint64_t g_zc_copied = 0;
+static std::uint64_t g_zc_fallback = 0;
+
+// Ids wrap after 2^32 sends, so they are ordered as serial numbers; the
+// ids in flight at any time span far less than half the range
+static bool tawqa_zc_before(std::uint32_t a, std::uint32_t b) {
+    return static_cast<std::int32_t>(a - b) < 0;
+}
+
+// Retire notification ids [lo, hi] from whichever buffers they pinned
+static void tawqa_zc_complete(std::uint32_t lo, std::uint32_t hi) {
+    for (auto& slot : g_zc_slots) {
+        if (!slot.outstanding || tawqa_zc_before(slot.last_id, lo) || tawqa_zc_before(hi, slot.first_id)) {
+            continue;
+        }
+        std::uint32_t from = tawqa_zc_before(lo, slot.first_id) ? slot.first_id : lo;
+        std::uint32_t to = tawqa_zc_before(slot.last_id, hi) ? slot.last_id : hi;
+        slot.outstanding -= std::min(slot.outstanding, to - from + 1);
+    }
+}
+
+// Drain the error queue; with `block` wait up to `timeout_ms` for the first
+// notification. Returns false on timeout.
+static bool tawqa_zc_reap(int fd, bool block, int timeout_ms) {
+    if (block) {
+        // POLLERR is always reported, no events need requesting
+        struct pollfd pfd = {fd, 0, 0};
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready == 0) {
+            return false;
+        }
+    }
+
+    while (true) {
+        char control[128];
+        struct msghdr msg = {};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            errno = 0; // EAGAIN: queue drained, don't leak it into hollers
+            return true;
+        }
+
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            bool recverr = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                           (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if (!recverr) {
+                continue;
+            }
+            auto* serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            // Loopback and some NICs make the kernel copy after all
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                g_zc_copied += serr->ee_data - serr->ee_info + 1;
+            }
+            tawqa_zc_complete(serr->ee_info, serr->ee_data);
+        }
+    }
+}
+
+bool tawqa_zc_init(int fd) {
+    int one = 1;
+    return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+}
+
+// Index of the next buffer the kernel is done with, or TAWQA_ZC_BUFFERS
+static std::size_t tawqa_zc_free_slot(int fd) {
+    for (int pass = 0; pass < 2; ++pass) {
+        for (std::size_t i = 0; i < TAWQA_ZC_BUFFERS; ++i) {
+            std::size_t idx = (g_zc_next + i) % TAWQA_ZC_BUFFERS;
+            if (!g_zc_slots[idx].outstanding) {
+                return idx;
+            }
+        }
+        tawqa_zc_reap(fd, false, 0);
+    }
+    return TAWQA_ZC_BUFFERS;
+}
+
+char* tawqa_zc_acquire(int fd) {
+    std::size_t idx = tawqa_zc_free_slot(fd);
+    if (idx == TAWQA_ZC_BUFFERS) {
+        return nullptr;
+    }
+    g_zc_next = idx + 1;
+    return g_zc_mem[idx];
+}
+
+bool tawqa_zc_pinned(int fd) {
+    return tawqa_zc_free_slot(fd) == TAWQA_ZC_BUFFERS;
+}
+
+bool tawqa_zc_send(int fd, char* buf, std::size_t len) {
+    tawqa_zc_slot& slot = g_zc_slots[(buf - g_zc_mem[0]) / TAWQA_ZC_BUFSIZ];
+    slot.first_id = g_zc_id;
+    slot.outstanding = 0;
+
+    while (len) {
+        ssize_t sent = send(fd, buf, len, MSG_ZEROCOPY);
+        if (sent < 0 && errno == ENOBUFS) {
+            // Out of optmem for pinned pages: copy this chunk instead
+            sent = send(fd, buf, len, 0);
+            g_zc_fallback += 1;
+        } else if (sent >= 0) {
+            slot.last_id = g_zc_id++;
+            slot.outstanding += 1;
+            g_zc_sends += 1;
+        }
+        if (sent < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            return false;
+        }
+        buf += sent;
+        len -= static_cast<std::size_t>(sent);
+    }
+
+    // Opportunistically free buffers without waiting
+    tawqa_zc_reap(fd, false, 0);
+    return true;
+}
+
+void tawqa_zc_poll(int fd) {
+    tawqa_zc_reap(fd, false, 0);
+}
+
+void tawqa_zc_finish(int fd) {
+    for (int tries = 0; tries < 10; ++tries) {
+        bool pending = false;
+        for (const auto& slot : g_zc_slots) {
+            pending = pending || slot.outstanding;
+        }
+        if (!pending || !tawqa_zc_reap(fd, true, 100)) {
+            break;
+        }
+    }
+
+    if (g_zc_sends) {
+        static char sends_str[24], copied_str[24], fallback_str[24];
+        std::snprintf(sends_str, sizeof(sends_str), "%llu", static_cast<unsigned long long>(g_zc_sends));
+        std::snprintf(copied_str, sizeof(copied_str), "%llu", static_cast<unsigned long long>(g_zc_copied));
+        std::snprintf(fallback_str, sizeof(fallback_str), "%llu", static_cast<unsigned long long>(g_zc_fallback));
+        errno = 0;
+        tawqa_holler("Zerocopy: %s sends, %s copied by kernel, %s ENOBUFS fallbacks",
+                     sends_str, copied_str, fallback_str);
+    }
+}
+
+#else
+
+bool tawqa_zc_init(int) {
+    return false;
+}
+
+char* tawqa_zc_acquire(int) {
+    return g_zc_mem[0];
+}
+
+bool tawqa_zc_pinned(int) {
+    return false;
+}
+
+bool tawqa_zc_send(int fd, char* buf, std::size_t len) {
+    while (len) {
+        ssize_t sent = send(fd, buf, len, 0);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                tawqa_check_interrupt();
+                continue;
+            }
+            return false;
+        }
+        buf += sent;
+        len -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+void tawqa_zc_poll(int) {
+}
+
+void tawqa_zc_finish(int) {
+}
+
+#endif
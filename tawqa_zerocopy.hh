@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef TAWQA_ZEROCOPY_HH_INCLUDED
+#define TAWQA_ZEROCOPY_HH_INCLUDED
+
+// TAWQA Zerocopy Send Header
+// MSG_ZEROCOPY buffer pool for the stdin -> network direction
+// Using TAWQA prefix to avoid naming conflicts
+
+#include <cstddef>
+
+// Zerocopy only pays off on large sends, so pool buffers are much bigger
+// than the relay's copy buffer
+constexpr std::size_t TAWQA_ZC_BUFSIZ = 128 * 1024;
+
+// Turn on SO_ZEROCOPY; false if the kernel or platform lacks it
+bool tawqa_zc_init(int fd);
+
+// Next buffer the kernel no longer references, or nullptr while every
+// buffer is still pinned by an in-flight send
+char* tawqa_zc_acquire(int fd);
+
+// True when no buffer is free even after reaping completions; the caller
+// should wait for the socket's error queue rather than for more input
+bool tawqa_zc_pinned(int fd);
+
+// Send all of `buf` with MSG_ZEROCOPY. The buffer stays owned by the
+// kernel until its completions are reaped. False on a socket error.
+bool tawqa_zc_send(int fd, char* buf, std::size_t len);
+
+// Retire completed sends without waiting. select() reports a socket with
+// queued completions as readable even when no data has arrived.
+void tawqa_zc_poll(int fd);
+
+// Wait (bounded) for outstanding completions and report copy fallbacks
+void tawqa_zc_finish(int fd);
+
+#endif // TAWQA_ZEROCOPY_HH_INCLUDED